@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "common/thread_pool.h"
+
+/*
+    Measures the overhead of the scheduler with empty tasks:
+        spawn:  one thread spawns every task, the workers have to steal all of them.
+        fanout: every task spawns two more until the depth is reached, mostly popped locally.
+    usage: bench_thread_pool [worker_count]
+*/
+
+#define SPAWN_TASK_COUNT 1000000
+#define FANOUT_DEPTH 20
+
+static double _now_ns(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void _empty_task(void* user) {
+    atomic_size_t* counter = user;
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+typedef struct fanout_job_t {
+    thread_pool_t* pool;
+    atomic_size_t* counter;
+    int depth;
+} fanout_job_t;
+
+static void _fanout_task(void* user) {
+    fanout_job_t* job = user;
+    atomic_fetch_add_explicit(job->counter, 1, memory_order_relaxed);
+    if (job->depth == 0) {
+        return;
+    }
+
+    fanout_job_t children[2] = {
+        { .pool = job->pool, .counter = job->counter, .depth = job->depth - 1 },
+        { .pool = job->pool, .counter = job->counter, .depth = job->depth - 1 },
+    };
+    task_group_t group;
+    task_group_init(&group, job->pool);
+    task_group_spawn(&group, _fanout_task, &children[0]);
+    task_group_spawn(&group, _fanout_task, &children[1]);
+    task_group_wait(&group);
+}
+
+static void _bench(size_t worker_count) {
+    thread_pool_t pool;
+    thread_pool_init(&pool, worker_count);
+
+    atomic_size_t counter;
+    atomic_init(&counter, 0);
+    task_group_t group;
+    task_group_init(&group, &pool);
+
+    // spawn
+    double begin = _now_ns();
+    for (size_t i = 0; i < SPAWN_TASK_COUNT; i++) {
+        task_group_spawn(&group, _empty_task, &counter);
+    }
+    task_group_wait(&group);
+    double duration = _now_ns() - begin;
+    printf("  spawn:  %zu tasks in %.2fms, %.1fns/task\n",
+        (size_t)atomic_load(&counter), duration / 1e6, duration / (double)atomic_load(&counter));
+
+    // fanout
+    atomic_store(&counter, 0);
+    fanout_job_t root = { .pool = &pool, .counter = &counter, .depth = FANOUT_DEPTH };
+    begin = _now_ns();
+    task_group_spawn(&group, _fanout_task, &root);
+    task_group_wait(&group);
+    duration = _now_ns() - begin;
+    printf("  fanout: %zu tasks in %.2fms, %.1fns/task\n",
+        (size_t)atomic_load(&counter), duration / 1e6, duration / (double)atomic_load(&counter));
+
+    thread_pool_cleanup(&pool);
+}
+
+int main(int argc, char** argv) {
+    const size_t WorkerCount = argc > 1 ? (size_t)atoi(argv[1]) : thread_pool_default_size();
+
+    printf("serial:\n");
+    _bench(0);
+    printf("%zu workers:\n", WorkerCount);
+    _bench(WorkerCount);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <stb/stb_ds.h>
+
+#include "../common/error.h"
+#include "../backend_qbe.h"
+#include "impl_gen.h"
+
+/*
+    Local common subexpression elimination, with '--fcse'.
+    Instructions without side effects are numbered by their instruction & operands, within a basic block an identical
+    one is the temporary of the first:
+        %r4 =l extsw %i                 %r4 =l extsw %i
+        %r5 =l shl %r4, 2               %r5 =l shl %r4, 2
+        %r6 =l add %arr, %r5            %r6 =l add %arr, %r5
+        %r7 =w loadsw %r6               %r7 =w loadsw %r6
+        %r8 =l extsw %i                 %r9 =w add %r7, %r7
+        ...
+    A value is forgotten when one of its temporaries is assigned to. Loads are forgotten at anything which writes to
+    memory, stores, blits & calls, since any of them may alias. A label starts a new block, with nothing known.
+*/
+
+static bool _operand_eq(operand_t a, operand_t b) {
+    if (a.is_immediate != b.is_immediate) {
+        return false;
+    }
+    return a.is_immediate ? a.immediate == b.immediate : a.temp.id == b.temp.id;
+}
+
+static bool _uses_temporary(operand_t operand, temporary_t temp) {
+    return !operand.is_immediate && operand.temp.id == temp.id;
+}
+
+temporary_t qbe_emit_value(emit_buffer_t* f, const char* ins, operand_t lhs, operand_t rhs, bool is_load, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(strlen(ins) < sizeof(((value_t*)0)->ins), "instruction '%s' is too long", ins);
+
+    if (ctx->cse) {
+        for (size_t i = arrlenu(ctx->values); i-- > 0;) {
+            const value_t* Value = &ctx->values[i];
+            if (_operand_eq(Value->lhs, lhs) && _operand_eq(Value->rhs, rhs) && strcmp(Value->ins, ins) == 0) {
+                return Value->result;
+            }
+        }
+    }
+
+    const temporary_t Result = get_temporary(ctx);
+    emit_char(f, '\t');
+    emit_temp(f, Result);
+    emit_str(f, ins);
+    emit_char(f, ' ');
+    emit_operand(f, lhs);
+    if (rhs.is_immediate || rhs.temp.id) {
+        emit_str(f, ", ");
+        emit_operand(f, rhs);
+    }
+    emit_char(f, '\n');
+
+    if (ctx->cse) {
+        // Long blocks start over, so a lookup stays cheap.
+        if (arrlenu(ctx->values) >= CSE_MAX_VALUES) {
+            qbe_forget_values(ctx);
+        }
+        value_t value = { .lhs = lhs, .rhs = rhs, .result = Result, .is_load = is_load };
+        strcpy(value.ins, ins);
+        arrput(ctx->values, value);
+    }
+    return Result;
+}
+
+void qbe_forget_temporary(temporary_t temp, backend_ctx_t* ctx) {
+    size_t kept = 0;
+    for (size_t i = 0; i < arrlenu(ctx->values); i++) {
+        const value_t* Value = &ctx->values[i];
+        if (Value->result.id == temp.id || _uses_temporary(Value->lhs, temp) || _uses_temporary(Value->rhs, temp)) {
+            continue;
+        }
+        ctx->values[kept++] = *Value;
+    }
+    if (ctx->values) {
+        stbds_header(ctx->values)->length = kept;
+    }
+}
+
+void qbe_forget_loads(backend_ctx_t* ctx) {
+    size_t kept = 0;
+    for (size_t i = 0; i < arrlenu(ctx->values); i++) {
+        if (!ctx->values[i].is_load) {
+            ctx->values[kept++] = ctx->values[i];
+        }
+    }
+    if (ctx->values) {
+        stbds_header(ctx->values)->length = kept;
+    }
+}
+
+void qbe_forget_values(backend_ctx_t* ctx) {
+    if (ctx->values) {
+        stbds_header(ctx->values)->length = 0;
+    }
+}
+
+void qbe_generate_label(emit_buffer_t* f, label_t label, backend_ctx_t* ctx) {
+    emit_label(f, label);
+    emit_char(f, '\n');
+    qbe_forget_values(ctx);
+}
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <string.h>
+#include <stb/stb_ds.h>
+
+#include "../common/error.h"
+#include "../parser/ast_type.h"
+#include "../parser/ast_visit.h"
+#include "../semantics/struct_layout.h"
+#include "../backend_qbe.h"
+#include "impl_gen.h"
+
+/*
+    Array & struct initializers of only compile-time constants are static data:
+        let table: i32[4] = [1, 2, 4, 8];       data $init.0 = align 8 { w 1, w 2, w 4, w 8 }
+    A local which is never written to & whose address never leaves the function, is the data itself:
+        %r1 =l copy $init.0
+    Any other use gets a copy of its own in a stack slot:
+        blit $init.0, %r1, 16
+    A struct initializer with some constant fields starts from a template of those, the rest are zeroes until stored:
+        let v: Vec3 = Vec3 { x: 0, y: 1, z: n };    blit $init.1, %r2, 12
+                                                    storew %n, %r3
+    Names are per function for the analysis, just like with scalar replacement.
+*/
+
+bool qbe_is_constant_initializer(const ast_node_t* ast) {
+    switch (ast->kind) {
+        case AST_BOOL_LITERAL:
+        case AST_CHAR_LITERAL:
+        case AST_INTEGER_LITERAL:
+        case AST_FLOAT_LITERAL:
+        case AST_STRING_LITERAL: {
+            return true;
+        }
+
+        case AST_UNARY_OP: {
+            const ast_node_t* Operand = ast->data.unary_op.operand;
+            return ast->data.unary_op.operation == UNARY_OP_NEGATE &&
+                (Operand->kind == AST_INTEGER_LITERAL || Operand->kind == AST_FLOAT_LITERAL);
+        }
+
+        case AST_ARRAY_INITIALIZER_LIST: {
+            const ast_array_initializer_list_t* InitList = &ast->data.array_initializer_list;
+            for (size_t i = 0; i < arrlenu(InitList->exprs); i++) {
+                if (!qbe_is_constant_initializer(InitList->exprs[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        case AST_STRUCT_INITIALIZER_LIST: {
+            const ast_struct_initializer_list_t* InitList = &ast->data.struct_initializer_list;
+            for (size_t i = 0; i < arrlenu(InitList->fields); i++) {
+                if (!qbe_is_constant_initializer(InitList->fields[i].expr)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        default: {
+            return false;
+        }
+    }
+}
+
+// 'a' of 'a.b[1].c'
+static const ast_node_t* _access_base(const ast_node_t* ast) {
+    for (;;) {
+        if (ast->kind == AST_GET_MEMBER) {
+            ast = ast->data.get_member.expr;
+        }
+        else if (ast->kind == AST_BINARY_OP && ast->data.binary_op.operation == BINARY_OP_ARRAY_INDEX) {
+            ast = ast->data.binary_op.left;
+        }
+        else {
+            return ast;
+        }
+    }
+}
+
+static void _mark_base(const ast_node_t* ast, const char*** mutated) {
+    const ast_node_t* Base = _access_base(ast);
+    if (Base->kind == AST_GET_VARIABLE) {
+        arrput(*mutated, Base->data.literal);
+    }
+}
+
+static ast_visit_result_t _find_mutated(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    const char*** mutated = user;
+
+    switch (ast->kind) {
+        case AST_BINARY_OP: {
+            if (ast->data.binary_op.operation == BINARY_OP_ASSIGN) {
+                _mark_base(ast->data.binary_op.left, mutated);
+                break;
+            }
+            if (ast->data.binary_op.operation != BINARY_OP_ARRAY_INDEX) {
+                break;
+            }
+        }
+        /* fallthrough */
+        case AST_GET_MEMBER:
+        case AST_GET_VARIABLE: {
+            // A pointer into the variable's memory, fine only when it's accessed further.
+            if (layout_is_value_type(&ast->expr_type)) {
+                break;
+            }
+            const ast_node_t* Parent = visit->parent;
+            const bool IsAccessed = Parent && (
+                Parent->kind == AST_GET_MEMBER ||
+                (Parent->kind == AST_BINARY_OP && Parent->data.binary_op.operation == BINARY_OP_ARRAY_INDEX && visit->role == AST_ROLE_LEFT)
+            );
+            if (!IsAccessed) {
+                _mark_base(ast, mutated);
+            }
+            break;
+        }
+
+        case AST_UNARY_OP: {
+            if (ast->data.unary_op.operation == UNARY_OP_ADDRESS_OF) {
+                _mark_base(ast->data.unary_op.operand, mutated);
+            }
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+void qbe_find_mutated_locals(ast_node_t* function, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(function->kind == AST_FUNCTION_DECLARATION, "?");
+    if (ctx->mutated_locals) {
+        stbds_header(ctx->mutated_locals)->length = 0;
+    }
+
+    const ast_visitor_t Visitor = { .pre = _find_mutated, .user = &ctx->mutated_locals };
+    for (size_t i = 0; i < arrlenu(function->data.function_declaration.body); i++) {
+        ast_visit(&function->data.function_declaration.body[i], &Visitor);
+    }
+}
+
+static temporary_t _qbe_constant_address(emit_buffer_t* f, const ast_node_t* ast, const datatype_t* type, backend_ctx_t* ctx) {
+    const temporary_t Ptr = get_temporary(ctx);
+    emit_assign(f, Ptr, 'l', "copy");
+    emit_symbol(f, SYMBOL_CONSTANT, arrlenu(ctx->constants));
+    emit_char(f, '\n');
+    const constant_t Constant = { .ast = ast, .type = type };
+    arrput(ctx->constants, Constant);
+    return Ptr;
+}
+
+static temporary_t _qbe_constant_copy(emit_buffer_t* f, const ast_node_t* ast, const datatype_t* type, backend_ctx_t* ctx) {
+    const size_t Size = qbe_get_type_size(type, ctx);
+    const temporary_t Copy = qbe_allocate(8, Size, ctx);
+    const temporary_t Data = _qbe_constant_address(f, ast, type, ctx);
+    qbe_generate_blit(f, Data, Copy, Size, ctx);
+    return Copy;
+}
+
+temporary_t qbe_generate_constant_initializer(emit_buffer_t* f, const ast_node_t* ast, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(qbe_is_constant_initializer(ast), "?");
+    return _qbe_constant_copy(f, ast, &ast->expr_type, ctx);
+}
+
+temporary_t qbe_generate_constant_argument(emit_buffer_t* f, const ast_node_t* ast, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(qbe_is_constant_initializer(ast), "?");
+    return _qbe_constant_address(f, ast, &ast->expr_type, ctx);
+}
+
+temporary_t qbe_generate_initializer_template(emit_buffer_t* f, const ast_node_t* ast, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(ast->kind == AST_STRUCT_INITIALIZER_LIST, "?");
+    return _qbe_constant_copy(f, ast, &ast->expr_type, ctx);
+}
+
+bool qbe_generate_constant_declaration(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
+    ast_variable_declaration_t* decl = &ast->data.variable_declaration;
+    const ast_node_t* Expr = decl->expr;
+    if (!decl->name || !Expr) {
+        return false;
+    }
+
+    const bool IsAggregate = Expr->kind == AST_ARRAY_INITIALIZER_LIST || Expr->kind == AST_STRUCT_INITIALIZER_LIST;
+    if (!IsAggregate || !qbe_is_constant_initializer(Expr)) {
+        return false;
+    }
+
+    // Laid out as declared, the elements of '["ab", "cd"]' are arrays while a 'char*[2]' has pointers.
+    const bool IsMutated = str_array_contains(ctx->mutated_locals, decl->name);
+    const temporary_t Ptr = IsMutated ?
+        _qbe_constant_copy(f, Expr, &decl->type, ctx) :
+        _qbe_constant_address(f, Expr, &decl->type, ctx);
+    const variable_t Var = { .var_decl = decl, .temp = Ptr };
+    arrput(ctx->variables, Var);
+    return true;
+}
+
+static void _qbe_emit_constant(emit_buffer_t* f, const ast_node_t* ast, const datatype_t* type, backend_ctx_t* ctx);
+
+static void _emit_zeroes(emit_buffer_t* f, size_t size) {
+    emit_str(f, "z ");
+    emit_uint(f, size);
+    emit_str(f, ", ");
+}
+
+static void _qbe_emit_struct(emit_buffer_t* f, const ast_node_t* ast, const datatype_t* type, backend_ctx_t* ctx) {
+    const ast_struct_initializer_list_t* InitList = &ast->data.struct_initializer_list;
+    const aggregate_type_t* Type = qbe_find_type(InitList->name, ctx);
+    DEBUG_ASSERT(Type, "Struct declaration was not found!");
+    const struct_layout_t* Layout = Type->layout;
+
+    // Members in the order of their offsets, padding & uninitialized members are zeroes.
+    size_t offset = 0;
+    for (size_t i = 0; i < Layout->member_count; i++) {
+        const struct_member_t* Member = &Layout->members[i];
+        const ast_node_t* Value = NULL;
+        for (size_t j = 0; j < arrlenu(InitList->fields); j++) {
+            if (InitList->fields[j].member == Member) {
+                Value = InitList->fields[j].expr;
+            }
+        }
+
+        if (Member->offset > offset) {
+            _emit_zeroes(f, Member->offset - offset);
+        }
+        if (Value) {
+            _qbe_emit_constant(f, Value, Member->type, ctx);
+        }
+        else {
+            _emit_zeroes(f, Member->size);
+        }
+        offset = Member->offset + Member->size;
+    }
+
+    const size_t Size = qbe_get_type_size(type, ctx);
+    if (Size > offset) {
+        _emit_zeroes(f, Size - offset);
+    }
+}
+
+static void _qbe_emit_constant(emit_buffer_t* f, const ast_node_t* ast, const datatype_t* type, backend_ctx_t* ctx) {
+    // A field of a template, stored after the copy.
+    if (!qbe_is_constant_initializer(ast) && ast->kind != AST_STRUCT_INITIALIZER_LIST) {
+        _emit_zeroes(f, qbe_get_type_size(type, ctx));
+        return;
+    }
+
+    switch (ast->kind) {
+        case AST_ARRAY_INITIALIZER_LIST: {
+            const ast_array_initializer_list_t* InitList = &ast->data.array_initializer_list;
+            for (size_t i = 0; i < arrlenu(InitList->exprs); i++) {
+                _qbe_emit_constant(f, InitList->exprs[i], type->base, ctx);
+            }
+            return;
+        }
+
+        case AST_STRUCT_INITIALIZER_LIST: {
+            _qbe_emit_struct(f, ast, type, ctx);
+            return;
+        }
+
+        case AST_STRING_LITERAL: {
+            if (type->kind == DATATYPE_POINTER) {
+                emit_str(f, "l $str.");
+                emit_uint(f, qbe_pool_string(ast->data.literal, ctx));
+                emit_str(f, ", ");
+                return;
+            }
+            DEBUG_ASSERT(type->kind == DATATYPE_ARRAY, "string literal for a '%u' in static data", type->kind);
+            qbe_generate_string_data(f, ast->data.literal);
+            emit_str(f, ", ");
+            const size_t Length = strlen(ast->data.literal) + 1;
+            if (type->array_size > Length) {
+                _emit_zeroes(f, type->array_size - Length);
+            }
+            return;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    // Scalars
+    const bool Negate = ast->kind == AST_UNARY_OP;
+    if (Negate) {
+        ast = ast->data.unary_op.operand;
+    }
+    if (ast->kind == AST_FLOAT_LITERAL) {
+        emit_format(f, "s s_%f, ", Negate ? -ast->data.f32 : ast->data.f32);
+        return;
+    }
+
+    int64_t value = 0;
+    switch (ast->kind) {
+        case AST_BOOL_LITERAL:    { value = ast->data.boolean ? 1 : 0; break; }
+        case AST_CHAR_LITERAL:    { value = ast->data.c; break; }
+        case AST_INTEGER_LITERAL: { value = ast->data.integer; break; }
+        default: { PANIC("not a constant %u", ast->kind); }
+    }
+    if (Negate) {
+        value = -value;
+    }
+
+    const char* Item = NULL;
+    switch (qbe_get_type_size(type, ctx)) {
+        case 1:  { Item = "b"; break; }
+        case 2:  { Item = "h"; break; }
+        case 4:  { Item = "w"; break; }
+        default: { Item = "l"; break; }
+    }
+    emit_str(f, Item);
+    emit_char(f, ' ');
+    emit_int(f, value);
+    emit_str(f, ", ");
+}
+
+void qbe_generate_constant_pool(emit_buffer_t* f, backend_ctx_t* ctx) {
+    for (size_t i = 0; i < arrlenu(ctx->constants); i++) {
+        const constant_t* Constant = &ctx->constants[i];
+        emit_str(f, "section \".rodata\" data $init.");
+        emit_uint(f, i);
+        emit_str(f, " = align 8 { ");
+        _qbe_emit_constant(f, Constant->ast, Constant->type, ctx);
+        emit_str(f, "}\n");
+    }
+}
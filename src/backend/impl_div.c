@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "../common/error.h"
+#include "../backend_qbe.h"
+#include "impl_gen.h"
+
+/*
+    Division & modulo by a constant, without a divide instruction (20-40 cycles on x86).
+    Powers of two are shifts & masks, anything else is a multiplication by a "magic" reciprocal:
+        x / d = (x * M) >> p, where M = ceil(2^p / d)
+    which is exact for every 32-bit x, when p is large enough that M * d - 2^p <= 2^(p - 32) (2^(p - 31) when signed).
+    See: Granlund & Montgomery, "Division by Invariant Integers using Multiplication".
+    QBE has no high multiplication, so the product is computed in a long.
+*/
+
+static temporary_t _emit_imm(emit_buffer_t* f, char type, const char* ins, temporary_t a, int64_t imm, backend_ctx_t* ctx) {
+    const temporary_t Result = get_temporary(ctx);
+    emit_assign(f, Result, type, ins);
+    emit_temp(f, a);
+    emit_str(f, ", ");
+    emit_int(f, imm);
+    emit_char(f, '\n');
+    return Result;
+}
+
+static temporary_t _emit_temp(emit_buffer_t* f, char type, const char* ins, temporary_t a, temporary_t b, backend_ctx_t* ctx) {
+    const temporary_t Result = get_temporary(ctx);
+    emit_assign(f, Result, type, ins);
+    emit_temp(f, a);
+    emit_str(f, ", ");
+    emit_temp(f, b);
+    emit_char(f, '\n');
+    return Result;
+}
+
+static temporary_t _emit_unary(emit_buffer_t* f, char type, const char* ins, temporary_t a, backend_ctx_t* ctx) {
+    const temporary_t Result = get_temporary(ctx);
+    emit_assign(f, Result, type, ins);
+    emit_temp(f, a);
+    emit_char(f, '\n');
+    return Result;
+}
+
+static temporary_t _emit_constant(emit_buffer_t* f, int64_t value, backend_ctx_t* ctx) {
+    const temporary_t Result = get_temporary(ctx);
+    emit_assign(f, Result, 'w', "copy");
+    emit_int(f, value);
+    emit_char(f, '\n');
+    return Result;
+}
+
+static int _log2_exact(uint64_t value) {
+    if (value == 0 || (value & (value - 1)) != 0) {
+        return -1;
+    }
+    int exponent = 0;
+    while (value > 1) {
+        value >>= 1;
+        exponent++;
+    }
+    return exponent;
+}
+
+// Smallest 'p' >= 32 & its 'M' for which the multiplication is exact, 'precision' is 32 unsigned & 31 signed.
+static void _magic_number(uint64_t divisor, int precision, uint64_t* magic, int* shift) {
+    DEBUG_ASSERT(divisor > 2 && divisor <= UINT32_MAX / 2 + 1, "no magic number for %" PRIu64, divisor);
+    for (int p = 32; p < 64; p++) {
+        const uint64_t Power = (uint64_t)1 << p;
+        const uint64_t M = Power / divisor + (Power % divisor != 0);
+        if (M * divisor - Power <= ((uint64_t)1 << (p - precision))) {
+            *magic = M;
+            *shift = p;
+            return;
+        }
+    }
+    PANIC("no magic number for %" PRIu64, divisor);
+}
+
+static temporary_t _unsigned_quotient(emit_buffer_t* f, temporary_t lhs, uint32_t divisor, backend_ctx_t* ctx) {
+    const int PowerOfTwo = _log2_exact(divisor);
+    if (PowerOfTwo >= 0) {
+        return _emit_imm(f, 'w', "shr", lhs, PowerOfTwo, ctx);
+    }
+
+    // Fits at most once.
+    if (divisor > UINT32_MAX / 2 + 1) {
+        return _emit_imm(f, 'w', "cugew", lhs, divisor, ctx);
+    }
+
+    uint64_t magic = 0;
+    int shift = 0;
+    _magic_number(divisor, 32, &magic, &shift);
+
+    const temporary_t Wide = _emit_unary(f, 'l', "extuw", lhs, ctx);
+    temporary_t quotient = NULL_TEMPORARY;
+    if (magic <= UINT32_MAX) {
+        const temporary_t Product = _emit_imm(f, 'l', "mul", Wide, (int64_t)magic, ctx);
+        quotient = _emit_imm(f, 'l', "shr", Product, shift, ctx);
+    }
+    else {
+        // 33-bit magic, 'x * M' would overflow: ((x * (M - 2^32)) >> 32 + x) >> (p - 32)
+        const temporary_t Product = _emit_imm(f, 'l', "mul", Wide, (int64_t)(magic - ((uint64_t)1 << 32)), ctx);
+        const temporary_t High = _emit_imm(f, 'l', "shr", Product, 32, ctx);
+        const temporary_t Sum = _emit_temp(f, 'l', "add", High, Wide, ctx);
+        quotient = _emit_imm(f, 'l', "shr", Sum, shift - 32, ctx);
+    }
+    return _emit_unary(f, 'w', "copy", quotient, ctx);
+}
+
+static temporary_t _signed_quotient(emit_buffer_t* f, temporary_t lhs, int32_t divisor, backend_ctx_t* ctx) {
+    const uint32_t Magnitude = divisor < 0 ? 0u - (uint32_t)divisor : (uint32_t)divisor;
+    temporary_t quotient = NULL_TEMPORARY;
+
+    const int PowerOfTwo = _log2_exact(Magnitude);
+    if (PowerOfTwo >= 0) {
+        // Shifting rounds down, negative numbers need a bias of 2^k - 1 to round towards zero.
+        const temporary_t Sign = _emit_imm(f, 'w', "sar", lhs, 31, ctx);
+        const temporary_t Bias = _emit_imm(f, 'w', "shr", Sign, 32 - PowerOfTwo, ctx);
+        const temporary_t Biased = _emit_temp(f, 'w', "add", lhs, Bias, ctx);
+        quotient = _emit_imm(f, 'w', "sar", Biased, PowerOfTwo, ctx);
+    }
+    else {
+        uint64_t magic = 0;
+        int shift = 0;
+        _magic_number(Magnitude, 31, &magic, &shift);
+
+        // Rounds down as well, adding 1 for negative numbers rounds towards zero.
+        const temporary_t Wide = _emit_unary(f, 'l', "extsw", lhs, ctx);
+        const temporary_t Product = _emit_imm(f, 'l', "mul", Wide, (int64_t)magic, ctx);
+        const temporary_t Shifted = _emit_imm(f, 'l', "sar", Product, shift, ctx);
+        const temporary_t Floor = _emit_unary(f, 'w', "copy", Shifted, ctx);
+        const temporary_t IsNegative = _emit_imm(f, 'w', "shr", lhs, 31, ctx);
+        quotient = _emit_temp(f, 'w', "add", Floor, IsNegative, ctx);
+    }
+
+    if (divisor < 0) {
+        const temporary_t Zero = _emit_constant(f, 0, ctx);
+        quotient = _emit_temp(f, 'w', "sub", Zero, quotient, ctx);
+    }
+    return quotient;
+}
+
+temporary_t qbe_generate_div_by_constant(emit_buffer_t* f, temporary_t lhs, int64_t divisor, bool is_signed, bool is_modulo, backend_ctx_t* ctx) {
+    // The divisor as the operands see it.
+    const int64_t Divisor = is_signed ? (int64_t)(int32_t)(uint32_t)divisor : (int64_t)(uint32_t)divisor;
+    DEBUG_ASSERT(Divisor != 0, "division by zero has to be left for the hardware");
+
+    // x / 1 & x / -1
+    if (Divisor == 1 || Divisor == -1) {
+        if (is_modulo) {
+            return _emit_constant(f, 0, ctx);
+        }
+        return Divisor == 1 ? _emit_unary(f, 'w', "copy", lhs, ctx) : _emit_temp(f, 'w', "sub", _emit_constant(f, 0, ctx), lhs, ctx);
+    }
+
+    // x % 2^k is a mask when unsigned.
+    if (!is_signed && is_modulo && _log2_exact((uint64_t)Divisor) >= 0) {
+        return _emit_imm(f, 'w', "and", lhs, Divisor - 1, ctx);
+    }
+
+    const temporary_t Quotient = is_signed ?
+        _signed_quotient(f, lhs, (int32_t)Divisor, ctx) :
+        _unsigned_quotient(f, lhs, (uint32_t)Divisor, ctx);
+    if (!is_modulo) {
+        return Quotient;
+    }
+
+    // x % d = x - (x / d) * d
+    const temporary_t Multiple = _emit_imm(f, 'w', "mul", Quotient, Divisor, ctx);
+    return _emit_temp(f, 'w', "sub", lhs, Multiple, ctx);
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stb/stb_ds.h>
+
+#include "../common/error.h"
+#include "../backend_qbe.h"
+
+/*
+    The IR is appended to a growable buffer, which is written out at once when the translation unit is done.
+    Temporaries, labels & integers are formatted by hand, so nothing on the hot path parses a format string;
+    'emit_format' is left for the rare cases, like floats.
+    Functions are generated on their own, so the numbers of '$str.N' & '$init.N' aren't known yet. 'emit_symbol' only
+    writes the prefix & remembers where the number goes, it's filled in when the function is joined.
+*/
+
+#define EMIT_BUFFER_MIN_CAPACITY 4096
+
+// Space for 'size' more bytes, which are counted as written.
+static char* _emit_reserve(emit_buffer_t* buffer, size_t size) {
+    if (buffer->length + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : EMIT_BUFFER_MIN_CAPACITY;
+        while (capacity < buffer->length + size) {
+            capacity *= 2;
+        }
+        buffer->data = realloc(buffer->data, capacity);
+        RUNTIME_ASSERT(buffer->data, "Could not grow the emit buffer to %zu bytes :^(", capacity);
+        buffer->capacity = capacity;
+    }
+    char* Dst = buffer->data + buffer->length;
+    buffer->length += size;
+    return Dst;
+}
+
+void emit_buffer_free(emit_buffer_t* buffer) {
+    free(buffer->data);
+    arrfree(buffer->refs);
+    *buffer = (emit_buffer_t){ 0 };
+}
+
+void emit_buffer_flush(const emit_buffer_t* buffer, FILE* f) {
+    if (buffer->length) {
+        RUNTIME_ASSERT(fwrite(buffer->data, 1, buffer->length, f) == buffer->length, "Could not write the IR");
+    }
+}
+
+void emit_bytes(emit_buffer_t* buffer, const char* bytes, size_t size) {
+    memcpy(_emit_reserve(buffer, size), bytes, size);
+}
+
+void emit_append(emit_buffer_t* buffer, const emit_buffer_t* other) {
+    for (size_t i = 0; i < arrlenu(other->refs); i++) {
+        symbol_ref_t ref = other->refs[i];
+        ref.offset += buffer->length;
+        arrput(buffer->refs, ref);
+    }
+    if (other->length) {
+        emit_bytes(buffer, other->data, other->length);
+    }
+}
+
+void emit_str(emit_buffer_t* buffer, const char* str) {
+    emit_bytes(buffer, str, strlen(str));
+}
+
+void emit_char(emit_buffer_t* buffer, char c) {
+    *_emit_reserve(buffer, 1) = c;
+}
+
+void emit_uint(emit_buffer_t* buffer, uint64_t value) {
+    // Backwards from the last digit.
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[sizeof(digits) - ++count] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    emit_bytes(buffer, digits + sizeof(digits) - count, count);
+}
+
+void emit_int(emit_buffer_t* buffer, int64_t value) {
+    if (value < 0) {
+        emit_char(buffer, '-');
+        emit_uint(buffer, 0 - (uint64_t)value);
+        return;
+    }
+    emit_uint(buffer, (uint64_t)value);
+}
+
+void emit_format(emit_buffer_t* buffer, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    const int Length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    RUNTIME_ASSERT(Length >= 0, "Invalid format '%s'", format);
+
+    // vsnprintf writes a null-terminator, which isn't counted.
+    char* dst = _emit_reserve(buffer, (size_t)Length + 1);
+    vsnprintf(dst, (size_t)Length + 1, format, args);
+    buffer->length--;
+    va_end(args);
+}
+
+void emit_temp(emit_buffer_t* buffer, temporary_t temp) {
+    emit_bytes(buffer, "%r", 2);
+    emit_uint(buffer, temp.id);
+}
+
+void emit_label(emit_buffer_t* buffer, label_t label) {
+    emit_bytes(buffer, "@l", 2);
+    emit_uint(buffer, label.id);
+}
+
+void emit_operand(emit_buffer_t* buffer, operand_t operand) {
+    if (operand.is_immediate) {
+        emit_int(buffer, operand.immediate);
+    }
+    else {
+        emit_temp(buffer, operand.temp);
+    }
+}
+
+void emit_assign(emit_buffer_t* buffer, temporary_t result, char base_type, const char* ins) {
+    emit_char(buffer, '\t');
+    emit_temp(buffer, result);
+    char* dst = _emit_reserve(buffer, 2);
+    dst[0] = '=';
+    dst[1] = base_type;
+    emit_char(buffer, ' ');
+    emit_str(buffer, ins);
+    emit_char(buffer, ' ');
+}
+
+void emit_symbol(emit_buffer_t* buffer, symbol_kind_t kind, size_t index) {
+    emit_str(buffer, kind == SYMBOL_STRING ? "$str." : "$init.");
+    const symbol_ref_t Ref = { .offset = buffer->length, .index = (uint32_t)index, .kind = kind };
+    arrput(buffer->refs, Ref);
+}
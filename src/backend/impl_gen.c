@@ -1,66 +1,177 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <ctype.h>
 #include <stb/stb_ds.h>
 
 #include "../common/error.h"
+#include "../common/string.h"
 #include "../common/utils.h"
 #include "../parser/ast_type.h"
+#include "../semantics/struct_layout.h"
 #include "../backend_qbe.h"
 #include "impl_gen.h"
 
-void qbe_generate_struct_members(FILE* f, const ast_struct_declaration_t* decl, backend_ctx_t* ctx) {
-    const size_t MemCount = arrlenu(decl->members);
-    for (size_t i = 0; i < MemCount; i++) {
-        char c = qbe_get_base_type(&decl->members[i].type);
-        if (c != '\0') {
-            fprintf(f, "%c, ", qbe_get_base_type(&decl->members[i].type));
+#define STRING_LOOKUP_MIN_CAPACITY 16
+
+// Member type for an aggregate type definition: b | h | w | l | s | d | :name
+static void _qbe_emit_member_type(emit_buffer_t* f, const datatype_t* type) {
+    if (type->kind == DATATYPE_POINTER) {
+        emit_char(f, 'l');
+        return;
+    }
+    RUNTIME_ASSERT(type->kind == DATATYPE_PRIMITIVE, "only primitive types are supported!");
+
+    switch (layout_primitive_size(type->typename)) {
+        case 1: { emit_char(f, 'b'); return; }
+        case 2: { emit_char(f, 'h'); return; }
+        case 4:
+        case 8: { emit_char(f, qbe_get_base_type(type)); return; }
+        default: { emit_char(f, ':'); emit_str(f, type->typename); return; }
+    }
+}
+
+void qbe_generate_struct_type(emit_buffer_t* f, aggregate_type_t* type, backend_ctx_t* ctx) {
+    if (type->emitted) {
+        return;
+    }
+    type->emitted = true;
+
+    // Nested types have to be defined before they're used.
+    const struct_layout_t* Layout = type->layout;
+    for (size_t i = 0; i < Layout->member_count; i++) {
+        const datatype_t* Type = Layout->members[i].type;
+        if (Type->kind == DATATYPE_ARRAY) {
+            Type = Type->base;
         }
-        else {
-            const datatype_t MemberType = decl->members[i].type; 
-            RUNTIME_ASSERT(MemberType.kind == DATATYPE_PRIMITIVE, "only primitive types are supported!");
-            const aggregate_type_t* InnerStruct = qbe_find_type(MemberType.typename, ctx);
-            qbe_generate_struct_members(f, InnerStruct->ast, ctx);
+
+        aggregate_type_t* inner = Type->kind == DATATYPE_PRIMITIVE ? qbe_find_type(Type->typename, ctx) : NULL;
+        if (inner) {
+            qbe_generate_struct_type(f, inner, ctx);
+        }
+    }
+
+    // Members in the same order, QBE computes the same offsets using natural alignment.
+    emit_str(f, "type :");
+    emit_str(f, type->name);
+    emit_str(f, " = { ");
+    for (size_t i = 0; i < Layout->member_count; i++) {
+        const datatype_t* Type = Layout->members[i].type;
+        if (Type->kind == DATATYPE_ARRAY) {
+            _qbe_emit_member_type(f, Type->base);
+            emit_char(f, ' ');
+            emit_uint(f, Type->array_size);
+            emit_str(f, ", ");
+            continue;
         }
+        _qbe_emit_member_type(f, Type);
+        emit_str(f, ", ");
     }
+    emit_str(f, "}\n");
+}
+
+// Rebuilds the lookup twice as big, so the load factor stays at or under 50%.
+static void _qbe_grow_string_lookup(backend_ctx_t* ctx) {
+    free(ctx->string_lookup);
+    ctx->string_lookup_capacity = ctx->string_lookup_capacity ? ctx->string_lookup_capacity * 2 : STRING_LOOKUP_MIN_CAPACITY;
+    ctx->string_lookup = calloc(ctx->string_lookup_capacity, sizeof(uint32_t));
+    RUNTIME_ASSERT(ctx->string_lookup, "Could not allocate the string lookup :^(");
+
+    const size_t Mask = ctx->string_lookup_capacity - 1;
+    for (size_t i = 0; i < arrlenu(ctx->strings); i++) {
+        size_t slot = str_hash(ctx->strings[i]) & Mask;
+        while (ctx->string_lookup[slot]) {
+            slot = (slot + 1) & Mask;
+        }
+        ctx->string_lookup[slot] = (uint32_t)(i + 1);
+    }
+}
+
+size_t qbe_pool_string(const char* literal, backend_ctx_t* ctx) {
+    const size_t Count = arrlenu(ctx->strings);
+    if ((Count + 1) * 2 > ctx->string_lookup_capacity) {
+        _qbe_grow_string_lookup(ctx);
+    }
+
+    const size_t Mask = ctx->string_lookup_capacity - 1;
+    size_t slot = str_hash(literal) & Mask;
+    while (ctx->string_lookup[slot]) {
+        const size_t Index = ctx->string_lookup[slot] - 1;
+        if (strcmp(ctx->strings[Index], literal) == 0) {
+            return Index;
+        }
+        slot = (slot + 1) & Mask;
+    }
+    ctx->string_lookup[slot] = (uint32_t)(Count + 1);
+    arrput(ctx->strings, literal);
+    return Count;
 }
 
 temporary_t qbe_generate_string_literal(
-    FILE* f,
-    const ast_node_t* ast
+    emit_buffer_t* f,
+    const ast_node_t* ast,
+    backend_ctx_t* ctx
 ) {
     DEBUG_ASSERT(ast && ast->kind == AST_STRING_LITERAL, "?");
 
-    const size_t AllocSize = strlen(ast->data.literal) + 1;
+    const size_t Id = qbe_pool_string(ast->data.literal, ctx);
+    const temporary_t Ptr = get_temporary(ctx);
+    emit_assign(f, Ptr, 'l', "copy");
+    emit_symbol(f, SYMBOL_STRING, Id);
+    emit_char(f, '\n');
+    return Ptr;
+}
 
-    // Allocate storage for the string
-    const temporary_t ArrayBegin  = get_temporary();
-    fprintf(f, "\t");
-    fprint_temp(f, ArrayBegin);
-    fprintf(f, "=l alloc4 %zu\n", AllocSize);
+temporary_t qbe_generate_string_array(
+    emit_buffer_t* f,
+    const ast_node_t* ast,
+    backend_ctx_t* ctx
+) {
+    DEBUG_ASSERT(ast && ast->kind == AST_STRING_LITERAL, "?");
 
-    // Store the characters from the string to the array
-    for (size_t i = 0; i < AllocSize; i++) {
-        const temporary_t IndexPtr  = get_temporary();
-        const char Char = ast->data.literal[i];
-
-        // Ptr to index
-        fprintf(f, "\t");
-        fprint_temp(f, IndexPtr);
-        fprintf(f, " =l add ");
-        fprint_temp(f, ArrayBegin);
-        fprintf(f, ", %zu # Str[%zu] \n", i, i);
-
-        // Store a byte into index
-        fprintf(f, "\tstoreb %u, ", Char);
-        fprint_temp(f, IndexPtr);
-        fprintf(f, " # Str[%zu] <- %u\n", i, Char);
+    // The pooled literal is read-only, the array gets a copy of its own.
+    const size_t AllocSize = strlen(ast->data.literal) + 1;
+    const temporary_t ArrayBegin = qbe_allocate(4, AllocSize, ctx);
+    const temporary_t Literal = qbe_generate_string_literal(f, ast, ctx);
+    qbe_generate_blit(f, Literal, ArrayBegin, AllocSize, ctx);
+    return ArrayBegin;
+}
+
+void qbe_generate_string_data(emit_buffer_t* f, const char* str) {
+    // Printable characters as strings, the rest as bytes, so nothing needs escaping.
+    while (*str) {
+        if (isprint((unsigned char)*str) && *str != '"' && *str != '\\') {
+            const char* Begin = str;
+            while (isprint((unsigned char)*str) && *str != '"' && *str != '\\') {
+                str++;
+            }
+            emit_str(f, "b \"");
+            emit_bytes(f, Begin, (size_t)(str - Begin));
+            emit_str(f, "\", ");
+        }
+        else {
+            emit_str(f, "b ");
+            emit_uint(f, (unsigned char)*str);
+            emit_str(f, ", ");
+            str++;
+        }
     }
+    emit_str(f, "b 0");
+}
 
-    return ArrayBegin;
+void qbe_generate_string_pool(emit_buffer_t* f, const backend_ctx_t* ctx) {
+    for (size_t i = 0; i < arrlenu(ctx->strings); i++) {
+        emit_str(f, "section \".rodata\" data $str.");
+        emit_uint(f, i);
+        emit_str(f, " = { ");
+        qbe_generate_string_data(f, ctx->strings[i]);
+        emit_str(f, " }\n");
+    }
 }
 
 temporary_t qbe_generate_array_initializer(
-    FILE* f,
+    emit_buffer_t* f,
     const ast_node_t* ast,
     backend_ctx_t* ctx
 ) {
@@ -71,38 +182,42 @@ temporary_t qbe_generate_array_initializer(
     const size_t ArraySize = ExprType->array_size;
     const size_t AllocSize = ArraySize * ElementSize;
 
-    // Allocate storage for the string
-    const temporary_t ArrayBegin  = get_temporary();
-    fprintf(f, "\t");
-    fprint_temp(f, ArrayBegin);
-    fprintf(f, "=l alloc4 %zu\n", AllocSize);
+    if (qbe_is_constant_initializer(ast)) {
+        return qbe_generate_constant_initializer(f, ast, ctx);
+    }
+
+    // Allocate storage for the array
+    const temporary_t ArrayBegin = qbe_allocate(ElementSize > 4 ? 8 : 4, AllocSize, ctx);
 
     // Store the characters from the string to the array
     for (size_t i = 0; i < ArraySize; i++) {
-        // Create temporary for the index
-        const temporary_t Index = get_temporary();
-        fprintf(f, "\t");
-        fprint_temp(f, Index);
-        fprintf(f, "=w copy %zu\n", i);
-        const temporary_t IndexPtr  = qbe_get_array_ptr(f, ArrayBegin, Index, ExprType->base, ctx);
+        const temporary_t IndexPtr = qbe_get_array_ptr(f, ArrayBegin, IMMEDIATE_OPERAND((int64_t)i), NULL, ExprType->base, ctx);
 
         // Get expr
-        fprintf(f, "# Array[%zu] expr \n", i);
-        const temporary_t ValueTemp  = qbe_generate_expr_node(f, ast->data.array_initializer_list.exprs[i], ctx);
-
-        // Store a byte into index
-        fprintf(f, "\t%s ", qbe_get_store_ins(ExprType->base));
-        fprint_temp(f, ValueTemp);
-        fprintf(f, ", ");
-        fprint_temp(f, IndexPtr);
-        fprintf(f, "\n");
+        emit_str(f, "# Array[");
+        emit_uint(f, i);
+        emit_str(f, "] expr \n");
+        const operand_t Value = qbe_generate_expr_node(f, ast->data.array_initializer_list.exprs[i], ctx);
+
+        // Store into index
+        qbe_generate_store(f, ExprType->base, Value, IndexPtr, ctx);
     }
 
     return ArrayBegin;
 }
 
+// The operands of a call's arguments, they're generated before the call.
+typedef struct call_operands_t {
+    operand_t* operands;
+} call_operands_t;
+
+static void _call_operands_free(void* data) {
+    call_operands_t* call = data;
+    arrfree(call->operands);
+}
+
 temporary_t qbe_generate_function_call(
-    FILE* f,
+    emit_buffer_t* f,
     const ast_node_t* ast,
     backend_ctx_t* ctx
 ) {
@@ -110,9 +225,9 @@ temporary_t qbe_generate_function_call(
     const ast_function_call_t* FuncCall = &ast->data.function_call;
 
 
-    // Make temporaries for the arguments
+    // Make operands for the arguments
     const size_t ArgCount = arrlenu(FuncCall->args);
-    temporary_t* arg_temps = NULL;
+    call_operands_t* call = unwind_alloc(sizeof(call_operands_t), _call_operands_free);
     {
         bool variadic_arguments = false;
         for (size_t i = 0; i < ArgCount; i++) {
@@ -121,38 +236,46 @@ temporary_t qbe_generate_function_call(
                 continue;
             }
 
-            temporary_t expr_temp = qbe_generate_expr_node(f, FuncCall->args[i], ctx);
+            // Passed by value, the callee gets a copy of the data & never writes to it.
+            const bool IsConstantStruct = FuncCall->args[i]->kind == AST_STRUCT_INITIALIZER_LIST &&
+                qbe_is_constant_initializer(FuncCall->args[i]);
+            operand_t expr = IsConstantStruct ?
+                TEMPORARY_OPERAND(qbe_generate_constant_argument(f, FuncCall->args[i], ctx)) :
+                qbe_generate_expr_node(f, FuncCall->args[i], ctx);
             
             // argument promotion
             // TODO: Implement ints. (only floats to doubles atm)
             if (variadic_arguments) {
                 if (strcmp(FuncCall->args[i]->expr_type.typename, "f32") == 0) {
-                    temporary_t r = get_temporary();
-                    fprintf(f, "\t");
-                    fprint_temp(f, r);
-                    fprintf(f, "=d exts ");
-                    fprint_temp(f, expr_temp);
-                    fprintf(f, "\n");
-                    expr_temp = r;
+                    temporary_t r = get_temporary(ctx);
+                    emit_assign(f, r, 'd', "exts");
+                    emit_operand(f, expr);
+                    emit_char(f, '\n');
+                    expr = TEMPORARY_OPERAND(r);
                 }
             }
 
-            arrput(arg_temps, expr_temp);
+            arrput(call->operands, expr);
         }
     }
 
-    // 
-    temporary_t r = get_temporary();
-    fprintf(f, "\t");
-    fprint_temp(f, r);
-    fprintf(f, "=%s call $%s(", qbe_get_abi_type(&ast->expr_type), FuncCall->name);
+    // The callee may write to any memory.
+    qbe_forget_loads(ctx);
+    temporary_t r = get_temporary(ctx);
+    emit_char(f, '\t');
+    emit_temp(f, r);
+    emit_char(f, '=');
+    emit_abi_type(f, &ast->expr_type);
+    emit_str(f, " call $");
+    emit_str(f, FuncCall->name);
+    emit_char(f, '(');
 
     // Pass arguments to the function call
     int was_variadic = 0; // @HACK: 
     for (size_t i = 0; i < ArgCount; i++) {
         const ast_node_t* Expr = FuncCall->args[i];
         if (Expr->data.variable_declaration.type.kind == DATATYPE_VARIADIC){
-            fprintf(f, "..., ");
+            emit_str(f, "..., ");
             was_variadic++;
             continue;
         }
@@ -160,28 +283,128 @@ temporary_t qbe_generate_function_call(
         // Account for argument promotion
         // TODO: integer promotion
         const char* arg_abi = qbe_get_abi_type(&Expr->expr_type);
-        if (was_variadic && arg_abi) {
-            if (strcmp(arg_abi, "s") == 0) {
-                arg_abi = "d";
-            }
-        }
-
-        if (arg_abi) {
-            fprintf(f, "%s ", arg_abi);
+        if (was_variadic && arg_abi && strcmp(arg_abi, "s") == 0) {
+            emit_str(f, "d ");
         } else {
-            fprintf(f, ":%s ", Expr->expr_type.typename);
+            emit_abi_type(f, &Expr->expr_type);
+            emit_char(f, ' ');
         }
 
-        fprint_temp(f, arg_temps[i-was_variadic]);
-        fprintf(f, ", ");
+        emit_operand(f, call->operands[i-was_variadic]);
+        emit_str(f, ", ");
     }
-    fprintf(f, ")\n");
-    arrfree(arg_temps);
+    emit_str(f, ")\n");
+    unwind_free(call);
     return r;
 }
 
+static void _qbe_emit_jump(emit_buffer_t* f, label_t label) {
+    emit_str(f, "\tjmp ");
+    emit_label(f, label);
+    emit_char(f, '\n');
+}
+
+/*
+    Conditions are lowered straight into branches, instead of into a 0/1 value which is then tested:
+        if a < b && c == true { ... }
+    becomes
+            %r1 =w csltw %a, %b
+            jnz %r1, @rhs, @else
+        @rhs
+            jnz %c, @then, @else
+    The right side of '&&' & '||' is only evaluated when it decides the result. A comparison right before its 'jnz' is
+    a single compare & branch for QBE.
+*/
+void qbe_generate_condition(emit_buffer_t* f, ast_node_t* cond, label_t if_true, label_t if_false, backend_ctx_t* ctx) {
+    if (cond->kind == AST_BOOL_LITERAL) {
+        _qbe_emit_jump(f, cond->data.boolean ? if_true : if_false);
+        return;
+    }
+
+    if (cond->kind == AST_BINARY_OP) {
+        const ast_binary_op_t* Op = &cond->data.binary_op;
+        switch (Op->operation) {
+            case BINARY_OP_AND:
+            case BINARY_OP_OR: {
+                const bool IsAnd = Op->operation == BINARY_OP_AND;
+                const label_t LabelRhs = get_label(ctx);
+                qbe_generate_condition(f, Op->left, IsAnd ? LabelRhs : if_true, IsAnd ? if_false : LabelRhs, ctx);
+                qbe_generate_label(f, LabelRhs, ctx);
+                qbe_generate_condition(f, Op->right, if_true, if_false, ctx);
+                return;
+            }
+
+            // 'x == true' is 'x', 'x != true' is the opposite.
+            case BINARY_OP_EQUAL:
+            case BINARY_OP_NOT_EQUAL: {
+                const bool IsEqual = Op->operation == BINARY_OP_EQUAL;
+                ast_node_t* operand = NULL;
+                bool compared_to = false;
+                if (Op->right->kind == AST_BOOL_LITERAL) {
+                    operand = Op->left;
+                    compared_to = Op->right->data.boolean;
+                }
+                else if (Op->left->kind == AST_BOOL_LITERAL) {
+                    operand = Op->right;
+                    compared_to = Op->left->data.boolean;
+                }
+
+                if (operand) {
+                    const bool Same = IsEqual == compared_to;
+                    qbe_generate_condition(f, operand, Same ? if_true : if_false, Same ? if_false : if_true, ctx);
+                    return;
+                }
+                break;
+            }
+
+            default: {
+                break;
+            }
+        }
+    }
+
+    const operand_t Value = qbe_generate_expr_node(f, cond, ctx);
+    if (Value.is_immediate) {
+        _qbe_emit_jump(f, Value.immediate ? if_true : if_false);
+        return;
+    }
+    emit_str(f, "\tjnz ");
+    emit_temp(f, Value.temp);
+    emit_str(f, ", ");
+    emit_label(f, if_true);
+    emit_str(f, ", ");
+    emit_label(f, if_false);
+    emit_char(f, '\n');
+}
+
+temporary_t qbe_generate_logical_op(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(ast && ast->kind == AST_BINARY_OP, "?");
+    DEBUG_ASSERT(ast->data.binary_op.operation == BINARY_OP_AND || ast->data.binary_op.operation == BINARY_OP_OR, "?");
+
+    // The value of the short circuiting branches.
+    const label_t LabelTrue = get_label(ctx);
+    const label_t LabelFalse = get_label(ctx);
+    const label_t LabelOut = get_label(ctx);
+    const temporary_t Result = get_temporary(ctx);
+    qbe_generate_condition(f, ast, LabelTrue, LabelFalse, ctx);
+
+    qbe_generate_label(f, LabelTrue, ctx);
+    emit_char(f, '\t');
+    emit_temp(f, Result);
+    emit_str(f, "=w copy 1\n");
+    _qbe_emit_jump(f, LabelOut);
+
+    qbe_generate_label(f, LabelFalse, ctx);
+    emit_char(f, '\t');
+    emit_temp(f, Result);
+    emit_str(f, "=w copy 0\n");
+
+    qbe_generate_label(f, LabelOut, ctx);
+    return Result;
+}
+
 temporary_t qbe_generate_while_loop(
-    FILE* f,
+    emit_buffer_t* f,
     const ast_node_t* ast,
     backend_ctx_t* ctx
 ) {
@@ -189,84 +412,185 @@ temporary_t qbe_generate_while_loop(
 
     const ast_while_loop_t* WhileLoop = &ast->data.while_loop;
 
-    const label_t LabelComparision = get_label();
-    const label_t LabelBegin = get_label();
-    const label_t LabelEnd = get_label();
-
-    // Begin label
-    fprint_label(f, LabelComparision); 
-    fprintf(f, "\n");
-
-    // Comparision
-    const temporary_t CompTemp = qbe_generate_expr_node(f, WhileLoop->expr, ctx);
-    fprintf(f, "\tjnz ");
-    fprint_temp(f, CompTemp);
-    fprintf(f, ", ");
-    fprint_label(f, LabelBegin); 
-    fprintf(f, ", ");
-    fprint_label(f, LabelEnd); 
-    fprintf(f, "\n"); 
+    /*
+        Rotated, so an iteration takes a single branch back to the body instead of a jump to the condition at the top:
+        @guard
+            jnz <cond>, @body, @end     skips a loop which runs no iterations
+        @body
+            <body>
+            jnz <cond>, @body, @end
+        @end
+    */
+    const label_t LabelGuard = get_label(ctx);
+    const label_t LabelBegin = get_label(ctx);
+    const label_t LabelEnd = get_label(ctx);
+
+    // Guard, a block of its own like an if's comparision
+    qbe_generate_label(f, LabelGuard, ctx);
+    qbe_generate_condition(f, WhileLoop->expr, LabelBegin, LabelEnd, ctx);
 
     // Body
-    fprint_label(f, LabelBegin);
-    fprintf(f, "\n"); 
+    qbe_generate_label(f, LabelBegin, ctx);
     const size_t BodyCount = arrlenu(WhileLoop->body);
     for (size_t i = 0; i < BodyCount; i++) {
         qbe_generate_expr_node(f, WhileLoop->body[i], ctx);
     }
-    fprintf(f, "\tjmp ");
-    fprint_label(f, LabelComparision); 
-    fprintf(f, "\n");
+
+    // Comparision, the back edge
+    qbe_generate_condition(f, WhileLoop->expr, LabelBegin, LabelEnd, ctx);
 
     // End Label
-    fprint_label(f, LabelEnd); 
-    fprintf(f, "\n");
+    qbe_generate_label(f, LabelEnd, ctx);
 
-    return CompTemp;
+    return NULL_TEMPORARY;
 }
 
 temporary_t qbe_generate_if_statement(
-    FILE* f,
+    emit_buffer_t* f,
     const ast_node_t* ast,
     backend_ctx_t* ctx
 ) {
     const ast_if_statement_t* IfStatement = &ast->data.if_statement;
 
-    const label_t LabelComparision = get_label();
-    const label_t LabelIf = get_label();
-    const label_t LabelElse = get_label();
-    const label_t LabelOut = get_label();
-
-    fprint_label(f, LabelComparision);
-    fprintf(f, "\n");
-    const temporary_t CompTemp = qbe_generate_expr_node(f, IfStatement->expr, ctx);
-    fprintf(f, "\tjnz ");
-    fprint_temp(f, CompTemp);
-    fprintf(f, ", ");
-    fprint_label(f, LabelIf); 
-    fprintf(f, ", ");
-    fprint_label(f, LabelElse); 
-    fprintf(f, "\n"); 
+    const label_t LabelComparision = get_label(ctx);
+    const label_t LabelIf = get_label(ctx);
+    const label_t LabelElse = get_label(ctx);
+    const label_t LabelOut = get_label(ctx);
+
+    qbe_generate_label(f, LabelComparision, ctx);
+    qbe_generate_condition(f, IfStatement->expr, LabelIf, LabelElse, ctx);
 
     // If Body
-    fprint_label(f, LabelIf);
-    fprintf(f, "\n");
+    qbe_generate_label(f, LabelIf, ctx);
     const size_t BodyCount = arrlenu(IfStatement->body);
     for (size_t i = 0; i < BodyCount; i++) {
         qbe_generate_expr_node(f, IfStatement->body[i], ctx);
     }
-    fprintf(f, "\tjmp ");
-    fprint_label(f, LabelOut);
-    fprintf(f, "\n");
+    emit_str(f, "\tjmp ");
+    emit_label(f, LabelOut);
+    emit_char(f, '\n');
 
     // Else Body
-    fprint_label(f, LabelElse);
-    fprintf(f, "\n");
+    qbe_generate_label(f, LabelElse, ctx);
     const size_t ElseBodyCount = arrlenu(IfStatement->else_body);
     for (size_t i = 0; i < ElseBodyCount; i++) {
         qbe_generate_expr_node(f, IfStatement->else_body[i], ctx);
     }
-    fprint_label(f, LabelOut);
-    fprintf(f, "\n");
-    return CompTemp;
+    qbe_generate_label(f, LabelOut, ctx);
+    return NULL_TEMPORARY;
+}
+
+// One copy of a for loop's body, with the iterator set to 'value'.
+// Variables declared in the body go out of scope after the copy.
+static void _qbe_generate_for_body(
+    emit_buffer_t* f,
+    const ast_for_loop_t* ForLoop,
+    ast_variable_declaration_t* iterator,
+    operand_t value,
+    backend_ctx_t* ctx
+) {
+    const temporary_t Iterator = get_temporary(ctx);
+    emit_assign(f, Iterator, 'w', "copy");
+    emit_operand(f, value);
+    emit_char(f, '\n');
+
+    const size_t ScopeBegin = arrlenu(ctx->variables);
+    const variable_t Var = { .var_decl = iterator, .temp = Iterator };
+    arrput(ctx->variables, Var);
+
+    const size_t BodyCount = arrlenu(ForLoop->body);
+    for (size_t i = 0; i < BodyCount; i++) {
+        qbe_generate_expr_node(f, ForLoop->body[i], ctx);
+    }
+    stbds_header(ctx->variables)->length = ScopeBegin;
+}
+
+temporary_t qbe_generate_for_loop(
+    emit_buffer_t* f,
+    const ast_node_t* ast,
+    backend_ctx_t* ctx
+) {
+    DEBUG_ASSERT(ast && ast->kind == AST_FOR_LOOP, "?");
+
+    const ast_for_loop_t* ForLoop = &ast->data.for_loop;
+    const range_t* Range = &ForLoop->iter;
+    ast_variable_declaration_t iterator = {
+        .name = ForLoop->identifier,
+        .type = { .kind = DATATYPE_PRIMITIVE, .typename = "i32" },
+    };
+
+    // The range is known at compile time, so is the trip count.
+    const int64_t Step = (int64_t)Range->step;
+    const int64_t TripCount = Range->from < Range->to ? (Range->to - Range->from + Step - 1) / Step : 0;
+    const int64_t First = Range->reverse ? Range->from + (TripCount - 1) * Step : Range->from;
+    const int64_t Direction = Range->reverse ? -Step : Step;
+    if (TripCount == 0) {
+        return NULL_TEMPORARY;
+    }
+
+    // Short loops become straight-line code.
+    if ((size_t)TripCount <= ctx->unroll_full_max_trips) {
+        for (int64_t k = 0; k < TripCount; k++) {
+            _qbe_generate_for_body(f, ForLoop, &iterator, IMMEDIATE_OPERAND(First + k * Direction), ctx);
+        }
+        return NULL_TEMPORARY;
+    }
+
+    /*
+        Longer ones run 'Factor' copies of the body per iteration, checking the counter only at the bottom, since the
+        loop runs at least once. The iterations which don't fill a whole trip are unrolled after the loop.
+            %counter =l copy <first>
+        @body
+            <body with iterator = %counter>
+            %counter =l add %counter, <step>
+            ... 'Factor' times
+            %cond =w cnel %counter, <bound>
+            jnz %cond, @body, @end
+        @end
+            <the remaining iterations>
+    */
+    const int64_t Factor = ctx->unroll_factor ? (int64_t)ctx->unroll_factor : 1;
+    const int64_t LoopTrips = TripCount / Factor;
+    if (LoopTrips) {
+        const label_t LabelBody = get_label(ctx);
+        const label_t LabelEnd = get_label(ctx);
+
+        // The counter is a long, so it can step past the last value without overflowing.
+        const temporary_t Counter = get_temporary(ctx);
+        emit_assign(f, Counter, 'l', "copy");
+        emit_int(f, First);
+        emit_char(f, '\n');
+
+        qbe_generate_label(f, LabelBody, ctx);
+        for (int64_t copy = 0; copy < Factor; copy++) {
+            _qbe_generate_for_body(f, ForLoop, &iterator, TEMPORARY_OPERAND(Counter), ctx);
+            qbe_forget_temporary(Counter, ctx);
+            emit_assign(f, Counter, 'l', "add");
+            emit_temp(f, Counter);
+            emit_str(f, ", ");
+            emit_int(f, Direction);
+            emit_char(f, '\n');
+        }
+
+        const temporary_t Cond = get_temporary(ctx);
+        emit_assign(f, Cond, 'w', "cnel");
+        emit_temp(f, Counter);
+        emit_str(f, ", ");
+        emit_int(f, First + LoopTrips * Factor * Direction);
+        emit_char(f, '\n');
+        emit_str(f, "\tjnz ");
+        emit_temp(f, Cond);
+        emit_str(f, ", ");
+        emit_label(f, LabelBody);
+        emit_str(f, ", ");
+        emit_label(f, LabelEnd);
+        emit_char(f, '\n');
+
+        qbe_generate_label(f, LabelEnd, ctx);
+    }
+
+    for (int64_t k = LoopTrips * Factor; k < TripCount; k++) {
+        _qbe_generate_for_body(f, ForLoop, &iterator, IMMEDIATE_OPERAND(First + k * Direction), ctx);
+    }
+    return NULL_TEMPORARY;
 }
@@ -7,11 +7,41 @@
 struct ast_struct_declaration_t;
 struct backend_ctx_t;
 
-temporary_t qbe_generate_string_literal(FILE* f, const struct ast_node_t* ast);
-temporary_t qbe_generate_array_initializer(FILE* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
-void qbe_generate_struct_members(FILE* f, const struct ast_struct_declaration_t* decl, struct backend_ctx_t* ctx);
-temporary_t qbe_generate_function_call(FILE* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
-temporary_t qbe_generate_while_loop(FILE* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
-temporary_t qbe_generate_if_statement(FILE* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
+size_t qbe_pool_string(const char* literal, backend_ctx_t* ctx); // identical literals share a symbol across the translation unit
+temporary_t qbe_generate_string_literal(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
+temporary_t qbe_generate_string_array(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
+void qbe_generate_string_data(emit_buffer_t* f, const char* str); // items of a data definition, including the terminator
+void qbe_generate_string_pool(emit_buffer_t* f, const backend_ctx_t* ctx);
+temporary_t qbe_generate_array_initializer(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
+void qbe_generate_struct_type(emit_buffer_t* f, aggregate_type_t* type, backend_ctx_t* ctx); // also emits the nested types
+temporary_t qbe_generate_function_call(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
+void qbe_generate_condition(emit_buffer_t* f, struct ast_node_t* cond, label_t if_true, label_t if_false, backend_ctx_t* ctx); // branches, no value
+temporary_t qbe_generate_logical_op(emit_buffer_t* f, struct ast_node_t* ast, backend_ctx_t* ctx); // '&&' & '||' as a value
+temporary_t qbe_generate_while_loop(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
+temporary_t qbe_generate_for_loop(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx); // unrolls per the ctx
+temporary_t qbe_generate_if_statement(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx);
+temporary_t qbe_generate_div_by_constant(emit_buffer_t* f, temporary_t lhs, int64_t divisor, bool is_signed, bool is_modulo, backend_ctx_t* ctx); // word operands, divisor != 0
+
+// Scalar replacement of struct locals, the generators return false for anything which isn't scalarized.
+void qbe_find_scalar_structs(struct ast_node_t* function, backend_ctx_t* ctx); // before generating the body
+bool qbe_generate_scalar_struct_declaration(emit_buffer_t* f, struct ast_node_t* ast, backend_ctx_t* ctx);
+bool qbe_generate_scalar_member_load(emit_buffer_t* f, const struct ast_node_t* get_member, backend_ctx_t* ctx, temporary_t* result);
+bool qbe_generate_scalar_member_store(emit_buffer_t* f, const struct ast_node_t* get_member, operand_t value, backend_ctx_t* ctx);
+
+// Initializers of only constants as static data, see impl_data.c
+bool qbe_is_constant_initializer(const struct ast_node_t* ast);
+void qbe_find_mutated_locals(struct ast_node_t* function, backend_ctx_t* ctx); // before generating the body
+temporary_t qbe_generate_constant_initializer(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx); // a mutable copy
+temporary_t qbe_generate_constant_argument(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx); // read only, for a struct passed by value
+temporary_t qbe_generate_initializer_template(emit_buffer_t* f, const struct ast_node_t* ast, backend_ctx_t* ctx); // constant fields, the rest zeroed
+bool qbe_generate_constant_declaration(emit_buffer_t* f, struct ast_node_t* ast, backend_ctx_t* ctx); // false if the local needs a copy
+void qbe_generate_constant_pool(emit_buffer_t* f, backend_ctx_t* ctx); // before the string pool, it can add strings
+
+// Common subexpression elimination within basic blocks, see impl_cse.c
+temporary_t qbe_emit_value(emit_buffer_t* f, const char* ins, operand_t lhs, operand_t rhs, bool is_load, backend_ctx_t* ctx); // "=l add", reuses an identical one
+void qbe_forget_temporary(temporary_t temp, backend_ctx_t* ctx); // before assigning to it
+void qbe_forget_loads(backend_ctx_t* ctx); // at stores, blits & calls
+void qbe_forget_values(backend_ctx_t* ctx);
+void qbe_generate_label(emit_buffer_t* f, label_t label, backend_ctx_t* ctx); // starts a basic block
 
 #endif
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <string.h>
+#include <stb/stb_ds.h>
+
+#include "../common/error.h"
+#include "../parser/ast_type.h"
+#include "../parser/ast_visit.h"
+#include "../semantics/struct_layout.h"
+#include "../backend_qbe.h"
+#include "impl_gen.h"
+
+/*
+    Scalar replacement of struct locals.
+    A struct local which is only ever used as 'local.member' can't be seen through a pointer, so instead of
+    'alloc8' & loads/stores, every member lives in a temporary of its own:
+        let c: Color = Color { r: 1, g: 2 };    %r1 =w copy 1, %r2 =w copy 2
+        c.g = c.r;                              %r2 =w copy %r1
+    Anything else escapes: passing or returning it, 'let b = c;', '&c.r'... Nested struct & array members are memory
+    as well, so only structs of scalar members qualify.
+    Names are unique per function for the analysis: sibling scopes declaring the same name all have to qualify.
+*/
+
+typedef struct sroa_analysis_t {
+    const backend_ctx_t* ctx;
+    const char** candidates;
+    const char** escaped;
+} sroa_analysis_t;
+
+static void _sroa_analysis_free(void* data) {
+    sroa_analysis_t* analysis = data;
+    arrfree(analysis->candidates);
+    arrfree(analysis->escaped);
+}
+
+static const aggregate_type_t* _struct_type(const datatype_t* type, const backend_ctx_t* ctx) {
+    if (type->kind != DATATYPE_PRIMITIVE) {
+        return NULL;
+    }
+    return qbe_find_type(type->typename, ctx);
+}
+
+static bool _has_only_scalar_members(const aggregate_type_t* type) {
+    for (size_t i = 0; i < type->layout->member_count; i++) {
+        const datatype_t* MemberType = type->layout->members[i].type;
+        if (MemberType->kind == DATATYPE_ARRAY) {
+            return false;
+        }
+        if (MemberType->kind != DATATYPE_POINTER && !qbe_get_base_type(MemberType)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static ast_visit_result_t _sroa_analyze(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    sroa_analysis_t* analysis = user;
+
+    switch (ast->kind) {
+        case AST_VARIABLE_DECLARATION: {
+            const ast_variable_declaration_t* Decl = &ast->data.variable_declaration;
+            const aggregate_type_t* Type = Decl->name ? _struct_type(&Decl->type, analysis->ctx) : NULL;
+            if (!Type) {
+                break;
+            }
+
+            const bool Qualifies = Decl->expr && Decl->expr->kind == AST_STRUCT_INITIALIZER_LIST && _has_only_scalar_members(Type);
+            if (Qualifies) {
+                arrput(analysis->candidates, Decl->name);
+            }
+            else {
+                arrput(analysis->escaped, Decl->name);
+            }
+            break;
+        }
+
+        case AST_GET_VARIABLE: {
+            // The only use which doesn't need the address.
+            const bool IsMemberBase = visit->parent && visit->parent->kind == AST_GET_MEMBER;
+            if (!IsMemberBase) {
+                arrput(analysis->escaped, ast->data.literal);
+            }
+            break;
+        }
+
+        case AST_UNARY_OP: {
+            if (ast->data.unary_op.operation != UNARY_OP_ADDRESS_OF) {
+                break;
+            }
+            const ast_node_t* Operand = ast->data.unary_op.operand;
+            while (Operand->kind == AST_GET_MEMBER) {
+                Operand = Operand->data.get_member.expr;
+            }
+            if (Operand->kind == AST_GET_VARIABLE) {
+                arrput(analysis->escaped, Operand->data.literal);
+            }
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+void qbe_find_scalar_structs(ast_node_t* function, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(function->kind == AST_FUNCTION_DECLARATION, "?");
+    if (ctx->scalar_structs) {
+        stbds_header(ctx->scalar_structs)->length = 0;
+    }
+    if (!ctx->scalar_replacement) {
+        return;
+    }
+
+    sroa_analysis_t* analysis = unwind_alloc(sizeof(sroa_analysis_t), _sroa_analysis_free);
+    analysis->ctx = ctx;
+    const ast_visitor_t Visitor = { .pre = _sroa_analyze, .user = analysis };
+    for (size_t i = 0; i < arrlenu(function->data.function_declaration.body); i++) {
+        ast_visit(&function->data.function_declaration.body[i], &Visitor);
+    }
+
+    for (size_t i = 0; i < arrlenu(analysis->candidates); i++) {
+        const char* Name = analysis->candidates[i];
+        if (!str_array_contains(analysis->escaped, Name) && !str_array_contains(ctx->scalar_structs, Name)) {
+            arrput(ctx->scalar_structs, Name);
+        }
+    }
+    unwind_free(analysis);
+}
+
+// The member's temporary, NULL_TEMPORARY if 'get_member' isn't a member of a scalarized struct.
+static temporary_t _member_temporary(const ast_node_t* get_member, backend_ctx_t* ctx) {
+    const ast_node_t* Base = get_member->data.get_member.expr;
+    if (Base->kind != AST_GET_VARIABLE) {
+        return NULL_TEMPORARY;
+    }
+    const variable_t* Var = qbe_find_variable(Base->data.literal, ctx);
+    if (!Var || !Var->scalarized) {
+        return NULL_TEMPORARY;
+    }
+    DEBUG_ASSERT(get_member->data.get_member.resolved, "Member '%s' was not resolved!", get_member->data.get_member.member);
+    return (temporary_t){ .id = Var->temp.id + (uint32_t)get_member->data.get_member.resolved->index };
+}
+
+// Memory would truncate narrow members on a store, a temporary has to do it explicitly.
+static void _qbe_set_member(emit_buffer_t* f, temporary_t member, operand_t value, const datatype_t* type, backend_ctx_t* ctx) {
+    const char* Ins = "copy";
+    if (type->kind == DATATYPE_PRIMITIVE) {
+        const char* Name = type->typename;
+        if (!strcmp(Name, "bool") || !strcmp(Name, "char") || !strcmp(Name, "u8")) { Ins = "extub"; }
+        else if (!strcmp(Name, "i8"))  { Ins = "extsb"; }
+        else if (!strcmp(Name, "u16")) { Ins = "extuh"; }
+        else if (!strcmp(Name, "i16")) { Ins = "extsh"; }
+    }
+
+    qbe_forget_temporary(member, ctx);
+    emit_assign(f, member, qbe_get_base_type(type), Ins);
+    emit_operand(f, value);
+    emit_char(f, '\n');
+}
+
+bool qbe_generate_scalar_struct_declaration(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
+    ast_variable_declaration_t* decl = &ast->data.variable_declaration;
+    if (!decl->name || !str_array_contains(ctx->scalar_structs, decl->name)) {
+        return false;
+    }
+
+    const aggregate_type_t* Type = _struct_type(&decl->type, ctx);
+    const struct_layout_t* Layout = Type->layout;
+    const ast_struct_initializer_list_t* InitList = &decl->expr->data.struct_initializer_list;
+
+    // Members are consecutive temporaries, uninitialized ones are zero.
+    const temporary_t First = get_temporary(ctx);
+    for (size_t i = 1; i < Layout->member_count; i++) {
+        get_temporary(ctx);
+    }
+    for (size_t i = 0; i < Layout->member_count; i++) {
+        emit_assign(f, (temporary_t){ .id = First.id + (uint32_t)i }, qbe_get_base_type(Layout->members[i].type), "copy");
+        emit_str(f, "0\n");
+    }
+    for (size_t i = 0; i < arrlenu(InitList->fields); i++) {
+        const struct_member_t* Member = InitList->fields[i].member;
+        DEBUG_ASSERT(Member, "Field '%s' was not resolved!", InitList->fields[i].name);
+        const operand_t Value = qbe_generate_expr_node(f, InitList->fields[i].expr, ctx);
+        _qbe_set_member(f, (temporary_t){ .id = First.id + (uint32_t)Member->index }, Value, Member->type, ctx);
+    }
+
+    const variable_t Var = { .var_decl = decl, .temp = First, .scalarized = true };
+    arrput(ctx->variables, Var);
+    return true;
+}
+
+bool qbe_generate_scalar_member_load(emit_buffer_t* f, const ast_node_t* get_member, backend_ctx_t* ctx, temporary_t* result) {
+    const temporary_t Member = _member_temporary(get_member, ctx);
+    if (!Member.id) {
+        return false;
+    }
+
+    // A copy, so the result doesn't change with the member.
+    *result = get_temporary(ctx);
+    emit_assign(f, *result, qbe_get_base_type(&get_member->expr_type), "copy");
+    emit_temp(f, Member);
+    emit_char(f, '\n');
+    return true;
+}
+
+bool qbe_generate_scalar_member_store(emit_buffer_t* f, const ast_node_t* get_member, operand_t value, backend_ctx_t* ctx) {
+    const temporary_t Member = _member_temporary(get_member, ctx);
+    if (!Member.id) {
+        return false;
+    }
+    _qbe_set_member(f, Member, value, get_member->data.get_member.resolved->type, ctx);
+    return true;
+}
@@ -1,43 +1,124 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <stb/stb_ds.h>
 
 #include "common/error.h"
+#include "common/thread_pool.h"
+#include "common/string.h"
 #include "common/utils.h"
+#include "cli/cli.h"
 #include "parser/ast_type.h"
+#include "parser/ast_visit.h"
+#include "semantics/struct_layout.h"
 #include "backend_qbe.h"
 #include "backend/impl_gen.h"
 
-temporary_t get_temporary(void) {
-    static uint32_t s_Id = 1;
-    return (temporary_t){.id = s_Id++};
+temporary_t get_temporary(backend_ctx_t* ctx) {
+    return (temporary_t){.id = ++ctx->temporary_count};
 }
 
-label_t get_label(void) {
-    static uint32_t s_Id = 1;
-    return (label_t){.id = s_Id++};
+label_t get_label(backend_ctx_t* ctx) {
+    return (label_t){.id = ++ctx->label_count};
 }
 
-void fprint_temp(FILE* f, temporary_t temp) {
-    fprintf(f, "%%r%u", temp.id);
-} 
+temporary_t qbe_allocate(size_t alignment, size_t size, backend_ctx_t* ctx) {
+    DEBUG_ASSERT(alignment == 4 || alignment == 8 || alignment == 16, "invalid alignment %zu", alignment);
+    const allocation_t Allocation = { .temp = get_temporary(ctx), .alignment = alignment, .size = size };
+    arrput(ctx->allocations, Allocation);
+    return Allocation.temp;
+}
 
-void fprint_label(FILE* f, label_t temp) {
-    fprintf(f, "@l%u", temp.id);
+void qbe_generate_blit(emit_buffer_t* f, temporary_t src, temporary_t dst, size_t size, backend_ctx_t* ctx) {
+    emit_str(f, "\tblit ");
+    emit_temp(f, src);
+    emit_str(f, ", ");
+    emit_temp(f, dst);
+    emit_str(f, ", ");
+    emit_uint(f, size);
+    emit_char(f, '\n');
+    qbe_forget_loads(ctx);
+}
+
+void qbe_generate_store(emit_buffer_t* f, const datatype_t* type, operand_t value, temporary_t ptr, backend_ctx_t* ctx) {
+    // An aggregate's value is its address, the whole of it is moved at once.
+    if (qbe_is_aggregate(type)) {
+        qbe_generate_blit(f, value.temp, ptr, qbe_get_type_size(type, ctx), ctx);
+        return;
+    }
+
+    emit_char(f, '\t');
+    emit_str(f, qbe_get_store_ins(type));
+    emit_char(f, ' ');
+    emit_operand(f, value);
+    emit_str(f, ", ");
+    emit_temp(f, ptr);
+    emit_char(f, '\n');
+    qbe_forget_loads(ctx);
+}
+
+temporary_t qbe_operand_to_temporary(emit_buffer_t* f, operand_t operand, char base_type, backend_ctx_t* ctx) {
+    if (!operand.is_immediate) {
+        return operand.temp;
+    }
+    const temporary_t Temp = get_temporary(ctx);
+    emit_assign(f, Temp, base_type, "copy");
+    emit_int(f, operand.immediate);
+    emit_char(f, '\n');
+    return Temp;
 }
 
 aggregate_type_t* qbe_find_type(const char* name, const backend_ctx_t* ctx) {
-    // Search for temp
-    size_t TypeCount = arrlenu(ctx->types);
-    for (size_t i = 0; i < TypeCount; i++) {
-        if (strcmp(ctx->types[i].ast->name, name) == 0) {
-            return &ctx->types[i];
-        }
+    if (!ctx->type_lookup_capacity) {
+        return NULL;
     }
 
+    const size_t Mask = ctx->type_lookup_capacity - 1;
+    size_t slot = str_hash(name) & Mask;
+    while (ctx->type_lookup[slot]) {
+        aggregate_type_t* type = &ctx->types[ctx->type_lookup[slot] - 1];
+        if (strcmp(type->name, name) == 0) {
+            return type;
+        }
+        slot = (slot + 1) & Mask;
+    }
     return NULL;
 }
 
+static void _qbe_register_types(ast_node_t* ast, backend_ctx_t* ctx) {
+    const size_t Len = arrlenu(ast->data.translation_unit.body);
+    for (size_t i = 0; i < Len; i++) {
+        ast_node_t* node = ast->data.translation_unit.body[i];
+        if (node->kind != AST_STRUCT_DECLARATION) {
+            continue;
+        }
+
+        ast_struct_declaration_t* decl = &node->data.struct_declaration;
+        DEBUG_ASSERT(decl->layout, "Struct '%s' has no layout, was semantic analysis run?", decl->name);
+        const aggregate_type_t Type = { .name = decl->name, .ast = decl, .layout = decl->layout, .emitted = false };
+        arrput(ctx->types, Type);
+    }
+
+    // Keep the load factor at or under 50%.
+    const size_t TypeCount = arrlenu(ctx->types);
+    ctx->type_lookup_capacity = 1;
+    while (ctx->type_lookup_capacity < TypeCount * 2) {
+        ctx->type_lookup_capacity <<= 1;
+    }
+    ctx->type_lookup = calloc(ctx->type_lookup_capacity, sizeof(uint32_t));
+    RUNTIME_ASSERT(ctx->type_lookup, "Could not allocate the type lookup :^(");
+
+    // Names are unique, checked by the semantic analysis.
+    const size_t Mask = ctx->type_lookup_capacity - 1;
+    for (size_t i = 0; i < TypeCount; i++) {
+        size_t slot = str_hash(ctx->types[i].name) & Mask;
+        while (ctx->type_lookup[slot]) {
+            slot = (slot + 1) & Mask;
+        }
+        ctx->type_lookup[slot] = (uint32_t)(i + 1);
+    }
+}
+
 size_t qbe_get_type_size(const datatype_t* type, const backend_ctx_t* ctx) {
     /*
         Cheatsheet:
@@ -62,24 +143,14 @@ size_t qbe_get_type_size(const datatype_t* type, const backend_ctx_t* ctx) {
         }
 
         case DATATYPE_PRIMITIVE: {
-#define IF_TYPE_RET(s1, ret) if (strcmp(type->typename, s1) == 0) { return ret; } 
-            IF_TYPE_RET("char", 1);
-            IF_TYPE_RET("i8", 1);
-            IF_TYPE_RET("u8", 1);
-            IF_TYPE_RET("i16", 2);
-            IF_TYPE_RET("u16", 2);
-            IF_TYPE_RET("i32", 4);
-            IF_TYPE_RET("u32", 4);
-            IF_TYPE_RET("i64", 8);
-            IF_TYPE_RET("u64", 8);
-
-            IF_TYPE_RET("f32", 4);
-            IF_TYPE_RET("f64", 8);
-#undef IF_TYPE_RET
+            const size_t PrimitiveSize = layout_primitive_size(type->typename);
+            if (PrimitiveSize) {
+                return PrimitiveSize;
+            }
 
-            aggregate_type_t* t = qbe_find_type(type->typename, ctx);
+            const aggregate_type_t* t = qbe_find_type(type->typename, ctx);
             DEBUG_ASSERT(t, "Size not implemented for type '%s'", type->typename);
-            return qbe_get_aggregate_type_size(t, ctx);
+            return qbe_get_aggregate_type_size(t);
         }
 
         default: {
@@ -90,16 +161,8 @@ size_t qbe_get_type_size(const datatype_t* type, const backend_ctx_t* ctx) {
     return 0;
 }
 
-size_t qbe_get_aggregate_type_size(aggregate_type_t* t, const backend_ctx_t* ctx) {
-    const size_t MemberCount = arrlenu(t->ast->members);
-
-    size_t size = 0;
-    for (size_t i = 0; i < MemberCount; i++) {
-        // @FIXME: aggregate types cannot contain other aggregate types.
-
-        size += qbe_get_type_size(&t->ast->members[i].type, ctx);
-    }
-    return size;
+size_t qbe_get_aggregate_type_size(const aggregate_type_t* t) {
+    return t->layout->size;
 }
 
 bool qbe_is_type_signed(const datatype_t* type) {
@@ -133,30 +196,10 @@ bool qbe_is_type_signed(const datatype_t* type) {
     return 0;
 }
 
-size_t qbe_get_type_member_offset(const aggregate_type_t* t, const char* member_name, const backend_ctx_t* ctx) {
-    const size_t MemberCount = arrlenu(t->ast->members);
-
-    size_t offset = 0;
-    for (size_t i = 0; i < MemberCount; i++) {
-        // @FIXME: aggregate types cannot contain other aggregate types.
-        if (strcmp(t->ast->members[i].name, member_name) == 0) {
-            return offset;
-        }
-        offset += qbe_get_type_size(&t->ast->members[i].type, ctx);
-    }
-    return offset;
-}
-
-size_t qbe_get_type_member_index(aggregate_type_t* t, const char* member_name) {
-    const size_t MemberCount = arrlenu(t->ast->members);
-    for (size_t i = 0; i < MemberCount; i++) {
-        // @FIXME: aggregate types cannot contain other aggregate types.
-        if (strcmp(t->ast->members[i].name, member_name) == 0) {
-            return i;
-        }
-    }
-    PANIC("not found!");
-    return 0;
+size_t qbe_get_type_member_offset(const aggregate_type_t* t, const char* member_name) {
+    const struct_member_t* Member = struct_layout_find_member(t->layout, member_name);
+    DEBUG_ASSERT(Member, "Struct '%s' has no member called '%s'!", t->ast->name, member_name);
+    return Member->offset;
 }
 
 const char* qbe_get_store_ins(const datatype_t* register_type) {
@@ -168,6 +211,7 @@ const char* qbe_get_store_ins(const datatype_t* register_type) {
 
         case DATATYPE_PRIMITIVE: {
 #define IF_TYPE_RET(s1, ret) if (strcmp(register_type->typename, s1) == 0) { return ret; } 
+            IF_TYPE_RET("bool", "storeb");
             IF_TYPE_RET("char", "storeb");
             IF_TYPE_RET("i8", "storeb");
             IF_TYPE_RET("u8", "storeb");
@@ -196,11 +240,12 @@ const char* qbe_get_load_ins(const datatype_t* register_type) {
     switch (register_type->kind) {
         case DATATYPE_ARRAY:
         case DATATYPE_POINTER: {
-            return "loadl";
+            return "=l loadl";
         }
 
         case DATATYPE_PRIMITIVE: {
 #define IF_TYPE_RET(s1, ret) if (strcmp(register_type->typename, s1) == 0) { return ret; } 
+            IF_TYPE_RET("bool", "=w loadub");
             IF_TYPE_RET("char", "=w loadub");
             IF_TYPE_RET("i8"  , "=w loadsb");
             IF_TYPE_RET("u8"  , "=w loadub");
@@ -296,76 +341,127 @@ const char* qbe_get_abi_type(const datatype_t* register_type) {
     return 0;
 }
 
-temporary_t qbe_get_ptr_with_offset(FILE* f, temporary_t begin_ptr, temporary_t offset) {
-    // @FIXME: Casts a temporary to long, even thought it already might be :)
-    // Produces the following code:
-    //  %casted_offset =l extsw % offset
-    //  %ptr_with_offset =l add %arr_begin, %offset 
+void emit_abi_type(emit_buffer_t* f, const datatype_t* type) {
+    const char* Abi = qbe_get_abi_type(type);
+    if (Abi) {
+        emit_str(f, Abi);
+    }
+    else {
+        emit_char(f, ':');
+        emit_str(f, type->typename);
+    }
+}
 
-    // Casted index
-    temporary_t casted_index = get_temporary();
-    fprintf(f, "\t");
-    fprint_temp(f, casted_index);
-    fprintf(f, "=l extsw "); //! 'extsw' converts a signed word to a long here.
-    fprint_temp(f, offset);
+temporary_t qbe_get_ptr_with_offset(emit_buffer_t* f, temporary_t begin_ptr, operand_t offset, backend_ctx_t* ctx) {
+    // The offset is a long already, a constant one is added as is:
+    //  %ptr_with_offset =l add %arr_begin, %offset
+    if (offset.is_immediate && offset.immediate == 0) {
+        return begin_ptr;
+    }
 
     // Get address for index
-    temporary_t ptr = get_temporary();
-    fprintf(f, "\n\t");
-    fprint_temp(f, ptr);
-    fprintf(f, "=l add ");
-    fprint_temp(f, begin_ptr);
-    fprintf(f, ", ");
-    fprint_temp(f, casted_index);
-    fprintf(f, "\n");
-
-    return ptr;
+    return qbe_emit_value(f, "=l add", TEMPORARY_OPERAND(begin_ptr), offset, false, ctx);
 }
 
 temporary_t qbe_get_array_ptr(
-    FILE* f,
+    emit_buffer_t* f,
     temporary_t array_ptr,
-    temporary_t index_temp,
+    operand_t index,
+    const datatype_t* index_type,
     const datatype_t* element_type,
-    const backend_ctx_t* ctx
+    backend_ctx_t* ctx
 ) {
-    // @FIXME: Casts a temporary to long, even thought it already might be :)
     // Index operator: e.g
-    // %ptr =l add %arr_begin, (size_of*i)
+    //  %offset =l extsw %i         only for a word index
+    //  %offset =l shl %offset, 2   a 'mul' for sizes which aren't a power of 2
+    //  %ptr =l add %arr_begin, %offset
+    const size_t ElementSize = qbe_get_type_size(element_type, ctx);
+
+    // A constant index is a constant offset.
+    if (index.is_immediate) {
+        return qbe_get_ptr_with_offset(f, array_ptr, IMMEDIATE_OPERAND(index.immediate * (int64_t)ElementSize), ctx);
+    }
     
-    // Casted index
-    temporary_t casted_index = get_temporary();
-    fprintf(f, "\t");
-    fprint_temp(f, casted_index);
-    fprintf(f, "=l extsw "); //! 'extsw' converts a signed word to a long here.
-    fprint_temp(f, index_temp);
+    // Casted index, a long index is one already
+    temporary_t offset = index.temp;
+    if (qbe_get_base_type(index_type) != 'l') {
+        const char* Ext = qbe_is_type_signed(index_type) ? "=l extsw" : "=l extuw";
+        offset = qbe_emit_value(f, Ext, index, NULL_OPERAND, false, ctx);
+    }
 
     // Multiply index with size of an element in the array
-    const size_t ElementSize = qbe_get_type_size(element_type, ctx);
     if (ElementSize > 1) {
-        fprintf(f, "\n\t");
-        fprint_temp(f, casted_index);
-        fprintf(f, "=l mul %zu, ", ElementSize);
-        fprint_temp(f, casted_index);
+        const bool IsPowerOf2 = (ElementSize & (ElementSize - 1)) == 0;
+        offset = IsPowerOf2 ?
+            qbe_emit_value(f, "=l shl", TEMPORARY_OPERAND(offset), IMMEDIATE_OPERAND(__builtin_ctzll(ElementSize)), false, ctx) :
+            qbe_emit_value(f, "=l mul", TEMPORARY_OPERAND(offset), IMMEDIATE_OPERAND((int64_t)ElementSize), false, ctx);
     }
 
-    // Get address for index
-    temporary_t ptr = get_temporary();
-    fprintf(f, "\n\t");
-    fprint_temp(f, ptr);
-    fprintf(f, "=l add ");
-    fprint_temp(f, array_ptr);
-    fprintf(f, ", ");
-    fprint_temp(f, casted_index);
-    fprintf(f, "\n");
+    return qbe_get_ptr_with_offset(f, array_ptr, TEMPORARY_OPERAND(offset), ctx);
+}
+
+bool qbe_is_aggregate(const datatype_t* type) {
+    return type->kind == DATATYPE_ARRAY || (type->kind == DATATYPE_PRIMITIVE && !qbe_get_base_type(type));
+}
+
+temporary_t qbe_generate_access_ptr(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
+    // Constant indices & members of the accesses, down to the first which isn't one, are a single offset:
+    //  'a.b[2].c' is '%a + (offsetof(b) + 2 * sizeof(b[0]) + offsetof(c))'
+    int64_t offset = 0;
+    ast_node_t* base = ast;
+    for (;;) {
+        if (base->kind == AST_GET_MEMBER && qbe_is_aggregate(&base->data.get_member.expr->expr_type)) {
+            DEBUG_ASSERT(base->data.get_member.resolved, "Member '%s' was not resolved!", base->data.get_member.member);
+            offset += (int64_t)base->data.get_member.resolved->offset;
+            base = base->data.get_member.expr;
+            continue;
+        }
+
+        const bool IsConstantIndex = base->kind == AST_BINARY_OP &&
+            base->data.binary_op.operation == BINARY_OP_ARRAY_INDEX &&
+            base->data.binary_op.right->kind == AST_INTEGER_LITERAL;
+        if (IsConstantIndex) {
+            offset += base->data.binary_op.right->data.integer * (int64_t)qbe_get_type_size(&base->expr_type, ctx);
+            base = base->data.binary_op.left;
+            continue;
+        }
+        break;
+    }
+
+    temporary_t ptr = NULL_TEMPORARY;
+    if (base->kind == AST_BINARY_OP && base->data.binary_op.operation == BINARY_OP_ARRAY_INDEX) {
+        ast_node_t* Array = base->data.binary_op.left;
+        ast_node_t* Index = base->data.binary_op.right;
+        const temporary_t ArrayPtr = qbe_operand_to_temporary(f, qbe_generate_expr_node(f, Array, ctx), 'l', ctx);
+        const operand_t IndexValue = qbe_generate_expr_node(f, Index, ctx);
+        ptr = qbe_get_array_ptr(f, ArrayPtr, IndexValue, &Index->expr_type, &base->expr_type, ctx);
+    }
+    else if (base->kind == AST_GET_MEMBER) {
+        // Of a pointer to a struct.
+        const temporary_t Struct = qbe_operand_to_temporary(f, qbe_generate_expr_node(f, base->data.get_member.expr, ctx), 'l', ctx);
+        ptr = qbe_get_ptr_with_offset(f, Struct, IMMEDIATE_OPERAND((int64_t)base->data.get_member.resolved->offset), ctx);
+    }
+    else {
+        // The array or struct itself, or a pointer to one.
+        ptr = qbe_operand_to_temporary(f, qbe_generate_expr_node(f, base, ctx), 'l', ctx);
+    }
+    return qbe_get_ptr_with_offset(f, ptr, IMMEDIATE_OPERAND(offset), ctx);
+}
+
+// An element or a member, loaded unless it's an array or a struct.
+static temporary_t _qbe_generate_access(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
+    const temporary_t Ptr = qbe_generate_access_ptr(f, ast, ctx);
+    if (qbe_is_aggregate(&ast->expr_type)) {
+        return Ptr;
+    }
 
-    return ptr;
+    // Get memory from that index
+    return qbe_emit_value(f, qbe_get_load_ins(&ast->expr_type), TEMPORARY_OPERAND(Ptr), NULL_OPERAND, true, ctx);
 }
 
 variable_t* qbe_find_variable(const char* name, backend_ctx_t* ctx) {
-    // Search for temp
-    size_t VarLen = arrlenu(ctx->variables);
-    for (size_t i = 0; i < VarLen; i++) {
+    // Search for temp, the latest declaration is the one in scope.
+    for (size_t i = arrlenu(ctx->variables); i-- > 0;) {
         if (strcmp(ctx->variables[i].var_decl->name, name) == 0) {
             return &ctx->variables[i];
         }
@@ -374,28 +470,235 @@ variable_t* qbe_find_variable(const char* name, backend_ctx_t* ctx) {
     return NULL;
 }
 
-temporary_t qbe_generate_expr_node(FILE* f, ast_node_t* ast, backend_ctx_t* ctx) {
+/*
+    Instructions for the operand's type. Arithmetic takes its width from the result, '=l add', while a comparison names
+    the width of its operands in the instruction, 'csltl'. Floats have no signedness, nor remainders or shifts.
+*/
+typedef struct binary_ins_t {
+    op_t operation;
+    const char* signed_ins;
+    const char* unsigned_ins;
+    const char* float_ins;
+    bool is_comparision;
+} binary_ins_t;
+
+static const binary_ins_t s_BinaryInstructions[] = {
+    { BINARY_OP_ADD,                    "add",  "add",  "add",  false },
+    { BINARY_OP_SUBTRACT,               "sub",  "sub",  "sub",  false },
+    { BINARY_OP_MULTIPLY,               "mul",  "mul",  "mul",  false },
+    { BINARY_OP_DIVIDE,                 "div",  "udiv", "div",  false },
+    { BINARY_OP_MODULO,                 "rem",  "urem", NULL,   false },
+    { BINARY_OP_SHIFT_LEFT,             "shl",  "shl",  NULL,   false },
+    { BINARY_OP_LESS_THAN,              "cslt", "cult", "clt",  true  },
+    { BINARY_OP_LESS_OR_EQUAL_THAN,     "csle", "cule", "cle",  true  },
+    { BINARY_OP_GREATER_THAN,           "csgt", "cugt", "cgt",  true  },
+    { BINARY_OP_GREATER_OR_EQUAL_THAN,  "csge", "cuge", "cge",  true  },
+    { BINARY_OP_EQUAL,                  "ceq",  "ceq",  "ceq",  true  },
+    { BINARY_OP_NOT_EQUAL,              "cne",  "cne",  "cne",  true  },
+};
+
+static const binary_ins_t* _qbe_find_binary_ins(op_t operation) {
+    for (size_t i = 0; i < sizeof(s_BinaryInstructions) / sizeof(s_BinaryInstructions[0]); i++) {
+        if (s_BinaryInstructions[i].operation == operation) {
+            return &s_BinaryInstructions[i];
+        }
+    }
+    return NULL;
+}
+
+// Operands are already generated.
+static temporary_t _qbe_emit_binary_op(emit_buffer_t* f, ast_node_t* ast, operand_t lhs, operand_t rhs, backend_ctx_t* ctx) {
+    const datatype_t* OperandType = &ast->data.binary_op.left->expr_type;
+    const binary_ins_t* Ins = _qbe_find_binary_ins(ast->data.binary_op.operation);
+    if (!Ins) {
+        PANIC("Op not implemented %u", ast->data.binary_op.operation);
+    }
+    const bool is_comparision = Ins->is_comparision;
+    const bool is_division = Ins->operation == BINARY_OP_DIVIDE || Ins->operation == BINARY_OP_MODULO;
+
+    // cast to right type lengths, immediates already are
+    if (is_comparision || is_division) {
+        const datatype_t* LhsType = &ast->data.binary_op.left->expr_type;
+        const datatype_t* RhsType = &ast->data.binary_op.right->expr_type;
+
+        if (LhsType->kind == DATATYPE_PRIMITIVE && RhsType->kind == DATATYPE_PRIMITIVE) {
+        // Into new temporaries, the operands may be variables or reused values.
+        #define IF_TYPE(comp_type, ins)                                                         \
+            if (!lhs.is_immediate && strcmp(LhsType->typename, comp_type) == 0) {               \
+                lhs = TEMPORARY_OPERAND(qbe_emit_value(f, "=w " ins, lhs, NULL_OPERAND, false, ctx)); \
+            }                                                                                   \
+            if (!rhs.is_immediate && strcmp(RhsType->typename, comp_type) == 0) {               \
+                rhs = TEMPORARY_OPERAND(qbe_emit_value(f, "=w " ins, rhs, NULL_OPERAND, false, ctx)); \
+            }
+
+            IF_TYPE("bool", "extub");
+            IF_TYPE("char", "extub");
+            IF_TYPE("u8", "extub");
+            IF_TYPE("i8", "extsb");
+            IF_TYPE("u16", "extuh");
+            IF_TYPE("i16", "extsh");
+
+        #undef IF_TYPE
+        }
+    }
+
+    const char OperandBase = qbe_get_base_type(OperandType);
+    const bool IsFloat = OperandBase == 's' || OperandBase == 'd';
+    if (is_division && !IsFloat) {
+        const ast_node_t* Rhs = ast->data.binary_op.right;
+        const bool IsSigned = qbe_is_type_signed(OperandType);
+        const bool IsModulo = ast->data.binary_op.operation == BINARY_OP_MODULO;
+
+        // By a constant: shifts or a multiplication, dividing by zero is left to trap at runtime.
+        const bool IsWord = qbe_get_base_type(&ast->expr_type) == 'w';
+        if (IsWord && Rhs->kind == AST_INTEGER_LITERAL && (uint32_t)Rhs->data.integer != 0) {
+            return qbe_generate_div_by_constant(f, qbe_operand_to_temporary(f, lhs, 'w', ctx), Rhs->data.integer, IsSigned, IsModulo, ctx);
+        }
+    }
+
+    const char* Name = NULL;
+    if (IsFloat) {
+        Name = Ins->float_ins;
+    }
+    else if (!strcmp(Ins->signed_ins, Ins->unsigned_ins)) {
+        Name = Ins->signed_ins;
+    }
+    else {
+        Name = qbe_is_type_signed(OperandType) ? Ins->signed_ins : Ins->unsigned_ins;
+    }
+    if (!Name) {
+        PANIC("Op %u not implemented for floats", Ins->operation);
+    }
+
+    char ins[16];
+    if (is_comparision) {
+        snprintf(ins, sizeof(ins), "=w %s%c", Name, OperandBase);
+    }
+    else {
+        snprintf(ins, sizeof(ins), "=%c %s", qbe_get_base_type(&ast->expr_type), Name);
+    }
+    return qbe_emit_value(f, ins, lhs, rhs, false, ctx);
+}
+
+static temporary_t _qbe_emit_negate(emit_buffer_t* f, ast_node_t* ast, operand_t expr, backend_ctx_t* ctx) {
+    // floats have no integer immediates for a 'mul'
+    const char* Ins = NULL;
+    switch (qbe_get_base_type(&ast->expr_type)) {
+        case 'l': { Ins = "=l neg"; break; }
+        case 's': { Ins = "=s neg"; break; }
+        case 'd': { Ins = "=d neg"; break; }
+        default:  { Ins = "=w neg"; break; }
+    }
+    return qbe_emit_value(f, Ins, expr, NULL_OPERAND, false, ctx);
+}
+
+/*
+    Arithmetic, comparisons & indexing are generated with a visitor and a stack of values instead of recursion.
+    So long chains like "a + b + c + ..." don't overflow the stack. Anything else is an operand which is generated normally.
+*/
+typedef struct operator_tree_t {
+    emit_buffer_t* f;
+    backend_ctx_t* ctx;
+    operand_t* values;
+} operator_tree_t;
+
+static void _operator_tree_free(void* data) {
+    operator_tree_t* tree = data;
+    arrfree(tree->values);
+}
+
+static bool _qbe_is_operator(const ast_node_t* ast) {
+    if (ast->kind == AST_BINARY_OP) {
+        const op_t Operation = ast->data.binary_op.operation;
+        return Operation != BINARY_OP_ASSIGN && Operation != BINARY_OP_AND && Operation != BINARY_OP_OR &&
+            Operation != BINARY_OP_ARRAY_INDEX;
+    }
+    if (ast->kind == AST_UNARY_OP) {
+        return ast->data.unary_op.operation == UNARY_OP_NEGATE;
+    }
+    return false;
+}
+
+static ast_visit_result_t _qbe_operator_tree_pre(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    operator_tree_t* tree = user;
+    if (_qbe_is_operator(ast)) {
+        return AST_VISIT_CONTINUE;
+    }
+
+    arrput(tree->values, qbe_generate_expr_node(tree->f, ast, tree->ctx));
+    return AST_VISIT_SKIP;
+}
+
+static ast_visit_result_t _qbe_operator_tree_post(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    operator_tree_t* tree = user;
+    if (!_qbe_is_operator(ast)) {
+        return AST_VISIT_CONTINUE;
+    }
+
+    if (ast->kind == AST_UNARY_OP) {
+        const operand_t Operand = arrpop(tree->values);
+        arrput(tree->values, TEMPORARY_OPERAND(_qbe_emit_negate(tree->f, ast, Operand, tree->ctx)));
+        return AST_VISIT_CONTINUE;
+    }
+
+    const operand_t Rhs = arrpop(tree->values);
+    const operand_t Lhs = arrpop(tree->values);
+    arrput(tree->values, TEMPORARY_OPERAND(_qbe_emit_binary_op(tree->f, ast, Lhs, Rhs, tree->ctx)));
+    return AST_VISIT_CONTINUE;
+}
+
+static operand_t _qbe_generate_operator_tree(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
+    operator_tree_t* tree = unwind_alloc(sizeof(operator_tree_t), _operator_tree_free);
+    tree->f = f;
+    tree->ctx = ctx;
+    const ast_visitor_t Visitor = {
+        .pre = _qbe_operator_tree_pre,
+        .post = _qbe_operator_tree_post,
+        .user = tree
+    };
+    ast_visit(&ast, &Visitor);
+
+    DEBUG_ASSERT(arrlenu(tree->values) == 1, "?");
+    const operand_t Result = tree->values[0];
+    unwind_free(tree);
+    return Result;
+}
+
+operand_t qbe_generate_expr_node(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
     switch (ast->kind) {
         // @FIXME: Actually implement this.
         case AST_CAST_STATEMENT: {
-            return qbe_generate_expr_node(f, ast->data.cast_statement.expr, ctx);
+            const ast_node_t* Expr = ast->data.cast_statement.expr;
+            const operand_t Value = qbe_generate_expr_node(f, ast->data.cast_statement.expr, ctx);
+
+            // A word is widened for the 'l' instructions, narrowing only uses the lower bits.
+            const bool Widens = qbe_get_base_type(&ast->expr_type) == 'l' && qbe_get_base_type(&Expr->expr_type) == 'w';
+            if (!Widens || Value.is_immediate) {
+                return Value;
+            }
+            temporary_t r = get_temporary(ctx);
+            emit_assign(f, r, 'l', qbe_is_type_signed(&Expr->expr_type) ? "extsw" : "extuw");
+            emit_temp(f, Value.temp);
+            emit_char(f, '\n');
+            return TEMPORARY_OPERAND(r);
         }
 
         case AST_UNARY_OP: {
             switch(ast->data.unary_op.operation) {
                 case UNARY_OP_NEGATE: {
-                    temporary_t expr = qbe_generate_expr_node(f, ast->data.unary_op.operand, ctx);
-                    temporary_t r = get_temporary();
-                    fprintf(f, "\t"),
-                    fprint_temp(f, r);
-                    fprintf(f, " =%c mul ", qbe_get_base_type(&ast->expr_type));
-                    fprint_temp(f, expr);
-                    fprintf(f, ", -1\n");
-                    return r;
+                    return _qbe_generate_operator_tree(f, ast, ctx);
                 }
 
                 case UNARY_OP_ADDRESS_OF: {
-                    return qbe_generate_expr_node(f, ast->data.unary_op.operand, ctx); 
+                    ast_node_t* Operand = ast->data.unary_op.operand;
+                    const bool IsAccess = Operand->kind == AST_GET_MEMBER ||
+                        (Operand->kind == AST_BINARY_OP && Operand->data.binary_op.operation == BINARY_OP_ARRAY_INDEX);
+                    if (IsAccess) {
+                        return TEMPORARY_OPERAND(qbe_generate_access_ptr(f, Operand, ctx));
+                    }
+                    return qbe_generate_expr_node(f, Operand, ctx); 
                 }
 
                 default: {
@@ -405,50 +708,37 @@ temporary_t qbe_generate_expr_node(FILE* f, ast_node_t* ast, backend_ctx_t* ctx)
         }
 
         case AST_BOOL_LITERAL: {
-            temporary_t r = get_temporary();
-            fprintf(f, "\t");
-            fprint_temp(f, r);
-            fprintf(f, "=w copy %u\n", ast->data.boolean ? 1 : 0);
-            return r;
+            return IMMEDIATE_OPERAND(ast->data.boolean ? 1 : 0);
         }
 
         case AST_CHAR_LITERAL: {
-            temporary_t r = get_temporary();
-            fprintf(f, "\t");
-            fprint_temp(f, r);
-            fprintf(f, "=w copy %u\n", ast->data.c);
-            return r;
+            return IMMEDIATE_OPERAND(ast->data.c);
         }
 
         case AST_INTEGER_LITERAL: {
-            temporary_t r = get_temporary();
-            fprintf(f, "\t");
-            fprint_temp(f, r);
-            fprintf(f, "=w copy %li\n", ast->data.integer);
-            return r;
+            return IMMEDIATE_OPERAND(ast->data.integer);
         }
 
         case AST_FLOAT_LITERAL: {
-            temporary_t r = get_temporary();
-            fprintf(f, "\t");
-            fprint_temp(f, r);
-            fprintf(f, "=s copy s_%f\n", ast->data.f32);
-            return r;
+            temporary_t r = get_temporary(ctx);
+            emit_assign(f, r, 's', "copy");
+            emit_format(f, "s_%f\n", ast->data.f32);
+            return TEMPORARY_OPERAND(r);
         }
 
         case AST_STRING_LITERAL: {
-            return qbe_generate_string_literal(f, ast);
+            return TEMPORARY_OPERAND(qbe_generate_string_literal(f, ast, ctx));
         }
 
         case AST_ARRAY_INITIALIZER_LIST: {
-            return qbe_generate_array_initializer(f, ast, ctx);
+            return TEMPORARY_OPERAND(qbe_generate_array_initializer(f, ast, ctx));
         }
 
         case AST_GET_VARIABLE: {
             // Search for temp
             variable_t* var = qbe_find_variable(ast->data.literal, ctx);
             if (var) {
-                return var->temp;
+                return TEMPORARY_OPERAND(var->temp);
             }
             PANIC("no temporary for variable '%s'!", ast->data.literal);
             break;
@@ -464,56 +754,21 @@ temporary_t qbe_generate_expr_node(FILE* f, ast_node_t* ast, backend_ctx_t* ctx)
                     "Invalid assignment!"
                 );
 
-                const temporary_t Temp = qbe_generate_expr_node(f, ast->data.binary_op.right, ctx);
+                const operand_t Value = qbe_generate_expr_node(f, ast->data.binary_op.right, ctx);
                 if (Lhs->kind == AST_BINARY_OP && Lhs->data.binary_op.operation == BINARY_OP_ARRAY_INDEX) {
                     // Get ptr to index
-                    const ast_node_t* ArrayIndexAst = ast->data.binary_op.left;
-                    const datatype_t ElementType = ArrayIndexAst->expr_type;
-                    temporary_t array_temp = qbe_generate_expr_node(f, ArrayIndexAst->data.binary_op.left, ctx);
-                    temporary_t index_temp = qbe_generate_expr_node(f, ArrayIndexAst->data.binary_op.right, ctx);
-                    temporary_t ptr_temp = qbe_get_array_ptr(f, array_temp, index_temp, &ElementType, ctx);
-
-                    // Eval expr
-                    temporary_t expr_temp = qbe_generate_expr_node(f, ast->data.binary_op.right, ctx);
-                    
-                    // Store
-                    fprintf(f, "\t%s ", qbe_get_store_ins(&ElementType));
-                    fprint_temp(f, expr_temp);
-                    fprintf(f, ", ");
-                    fprint_temp(f, ptr_temp);
-                    fprintf(f, "\n");
-                    return ptr_temp;
+                    const temporary_t PtrTemp = qbe_generate_access_ptr(f, ast->data.binary_op.left, ctx);
+                    qbe_generate_store(f, &Lhs->expr_type, Value, PtrTemp, ctx);
+                    return Value;
+                }
+                else if (Lhs->kind == AST_GET_MEMBER && qbe_generate_scalar_member_store(f, Lhs, Value, ctx)) {
+                    return Value;
                 }
                 else if (Lhs->kind == AST_GET_MEMBER) {
-                    // Get ptr to index
-                    const ast_node_t* GetMember = ast->data.binary_op.left;
-                    const datatype_t ElementType = GetMember->expr_type;
-                    const char* MemberName = GetMember->data.get_member.member;
-                    
-                    // Find struct
-                    const variable_t* Variable = qbe_find_variable(GetMember->data.get_member.expr->data.literal, ctx);
-                    const datatype_t* StructureType = datatype_underlying_type(&Variable->var_decl->type);
-                    const aggregate_type_t* Type = qbe_find_type(StructureType->typename, ctx);
-                    const size_t Offset = qbe_get_type_member_offset(Type, MemberName, ctx);
-
-                    // Get index
-                    const temporary_t StructTemp = qbe_generate_expr_node(f, GetMember->data.get_member.expr, ctx);
-                    const temporary_t OffsetTemp = get_temporary();
-                    fprintf(f, "\t");        
-                    fprint_temp(f, OffsetTemp);        
-                    fprintf(f, "=l copy %zu\n", Offset);
-                    const temporary_t PtrTemp = qbe_get_ptr_with_offset(f, StructTemp, OffsetTemp);
-
-                    // Eval expr
-                    const temporary_t ExprTemp = qbe_generate_expr_node(f, ast->data.binary_op.right, ctx);
-                    
-                    // Store
-                    fprintf(f, "\t%s ", qbe_get_store_ins(&ElementType));
-                    fprint_temp(f, ExprTemp);
-                    fprintf(f, ", ");
-                    fprint_temp(f, PtrTemp);
-                    fprintf(f, "\n");
-                    return ExprTemp;
+                    // Get ptr to member
+                    const temporary_t PtrTemp = qbe_generate_access_ptr(f, ast->data.binary_op.left, ctx);
+                    qbe_generate_store(f, &Lhs->expr_type, Value, PtrTemp, ctx);
+                    return Value;
                 }
                 else {
                     const char* VarName = ast->data.binary_op.left->data.literal;
@@ -521,210 +776,151 @@ temporary_t qbe_generate_expr_node(FILE* f, ast_node_t* ast, backend_ctx_t* ctx)
                     if (!Var) {
                         PANIC("no temporary for variable '%s'!", VarName);
                     }
-                    fprintf(f, "\t");
-                    fprint_temp(f, Var->temp);
+                    // Into the variable's memory, not making it an alias of the value.
+                    if (qbe_is_aggregate(&Lhs->expr_type)) {
+                        qbe_generate_store(f, &Lhs->expr_type, Value, Var->temp, ctx);
+                        return Value;
+                    }
+                    qbe_forget_temporary(Var->temp, ctx);
+                    emit_char(f, '\t');
+                    emit_temp(f, Var->temp);
                 }
 
-                fprintf(f, "=%c copy", qbe_get_base_type(&ast->expr_type));
-                fprint_temp(f, Temp);
-                fprintf(f, "\n");
-                return Temp;
+                emit_char(f, '=');
+                emit_char(f, qbe_get_base_type(&ast->expr_type));
+                emit_str(f, " copy ");
+                emit_operand(f, Value);
+                emit_char(f, '\n');
+                return Value;
             }
 
-            temporary_t lhs = qbe_generate_expr_node(f, ast->data.binary_op.left, ctx);
-
-            char* qbe_operation = NULL;
-            bool is_comparision = false;
-            switch (ast->data.binary_op.operation) {
-                case BINARY_OP_ADD      : { qbe_operation = "=w add"; break; }
-                case BINARY_OP_SUBTRACT : { qbe_operation = "=w sub "; break; }
-                case BINARY_OP_MULTIPLY : { qbe_operation = "=w mul "; break; }
-                case BINARY_OP_MODULO   : { qbe_operation = "=w rem "; break; }
-                case BINARY_OP_ASSIGN   : { qbe_operation = "=w "; break; }
-
-#define _SIGN_INS(sign_ins, unsign_ins) qbe_is_type_signed(&ast->data.binary_op.left->expr_type) ? "=w " sign_ins : "=w " unsign_ins
-                case BINARY_OP_LESS_THAN                : { is_comparision = true; qbe_operation = _SIGN_INS("csltw", "cultw"); break; }
-                case BINARY_OP_LESS_OR_EQUAL_THAN       : { is_comparision = true; qbe_operation = _SIGN_INS("cslew", "culew"); break; }
-                case BINARY_OP_GREATER_THAN             : { is_comparision = true; qbe_operation = _SIGN_INS("csgtw", "cugtw"); break; }
-                case BINARY_OP_GREATER_OR_EQUAL_THAN    : { is_comparision = true; qbe_operation = _SIGN_INS("csgew", "cugew"); break; }
-
-                case BINARY_OP_EQUAL                    : { is_comparision = true; qbe_operation = "=w ceqw "; break; }
-                case BINARY_OP_NOT_EQUAL                : { is_comparision = true; qbe_operation = "=w cnew "; break; }
-#undef _SIGN_INS
-
-                case BINARY_OP_ARRAY_INDEX: {
-                    temporary_t rhs = qbe_generate_expr_node(f, ast->data.binary_op.right, ctx);
-                    temporary_t ptr = qbe_get_array_ptr(f, lhs, rhs, &ast->expr_type, ctx);
-
-                    // Get memory from that index
-                    temporary_t result = get_temporary();
-                    fprintf(f, "\t");
-                    fprint_temp(f, result);
-                    fprintf(f, "%s ", qbe_get_load_ins(&ast->expr_type));
-                    fprint_temp(f, ptr);
-                    fprintf(f, "# indexed element\n");
-
-                    return result;
-                }
-
-                default: {
-                    PANIC("Op not implemented %u", ast->data.binary_op.operation);
-                }
+            if (ast->data.binary_op.operation == BINARY_OP_AND || ast->data.binary_op.operation == BINARY_OP_OR) {
+                return TEMPORARY_OPERAND(qbe_generate_logical_op(f, ast, ctx));
             }
-
-            temporary_t rhs = qbe_generate_expr_node(f, ast->data.binary_op.right, ctx);
-
-            // cast to right type lengths
-            if (is_comparision) {
-                const datatype_t* LhsType = &ast->data.binary_op.left->expr_type;
-                const datatype_t* RhsType = &ast->data.binary_op.right->expr_type;
-
-                if (LhsType->kind == DATATYPE_PRIMITIVE && RhsType->kind == DATATYPE_PRIMITIVE) {
-                #define IF_TYPE(comp_type, ins)                         \
-                    if (strcmp(LhsType->typename, comp_type) == 0) {    \
-                        fprintf(f, "\t");                               \
-                        fprint_temp(f, lhs);                            \
-                        fprintf(f, " =w " ins " ");                     \
-                        fprint_temp(f, lhs);                            \
-                        fprintf(f, "\n");                               \
-                    }                                                   \
-                    if (strcmp(RhsType->typename, comp_type) == 0) {    \
-                        fprintf(f, "\t");                               \
-                        fprint_temp(f, rhs);                            \
-                        fprintf(f, " =w " ins " ");                     \
-                        fprint_temp(f, rhs);                            \
-                        fprintf(f, "\n");                               \
-                    }
-
-                    IF_TYPE("bool", "extub");
-                    IF_TYPE("char", "extub");
-                    IF_TYPE("u8", "extub");
-                    IF_TYPE("i8", "extsb");
-                    IF_TYPE("u16", "extuh");
-                    IF_TYPE("i16", "extsh");
-
-                #undef IF_TYPE
-                }
+            if (ast->data.binary_op.operation == BINARY_OP_ARRAY_INDEX) {
+                return TEMPORARY_OPERAND(_qbe_generate_access(f, ast, ctx));
             }
-
-            temporary_t r = get_temporary();
-            fprintf(f, "\t");
-            fprint_temp(f, r);
-            fprintf(f, "%s", qbe_operation);
-            fprint_temp(f, lhs);
-            fprintf(f, ", ");
-            fprint_temp(f, rhs);
-            fprintf(f, "\n");
-            return r;
+            return _qbe_generate_operator_tree(f, ast, ctx);
         }
 
         case AST_FUNCTION_CALL: {
-            return qbe_generate_function_call(f, ast, ctx);
+            return TEMPORARY_OPERAND(qbe_generate_function_call(f, ast, ctx));
         }
 
         case AST_RETURN: {
             if (ast->data.expr) {
-                temporary_t r = qbe_generate_expr_node(f, ast->data.expr, ctx);
-                fprintf(f, "\tret ");
-                fprint_temp(f, r);
-                fprintf(f, "\n");
+                const operand_t Value = qbe_generate_expr_node(f, ast->data.expr, ctx);
+                emit_str(f, "\tret ");
+                emit_operand(f, Value);
+                emit_char(f, '\n');
             }
             else {
-                fprintf(f, "\tret\n");
+                emit_str(f, "\tret\n");
             }
-            return NULL_TEMPORARY;
+            return NULL_OPERAND;
         }
 
         case AST_VARIABLE_DECLARATION: {
-            temporary_t r = qbe_generate_expr_node(f, ast->data.variable_declaration.expr, ctx);
+            if (qbe_generate_scalar_struct_declaration(f, ast, ctx)) {
+                return NULL_OPERAND;
+            }
+            if (qbe_generate_constant_declaration(f, ast, ctx)) {
+                return NULL_OPERAND;
+            }
+            const ast_node_t* Expr = ast->data.variable_declaration.expr;
+            if (Expr->kind == AST_STRING_LITERAL && ast->data.variable_declaration.type.kind == DATATYPE_ARRAY) {
+                const temporary_t Array = qbe_generate_string_array(f, Expr, ctx);
+                const variable_t VarTemp = {.var_decl = &ast->data.variable_declaration, .temp = Array};
+                arrput(ctx->variables, VarTemp);
+                return TEMPORARY_OPERAND(Array);
+            }
+            const operand_t Value = qbe_generate_expr_node(f, ast->data.variable_declaration.expr, ctx);
+
+            // A copy of another array or struct, instead of sharing its memory.
+            const datatype_t* Type = &ast->data.variable_declaration.type;
+            const bool IsExisting = Expr->kind == AST_GET_VARIABLE || Expr->kind == AST_GET_MEMBER ||
+                (Expr->kind == AST_BINARY_OP && Expr->data.binary_op.operation == BINARY_OP_ARRAY_INDEX);
+            if (qbe_is_aggregate(Type) && IsExisting) {
+                const temporary_t Copy = qbe_allocate(8, qbe_get_type_size(Type, ctx), ctx);
+                qbe_generate_blit(f, Value.temp, Copy, qbe_get_type_size(Type, ctx), ctx);
+                const variable_t VarTemp = {.var_decl = &ast->data.variable_declaration, .temp = Copy};
+                arrput(ctx->variables, VarTemp);
+                return TEMPORARY_OPERAND(Copy);
+            }
+
+            // Variables are temporaries, 'let b = a;' would make 'b' an alias of 'a', immediates need one of their own.
+            const char BaseType = qbe_get_base_type(&ast->data.variable_declaration.type);
+            temporary_t r = qbe_operand_to_temporary(f, Value, BaseType, ctx);
+            if (ast->data.variable_declaration.expr->kind == AST_GET_VARIABLE && BaseType) {
+                const temporary_t Copy = get_temporary(ctx);
+                emit_assign(f, Copy, BaseType, "copy");
+                emit_temp(f, r);
+                emit_char(f, '\n');
+                r = Copy;
+            }
+            qbe_forget_temporary(r, ctx); // a variable now, it's no longer the value of the expression
             const variable_t VarTemp = {.var_decl = &ast->data.variable_declaration, .temp = r};
             arrput(ctx->variables, VarTemp);
-            return r;
+            return TEMPORARY_OPERAND(r);
         }
         
         case AST_GET_MEMBER: {
-            // Find type
-            aggregate_type_t* type = qbe_find_type(
-                datatype_underlying_type(&ast->data.get_member.expr->expr_type)->typename,
-                ctx
-            );
-            DEBUG_ASSERT(type, "Struct declaration was not found!");
-
-            const char* FieldName = ast->data.get_member.member;
-            const size_t Offset = qbe_get_type_member_offset(type, FieldName, ctx);
-            const temporary_t ExprTemp = qbe_generate_expr_node(f, ast->data.get_member.expr, ctx);
-
-            // Ptr
-            const temporary_t PtrAdd = get_temporary();
-            fprintf(f, "\t");
-            fprint_temp(f, PtrAdd);
-            fprintf(f, "=l add ");
-            fprint_temp(f, ExprTemp);
-            fprintf(f, ", %zu\n", Offset);
-
-            // Get memory from that index
-            temporary_t result = get_temporary();
-            fprintf(f, "\t");
-            fprint_temp(f, result);
-            fprintf(f, "%s ", qbe_get_load_ins(&ast->expr_type));
-            fprint_temp(f, PtrAdd);
-            fprintf(f, "# indexed element\n");
-
-            return result;
+            // Resolved by semantic analysis
+            DEBUG_ASSERT(ast->data.get_member.resolved, "Member '%s' was not resolved!", ast->data.get_member.member);
+            temporary_t scalar = NULL_TEMPORARY;
+            if (qbe_generate_scalar_member_load(f, ast, ctx, &scalar)) {
+                return TEMPORARY_OPERAND(scalar);
+            }
+            return TEMPORARY_OPERAND(_qbe_generate_access(f, ast, ctx));
         }
 
         case AST_WHILE_LOOP: {
-            return qbe_generate_while_loop(f, ast, ctx);
+            return TEMPORARY_OPERAND(qbe_generate_while_loop(f, ast, ctx));
+        }
+
+        case AST_FOR_LOOP: {
+            return TEMPORARY_OPERAND(qbe_generate_for_loop(f, ast, ctx));
         }
 
         case AST_IF_STATEMENT: {
-            return qbe_generate_if_statement(f, ast, ctx);
+            return TEMPORARY_OPERAND(qbe_generate_if_statement(f, ast, ctx));
         }
 
         case AST_STRUCT_INITIALIZER_LIST: {
-            const ast_struct_initializer_list_t* InitList = &ast->data.struct_initializer_list;
-            aggregate_type_t* type = NULL;
-
-            // Find type            
-            const size_t TypeCount = arrlenu(ctx->types);  
-            for (size_t i = 0; i < TypeCount; i++) {
-                if (strcmp(InitList->name, ctx->types[i].ast->name) == 0) {
-                    type = &ctx->types[i];
-                }
+            if (qbe_is_constant_initializer(ast)) {
+                return TEMPORARY_OPERAND(qbe_generate_constant_initializer(f, ast, ctx));
             }
+
+            const ast_struct_initializer_list_t* InitList = &ast->data.struct_initializer_list;
+            const aggregate_type_t* type = qbe_find_type(InitList->name, ctx);
             DEBUG_ASSERT(type, "Struct declaration was not found!");
-            const size_t TypeSize = qbe_get_aggregate_type_size(type, ctx); 
+            const size_t TypeSize = qbe_get_aggregate_type_size(type);
 
-            // Allocate
-            const temporary_t Ptr = get_temporary(); 
-            fprintf(f, "\t");
-            fprint_temp(f, Ptr);
-            fprintf(f, "=l alloc8 %zu\n", TypeSize);
+            // Two or more constant fields are worth a template, which also merges the narrow ones.
+            const size_t ExprCount = arrlenu(InitList->fields);
+            size_t constant_count = 0;
+            for (size_t i = 0; i < ExprCount; i++) {
+                constant_count += qbe_is_constant_initializer(InitList->fields[i].expr);
+            }
+            const bool FromTemplate = constant_count >= 2;
+            const temporary_t Ptr = FromTemplate ? qbe_generate_initializer_template(f, ast, ctx) : qbe_allocate(8, TypeSize, ctx);
 
             // Initialize members
-            const size_t ExprCount = arrlenu(InitList->fields);
             for (size_t i = 0; i < ExprCount; i++) {
-                const size_t Offset = qbe_get_type_member_offset(type, InitList->fields[i].name, ctx);
-                const size_t MemberIndex = qbe_get_type_member_index(type, InitList->fields[i].name);
-                const temporary_t Res = qbe_generate_expr_node(f, InitList->fields[i].expr, ctx);
+                const struct_member_t* Member = InitList->fields[i].member;
+                DEBUG_ASSERT(Member, "Field '%s' was not resolved!", InitList->fields[i].name);
+                if (FromTemplate && qbe_is_constant_initializer(InitList->fields[i].expr)) {
+                    continue;
+                }
+                const size_t Offset = Member->offset;
+                const operand_t Res = qbe_generate_expr_node(f, InitList->fields[i].expr, ctx);
 
                 // Ptr
-                const temporary_t PtrAdd = get_temporary();
-                fprintf(f, "\t");
-                fprint_temp(f, PtrAdd);
-                fprintf(f, "=l add ");
-                fprint_temp(f, Ptr);
-                fprintf(f, ", %zu\n", Offset);
-                
-                // Store @FIXME: type specific store
-                fprintf(f, "\t%s ", qbe_get_store_ins(&type->ast->members[MemberIndex].type));
-                fprint_temp(f, Res);
-                fprintf(f, ", ");
-                fprint_temp(f, PtrAdd);
-                fprintf(f, "\n");
+                const temporary_t PtrAdd = qbe_get_ptr_with_offset(f, Ptr, IMMEDIATE_OPERAND((int64_t)Offset), ctx);
+                qbe_generate_store(f, Member->type, Res, PtrAdd, ctx);
             }
 
-            return Ptr;
+            return TEMPORARY_OPERAND(Ptr);
         }
 
         default: {
@@ -732,79 +928,264 @@ temporary_t qbe_generate_expr_node(FILE* f, ast_node_t* ast, backend_ctx_t* ctx)
         }
     }
 
-    return get_temporary();
+    return TEMPORARY_OPERAND(get_temporary(ctx));
 }
 
-static void _generate_ast_global_node(FILE* f, ast_node_t* ast, backend_ctx_t* ctx) {
-    switch (ast->kind) {
-        case AST_STRUCT_DECLARATION: {
-            ast_struct_declaration_t* decl = &ast->data.struct_declaration;
-            fprintf(f, "type :%s = { ", decl->name);
-            qbe_generate_struct_members(f, decl, ctx);
-            fprintf(f, " }\n");
-            arrput(ctx->types, (aggregate_type_t){ .ast = decl });
-            break;
-        }
+static void _emit_buffer_cleanup(void* data) {
+    emit_buffer_free(data);
+}
 
-        case AST_FUNCTION_DECLARATION: {
-            const ast_function_declaration_t* FuncDecl = &ast->data.function_declaration;
-            if (FuncDecl->external) {
-                return;
-            }
-            
-            if (strcmp(FuncDecl->name, "main") == 0) {
-                fprintf(f, "export ");
-            }
+static void _generate_function(emit_buffer_t* f, ast_node_t* ast, backend_ctx_t* ctx) {
+    const ast_function_declaration_t* FuncDecl = &ast->data.function_declaration;
+    if (strcmp(FuncDecl->name, "main") == 0) {
+        emit_str(f, "export ");
+    }
 
-            // TODO: returns custom types
-            fprintf(f, "function ");
-            fprintf(f, "%s $%s(", qbe_get_abi_type(&FuncDecl->return_type), FuncDecl->name);
+    // Structs are QBE aggregate types, which are passed & returned in registers per the ABI when they fit.
+    emit_str(f, "function ");
+    emit_abi_type(f, &FuncDecl->return_type);
+    emit_str(f, " $");
+    emit_str(f, FuncDecl->name);
+    emit_char(f, '(');
+
+    const size_t ArrCount = arrlenu(FuncDecl->args);
+    for (size_t i = 0; i < ArrCount; i++) {
+        const variable_t VarTemp = {.var_decl = &FuncDecl->args[i].data.variable_declaration, .temp = get_temporary(ctx)};
+        arrput(ctx->variables, VarTemp);
+
+        // A struct's temporary is the address of the callee's own copy.
+        emit_abi_type(f, &FuncDecl->args[i].data.variable_declaration.type);
+        emit_char(f, ' ');
+        emit_temp(f, VarTemp.temp);
+        emit_str(f, ", ");
+    }
+    emit_str(f, ") {\n@start\n");
+
+    // Body, buffered so the allocations it makes can be emitted before it.
+    emit_buffer_t* body = unwind_alloc(sizeof(emit_buffer_t), _emit_buffer_cleanup);
+    qbe_find_scalar_structs(ast, ctx);
+    qbe_find_mutated_locals(ast, ctx);
+    const size_t BodyCount = arrlenu(FuncDecl->body);
+    for (size_t i = 0; i < BodyCount; i++) {
+        qbe_generate_expr_node(body, FuncDecl->body[i], ctx);
+    }
 
-            const size_t ArrCount = arrlenu(FuncDecl->args);
-            for (size_t i = 0; i < ArrCount; i++) {
-                const variable_t VarTemp = {.var_decl = &FuncDecl->args[i].data.variable_declaration, .temp = get_temporary()};
-                arrput(ctx->variables, VarTemp);
+    // In the start block, so QBE allocates them statically instead of growing the stack on every evaluation.
+    for (size_t i = 0; i < arrlenu(ctx->allocations); i++) {
+        const allocation_t* Allocation = &ctx->allocations[i];
+        emit_char(f, '\t');
+        emit_temp(f, Allocation->temp);
+        emit_str(f, "=l alloc");
+        emit_uint(f, Allocation->alignment);
+        emit_char(f, ' ');
+        emit_uint(f, Allocation->size);
+        emit_char(f, '\n');
+    }
+    emit_append(f, body);
+    unwind_free(body);
 
-                fprintf(f, "w ");
-                fprint_temp(f, VarTemp.temp);
-                fprintf(f, ", ");
-            }
-            fprintf(f, ") {\n@start\n");
-            
-            // Body
-            const size_t BodyCount = arrlenu(FuncDecl->body);
-            for (size_t i = 0; i < BodyCount; i++) {
-                qbe_generate_expr_node(f, FuncDecl->body[i], ctx);
-            }
+    emit_str(f, "}\n");
+}
 
-            fprintf(f, "}\n");
-            break;
-        }
+/*
+    Every function is generated on its own, so they can be generated in parallel with '--jobs':
+    a job numbers its temporaries & labels from 1, & has its own output & pools of strings & constants.
+    The jobs are joined in the order they're declared, then their pools are merged & their symbols renumbered,
+    which makes the output the same as generating them one after another.
+*/
+typedef struct function_job_t {
+    ast_node_t* ast;
+    backend_ctx_t ctx;
+    emit_buffer_t out;
+    unwind_list_t unwind; // what the job's error left behind, the job runs on its own thread
+    int exit_code;
+} function_job_t;
+
+// The translation unit's types & options, nothing of a function's.
+static backend_ctx_t _function_ctx(const backend_ctx_t* unit) {
+    backend_ctx_t ctx = {
+        .variables = NULL,
+        .allocations = NULL,
+        .types = unit->types,
+        .strings = NULL,
+        .constants = NULL,
+        .type_lookup = unit->type_lookup,
+        .type_lookup_capacity = unit->type_lookup_capacity,
+        .string_lookup = NULL,
+        .string_lookup_capacity = 0,
+        .temporary_count = 0,
+        .label_count = 0,
+        .unroll_full_max_trips = unit->unroll_full_max_trips,
+        .unroll_factor = unit->unroll_factor,
+        .scalar_replacement = unit->scalar_replacement,
+        .scalar_structs = NULL,
+        .mutated_locals = NULL,
+        .cse = unit->cse,
+        .values = NULL
+    };
+    arrsetcap(ctx.variables, 50);
+    return ctx;
+}
 
-        default: {
-            PANIC("not implemented for type %u", ast->kind);
-        }
+static void _function_ctx_free(backend_ctx_t* ctx) {
+    arrfree(ctx->variables);
+    arrfree(ctx->allocations);
+    arrfree(ctx->strings);
+    free(ctx->string_lookup);
+    arrfree(ctx->constants);
+    arrfree(ctx->scalar_structs);
+    arrfree(ctx->mutated_locals);
+    arrfree(ctx->values);
+}
+
+static void _generate_function_job(void* user) {
+    function_job_t* job = user;
+
+    // An error ends the job, it's passed on once every job is done.
+    jmp_buf* previous_jump = g_Jumpluff;
+    unwind_list_t* previous_unwind = g_Unwind;
+    g_Unwind = &job->unwind;
+    jmp_buf jump;
+    job->exit_code = SETJUMP(jump);
+    if (!job->exit_code) {
+        _generate_function(&job->out, job->ast, &job->ctx);
     }
+    unwind_free_all(&job->unwind);
+    g_Jumpluff = previous_jump;
+    g_Unwind = previous_unwind;
+}
 
-    
+// Appends the job's output with its symbols numbered for the translation unit.
+static void _join_function(emit_buffer_t* f, function_job_t* job, backend_ctx_t* unit) {
+    uint32_t* string_ids = NULL;
+    for (size_t i = 0; i < arrlenu(job->ctx.strings); i++) {
+        arrput(string_ids, (uint32_t)qbe_pool_string(job->ctx.strings[i], unit));
+    }
+    const size_t ConstantBase = arrlenu(unit->constants);
+    for (size_t i = 0; i < arrlenu(job->ctx.constants); i++) {
+        arrput(unit->constants, job->ctx.constants[i]);
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < arrlenu(job->out.refs); i++) {
+        const symbol_ref_t* Ref = &job->out.refs[i];
+        emit_bytes(f, job->out.data + written, Ref->offset - written);
+        emit_uint(f, Ref->kind == SYMBOL_STRING ? string_ids[Ref->index] : ConstantBase + Ref->index);
+        written = Ref->offset;
+    }
+    emit_bytes(f, job->out.data + written, job->out.length - written);
+    arrfree(string_ids);
 }
 
-void generate_qbe(FILE* f, ast_node_t* ast) {
+// The state of the translation unit, freed by whoever catches an error raised while generating it.
+typedef struct qbe_unit_t {
+    backend_ctx_t ctx;
+    emit_buffer_t out; // written out at once, instead of a call to the stream per token
+    function_job_t* jobs;
+} qbe_unit_t;
+
+static void _qbe_unit_free(void* data) {
+    qbe_unit_t* unit = data;
+    for (size_t i = 0; i < arrlenu(unit->jobs); i++) {
+        _function_ctx_free(&unit->jobs[i].ctx);
+        emit_buffer_free(&unit->jobs[i].out);
+    }
+    arrfree(unit->jobs);
+    emit_buffer_free(&unit->out);
+
+    arrfree(unit->ctx.types);
+    arrfree(unit->ctx.strings);
+    arrfree(unit->ctx.constants);
+    free(unit->ctx.type_lookup);
+    free(unit->ctx.string_lookup);
+}
+
+void generate_qbe(FILE* f, ast_node_t* ast, const program_params_t* params) {
     DEBUG_ASSERT(ast->kind == AST_TRANSLATION_UNIT, "?");
     
-    backend_ctx_t ctx = {
+    const bool Unroll = params && params->opt_unroll_loops;
+    qbe_unit_t* unit = unwind_alloc(sizeof(qbe_unit_t), _qbe_unit_free);
+    unit->ctx = (backend_ctx_t){
         .variables = NULL,
-        .types = NULL
+        .allocations = NULL,
+        .types = NULL,
+        .strings = NULL,
+        .constants = NULL,
+        .type_lookup = NULL,
+        .type_lookup_capacity = 0,
+        .string_lookup = NULL,
+        .string_lookup_capacity = 0,
+        .temporary_count = 0,
+        .label_count = 0,
+        .unroll_full_max_trips = Unroll ? UNROLL_FULL_MAX_TRIPS : 0,
+        .unroll_factor = Unroll ? (params->opt_unroll_factor ? params->opt_unroll_factor : UNROLL_DEFAULT_FACTOR) : 0,
+        .scalar_replacement = params && params->opt_scalar_replacement,
+        .scalar_structs = NULL,
+        .mutated_locals = NULL,
+        .cse = params && params->opt_cse,
+        .values = NULL
     };
+    backend_ctx_t* ctx = &unit->ctx;
 
-    arrsetcap(ctx.variables, 50);
+    // Register the types first, so they can be used in any order.
+    _qbe_register_types(ast, ctx);
 
+    // The types come first, so any function can use them.
     const size_t Len = arrlenu(ast->data.translation_unit.body);
     for (size_t i = 0; i < Len; i++) {
-        stbds_header(ctx.variables)->length = 0; // clear variables
-        _generate_ast_global_node(f, ast->data.translation_unit.body[i], &ctx);
+        ast_node_t* node = ast->data.translation_unit.body[i];
+        switch (node->kind) {
+            case AST_STRUCT_DECLARATION: {
+                aggregate_type_t* type = qbe_find_type(node->data.struct_declaration.name, ctx);
+                DEBUG_ASSERT(type, "Struct declaration was not registered!");
+                qbe_generate_struct_type(&unit->out, type, ctx);
+                break;
+            }
+
+            case AST_FUNCTION_DECLARATION: {
+                if (!node->data.function_declaration.external) {
+                    const function_job_t Job = { .ast = node, .ctx = _function_ctx(ctx), .out = { 0 }, .unwind = { 0 }, .exit_code = 0 };
+                    arrput(unit->jobs, Job);
+                }
+                break;
+            }
+
+            default: {
+                PANIC("not implemented for type %u", node->kind);
+            }
+        }
+    }
+
+    // The jobs don't move anymore, they can be handed out.
+    function_job_t* jobs = unit->jobs;
+    const size_t Threads = params && params->codegen_threads > 1 ? params->codegen_threads : 0;
+    thread_pool_t pool;
+    thread_pool_init(&pool, Threads);
+    task_group_t group;
+    task_group_init(&group, &pool);
+    for (size_t i = 0; i < arrlenu(jobs); i++) {
+        task_group_spawn(&group, _generate_function_job, &jobs[i]);
     }
+    task_group_wait(&group);
+    thread_pool_cleanup(&pool);
 
-    arrfree(ctx.variables);
-    arrfree(ctx.types);
+    int exit_code = 0;
+    for (size_t i = 0; i < arrlenu(jobs); i++) {
+        if (!jobs[i].exit_code) {
+            _join_function(&unit->out, &jobs[i], ctx);
+        }
+        else if (!exit_code) {
+            exit_code = jobs[i].exit_code;
+        }
+    }
+
+    if (!exit_code) {
+        qbe_generate_constant_pool(&unit->out, ctx);
+        qbe_generate_string_pool(&unit->out, ctx);
+        emit_buffer_flush(&unit->out, f);
+    }
+    unwind_free(unit);
+    if (exit_code) {
+        LONGJUMP(exit_code);
+    }
 }
@@ -9,13 +9,32 @@
 struct ast_node_t;
 struct ast_variable_declaration_t;
 struct ast_struct_declaration_t;
+struct struct_layout_t;
 struct datatype_t;
+struct program_params_t;
+
+// Loop unrolling with '--funroll-loops'
+#define UNROLL_FULL_MAX_TRIPS 16 // for loops with at most this many iterations have no loop left
+#define UNROLL_DEFAULT_FACTOR 4  // copies of the body in a partially unrolled loop
+
+// Common subexpression elimination with '--fcse'
+#define CSE_MAX_VALUES 256 // values remembered in a basic block, before starting over
 
 typedef struct temporary_t {
     uint32_t id;
 } temporary_t;
 #define NULL_TEMPORARY (temporary_t){.id = 0}
 
+// An expression's value, literals are immediates which QBE takes in place of a temporary.
+typedef struct operand_t {
+    temporary_t temp;
+    int64_t immediate;
+    bool is_immediate;
+} operand_t;
+#define TEMPORARY_OPERAND(t) (operand_t){.temp = (t), .immediate = 0, .is_immediate = false}
+#define IMMEDIATE_OPERAND(v) (operand_t){.temp = NULL_TEMPORARY, .immediate = (v), .is_immediate = true}
+#define NULL_OPERAND TEMPORARY_OPERAND(NULL_TEMPORARY)
+
 typedef struct label_t {
     uint32_t id;
 } label_t;
@@ -23,41 +42,137 @@ typedef struct label_t {
 typedef struct variable_t {
     struct ast_variable_declaration_t* var_decl;
     temporary_t temp;
+    bool scalarized; // struct with a temporary per member, 'temp' is the first member's & the rest follow
 } variable_t;
 
+// Fixed size stack memory, all of a function's are allocated once at its start.
+typedef struct allocation_t {
+    temporary_t temp;
+    size_t alignment; // 4 | 8 | 16
+    size_t size;
+} allocation_t;
+
+// Static data for an initializer, laid out as 'type'.
+typedef struct constant_t {
+    const struct ast_node_t* ast;
+    const struct datatype_t* type;
+} constant_t;
+
+// An instruction's result, reused for the same instruction on the same operands.
+typedef struct value_t {
+    char ins[16]; // "=l add"
+    operand_t lhs;
+    operand_t rhs; // NULL_OPERAND for unary instructions
+    temporary_t result;
+    bool is_load;
+} value_t;
+
+// Data symbols which are numbered per function, until the functions are joined into the translation unit.
+typedef enum symbol_kind_t {
+    SYMBOL_STRING,   // '$str.N'
+    SYMBOL_CONSTANT, // '$init.N'
+} symbol_kind_t;
+
+// Where the number of a symbol goes, it's written when the final one is known.
+typedef struct symbol_ref_t {
+    size_t offset;
+    uint32_t index; // into the function's pool
+    symbol_kind_t kind;
+} symbol_ref_t;
+
+// Growable buffer the IR is appended to, written out at once.
+typedef struct emit_buffer_t {
+    char* data; // not null-terminated
+    size_t length;
+    size_t capacity;
+    symbol_ref_t* refs; // in the order of their offsets
+} emit_buffer_t;
+
 typedef struct aggregate_type_t {
+    const char* name;
     struct ast_struct_declaration_t* ast;
+    const struct struct_layout_t* layout;
+    bool emitted;
 } aggregate_type_t;
 
 typedef struct backend_ctx_t {
     variable_t* variables;
+    allocation_t* allocations; // of the current function
     aggregate_type_t* types;
+    // A function has pools of its own, which are merged into the translation unit's when it's joined.
+    const char** strings; // literals, '$str.N' is the N'th
+    constant_t* constants; // constant initializers, '$init.N' is the N'th
+    // Open addressing on the struct name -> index+1 into types, 0 is an empty slot.
+    // Not a stb_ds hashmap, because it changes a global seed whenever one is created.
+    uint32_t* type_lookup;
+    size_t type_lookup_capacity; // always a power of 2
+    // Same for the literal -> index+1 into strings, grown as literals are pooled.
+    uint32_t* string_lookup;
+    size_t string_lookup_capacity; // always a power of 2, or 0 before the first literal
+
+    // Ids for the next temporary & label, of the current function
+    uint32_t temporary_count;
+    uint32_t label_count;
+
+    // Loop unrolling, both 0 when disabled
+    size_t unroll_full_max_trips;
+    size_t unroll_factor;
+
+    // Scalar replacement of struct locals
+    bool scalar_replacement;
+    const char** scalar_structs; // names of the current function's struct locals kept in temporaries
+
+    const char** mutated_locals; // names of the current function's locals which are written to or escape
+
+    // Common subexpression elimination, 'values' are of the current basic block
+    bool cse;
+    value_t* values;
 } backend_ctx_t;
 
 
-temporary_t get_temporary(void);
-label_t get_label(void);
-void fprint_temp(FILE* f, temporary_t temp);
-void fprint_label(FILE* f, label_t temp);
-temporary_t qbe_generate_expr_node(FILE* f, struct ast_node_t* ast, backend_ctx_t* ctx);
-void generate_qbe(FILE* f, struct ast_node_t* ast);
+void emit_buffer_free(emit_buffer_t* buffer);
+void emit_buffer_flush(const emit_buffer_t* buffer, FILE* f);
+void emit_bytes(emit_buffer_t* buffer, const char* bytes, size_t size);
+void emit_append(emit_buffer_t* buffer, const emit_buffer_t* other);
+void emit_str(emit_buffer_t* buffer, const char* str);
+void emit_char(emit_buffer_t* buffer, char c);
+void emit_uint(emit_buffer_t* buffer, uint64_t value);
+void emit_int(emit_buffer_t* buffer, int64_t value);
+void emit_format(emit_buffer_t* buffer, const char* format, ...); // printf, for what isn't on the hot path
+void emit_temp(emit_buffer_t* buffer, temporary_t temp);
+void emit_label(emit_buffer_t* buffer, label_t label);
+void emit_operand(emit_buffer_t* buffer, operand_t operand);
+void emit_assign(emit_buffer_t* buffer, temporary_t result, char base_type, const char* ins); // "\t%r1=w ins "
+void emit_symbol(emit_buffer_t* buffer, symbol_kind_t kind, size_t index); // numbered in the joined output
+
+temporary_t get_temporary(backend_ctx_t* ctx);
+label_t get_label(backend_ctx_t* ctx);
+temporary_t qbe_allocate(size_t alignment, size_t size, backend_ctx_t* ctx); // pointer to memory reused on every evaluation
+void qbe_generate_blit(emit_buffer_t* f, temporary_t src, temporary_t dst, size_t size, backend_ctx_t* ctx);
+void qbe_generate_store(emit_buffer_t* f, const struct datatype_t* type, operand_t value, temporary_t ptr, backend_ctx_t* ctx); // blits aggregates
+temporary_t qbe_operand_to_temporary(emit_buffer_t* f, operand_t operand, char base_type, backend_ctx_t* ctx); // copies immediates
+operand_t qbe_generate_expr_node(emit_buffer_t* f, struct ast_node_t* ast, backend_ctx_t* ctx);
+void generate_qbe(FILE* f, struct ast_node_t* ast, const struct program_params_t* params); // params can be NULL
 
 aggregate_type_t* qbe_find_type(const char* name, const backend_ctx_t* ctx);
 size_t qbe_get_type_size(const struct datatype_t* type, const backend_ctx_t* ctx);
-size_t qbe_get_aggregate_type_size(aggregate_type_t* t, const backend_ctx_t* ctx);
+size_t qbe_get_aggregate_type_size(const aggregate_type_t* t);
 bool qbe_is_type_signed(const struct datatype_t* type);
-size_t qbe_get_type_member_offset(const aggregate_type_t* t, const char* member_name, const backend_ctx_t* ctx);
-size_t qbe_get_type_member_index(aggregate_type_t* t, const char* member_name);
+bool qbe_is_aggregate(const struct datatype_t* type); // arrays & structs, their value is their address
+size_t qbe_get_type_member_offset(const aggregate_type_t* t, const char* member_name);
 char qbe_get_base_type(const struct datatype_t* register_type);         // base types: w | l | s | d
 const char* qbe_get_abi_type(const struct datatype_t* register_type);   // base types + "sb" | "ub" | "sh" | "uh"
-temporary_t qbe_get_ptr_with_offset(FILE* f, temporary_t begin_ptr, temporary_t offset);
+void emit_abi_type(emit_buffer_t* f, const struct datatype_t* type);    // ABI type, or ':Name' of a struct
+temporary_t qbe_get_ptr_with_offset(emit_buffer_t* f, temporary_t begin_ptr, operand_t offset, backend_ctx_t* ctx);
 temporary_t qbe_get_array_ptr(
-    FILE* f,
+    emit_buffer_t* f,
     temporary_t array_ptr,
-    temporary_t index_temp,
+    operand_t index,
+    const struct datatype_t* index_type,
     const struct datatype_t* element_type,
-    const backend_ctx_t* ctx
+    backend_ctx_t* ctx
 );
+temporary_t qbe_generate_access_ptr(emit_buffer_t* f, struct ast_node_t* ast, backend_ctx_t* ctx); // of an element or a member
 variable_t* qbe_find_variable(const char* name, backend_ctx_t* ctx);
 const char* qbe_get_store_ins(const struct datatype_t* register_type);
 const char* qbe_get_load_ins(const struct datatype_t* register_type);
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 
@@ -15,8 +16,6 @@
 #   define DEFAULT_EXECUTABLE "./output.o"
 #endif
 
-program_params_t g_Params = { 0 };
-
 // returns the mount of arguments used
 typedef int cli_func(program_params_t* params, char** arg);
 
@@ -76,6 +75,74 @@ static int _exec_enable_ast_constant_folding(program_params_t* params, char** ar
     return 0;
 }
 
+static int _exec_enable_ast_dead_code(program_params_t* params, char** arg) {
+    UNUSED(arg);
+    params->opt_ast_dead_code = true;
+    return 0;
+}
+
+static int _exec_enable_ast_inline(program_params_t* params, char** arg) {
+    UNUSED(arg);
+    params->opt_ast_inline = true;
+    return 0;
+}
+
+static int _exec_enable_ast_licm(program_params_t* params, char** arg) {
+    UNUSED(arg);
+    params->opt_ast_licm = true;
+    return 0;
+}
+
+static int _exec_inline_threshold(program_params_t* params, char** arg) {
+    if (*arg == NULL) {
+        params->do_compilation = false;
+        printf("NO ARGUMENT PASSED! :^(\n");
+        return true;
+    }
+    params->opt_ast_inline = true;
+    params->opt_inline_threshold = (size_t)strtoul(*arg, NULL, 10);
+    return 1;
+}
+
+static int _exec_enable_unroll_loops(program_params_t* params, char** arg) {
+    UNUSED(arg);
+    params->opt_unroll_loops = true;
+    return 0;
+}
+
+static int _exec_unroll_factor(program_params_t* params, char** arg) {
+    if (*arg == NULL) {
+        params->do_compilation = false;
+        printf("NO ARGUMENT PASSED! :^(\n");
+        return true;
+    }
+    params->opt_unroll_loops = true;
+    params->opt_unroll_factor = (size_t)strtoul(*arg, NULL, 10);
+    return 1;
+}
+
+static int _exec_enable_scalar_replacement(program_params_t* params, char** arg) {
+    UNUSED(arg);
+    params->opt_scalar_replacement = true;
+    return 0;
+}
+
+static int _exec_enable_cse(program_params_t* params, char** arg) {
+    UNUSED(arg);
+    params->opt_cse = true;
+    return 0;
+}
+
+static int _exec_jobs(program_params_t* params, char** arg) {
+    if (*arg == NULL) {
+        params->do_compilation = false;
+        printf("NO ARGUMENT PASSED! :^(\n");
+        return true;
+    }
+    params->codegen_threads = (size_t)strtoul(*arg, NULL, 10);
+    return 1;
+}
+
 static const struct {
     const char* long_cmd;
     const char* short_cmd;
@@ -90,6 +157,15 @@ static const struct {
     {"--print-ast", NULL, "prints the ast to stdout", _exec_enable_print_ast},
     {"--CFLAGS", NULL, "pass arguments to gcc", _exec_cflags},
     {"--fconstant-folding", NULL, "enables ast's constant folding", _exec_enable_ast_constant_folding},
+    {"--fdead-code-elimination", NULL, "enables ast's dead code elimination", _exec_enable_ast_dead_code},
+    {"--finline", NULL, "enables inlining of small functions", _exec_enable_ast_inline},
+    {"--finline-threshold", NULL, "max size of an inlined function in ast nodes", _exec_inline_threshold},
+    {"--floop-invariant-code-motion", NULL, "computes loop invariant expressions before while loops", _exec_enable_ast_licm},
+    {"--funroll-loops", NULL, "unrolls for loops over constant ranges", _exec_enable_unroll_loops},
+    {"--fscalar-replacement", NULL, "keeps the members of local structs, which don't escape, in temporaries", _exec_enable_scalar_replacement},
+    {"--funroll-factor", NULL, "how many copies of the body a partially unrolled loop has", _exec_unroll_factor},
+    {"--fcse", NULL, "reuses the value of a repeated expression within a basic block", _exec_enable_cse},
+    {"--jobs", "-j", "generates the functions on this many threads", _exec_jobs},
 };
 
 #ifdef NDEBUG
@@ -149,6 +225,15 @@ program_params_t cli_parse(int argc, char** argv) {
         .cflags = "",
 
         .opt_ast_constant_folding = false,
+        .opt_ast_dead_code = false,
+        .opt_ast_inline = false,
+        .opt_inline_threshold = 0,
+        .opt_ast_licm = false,
+        .opt_unroll_loops = false,
+        .opt_unroll_factor = 0,
+        .opt_scalar_replacement = false,
+        .opt_cse = false,
+        .codegen_threads = 0,
     };
 
     // parse input files
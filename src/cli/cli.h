@@ -1,5 +1,6 @@
 #ifndef MYLANG_CLI_H
 #define MYLANG_CLI_H
+#include <stddef.h>
 #include <stdbool.h>
 
 typedef struct program_params_t {
@@ -11,9 +12,17 @@ typedef struct program_params_t {
 
     // optimization flags
     bool opt_ast_constant_folding;
-} program_params_t;
+    bool opt_ast_dead_code;
+    bool opt_ast_inline;
+    bool opt_ast_licm;
+    size_t opt_inline_threshold; // 0 for the default
+    bool opt_unroll_loops;
+    size_t opt_unroll_factor; // 0 for the default
+    bool opt_scalar_replacement;
+    bool opt_cse;
 
-extern program_params_t g_Params;
+    size_t codegen_threads; // functions generated in parallel, 0 or 1 generates them one after another
+} program_params_t;
 
 program_params_t cli_parse(int argc, char** argv);
 void cli_delete_params(program_params_t* params);
@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "arena.h"
+#include "arena_pool.h"
 #include "error.h"
 
 static arena_t* arena_get_child(const arena_t* arena) {
@@ -13,47 +14,75 @@ arena_t arena_new(size_t size) {
         .size = 0,
         .capacity = 0,
         .data = NULL,
+        .pool = NULL,
     };
     arena_init(&arr, size);
     return arr; 
 }
 
-void arena_init(arena_t* arena, size_t size) {
+// Blocks which fit are taken from the pool, bigger ones are malloc'd.
+static void _arena_init_block(arena_t* arena, size_t size, arena_block_pool_t* pool) {
     DEBUG_ASSERT(arena, "arena is null");
 
     // First bytes of data stores another arena.
     // So if we overrun this arena we can start using that one.
     arena->size = sizeof(arena_t);
     arena->capacity = size+sizeof(arena_t);
-    arena->data = malloc(arena->capacity);
+    if (pool && arena->capacity <= pool->block_size) {
+        arena->capacity = pool->block_size;
+        arena->data = arena_block_pool_acquire(pool);
+        arena->pool = pool;
+    }
+    else {
+        arena->data = malloc(arena->capacity);
+        arena->pool = NULL;
+    }
+    RUNTIME_ASSERT(arena->data, "could not allocate memory for arena!"); 
 
     {
         arena_t* child = arena_get_child(arena);
         child->capacity = 0;
         child->size = 0;
         child->data = NULL;
+        child->pool = pool; // inherited, so overflow blocks come from the same pool
     }
+}
 
-    RUNTIME_ASSERT(arena->data, "could not allocate memory for arena!"); 
+void arena_init(arena_t* arena, size_t size) {
+    _arena_init_block(arena, size, NULL);
+}
+
+void arena_init_from_pool(arena_t* arena, arena_block_pool_t* pool) {
+    DEBUG_ASSERT(pool, "pool is null");
+    _arena_init_block(arena, pool->block_size - sizeof(arena_t), pool);
 }
 
 void arena_free(arena_t* arena) {
     DEBUG_ASSERT(arena, "arena is null");
-    if (arena->data) {
-        arena_free(arena_get_child(arena));
-        free(arena->data);
+
+    // Walk the chain iteratively, it can get long.
+    while (arena->data) {
+        uint8_t* data = arena->data;
+        const arena_t Child = *arena_get_child(arena);
+        if (arena->pool) {
+            arena_block_pool_release(arena->pool, data);
+        }
+        else {
+            free(data);
+        }
+        *arena = Child;
     }
     arena->data = NULL;
     arena->capacity = 0;
     arena->size = 0;
+    arena->pool = NULL;
 }
 
 void arena_reset(arena_t* arena) {
     DEBUG_ASSERT(arena, "Arena is null. Passed null as parameter!");
-    if (arena->data) {
-        arena_reset(arena_get_child(arena));
+    for (arena_t* it = arena; it && it->data; it = arena_get_child(it)) {
+        it->size = sizeof(arena_t);
     }
-    arena->size = sizeof(arena_t);
 }
 
 void* arena_alloc(arena_t* arena, size_t size) {
@@ -61,7 +90,7 @@ void* arena_alloc(arena_t* arena, size_t size) {
     DEBUG_ASSERT(arena->data, "Data is null! Arena not initialized!");
 
     // Requested size does not fit in the arena!
-    if (arena->size + size > arena->capacity) {
+    while (arena->size + size > arena->capacity) {
         // If not already, initialize child arena if not already initialized.
         arena_t* child = arena_get_child(arena);
         if (!child->data) {
@@ -72,11 +101,11 @@ void* arena_alloc(arena_t* arena, size_t size) {
                     RealUsableCapacity : 
                     size;
             
-            arena_init(child, ChildCapacity);
+            _arena_init_block(child, ChildCapacity, child->pool);
         }
 
         // And use it to allocate the memory.
-        return arena_alloc(child, size);
+        arena = child;
     }
 
     uint8_t* ptr = &arena->data[arena->size]; 
@@ -89,3 +118,23 @@ void* arena_alloc_zeroed(arena_t* arena, size_t size) {
     memset(data, 0, size);
     return data;
 }
+
+void arena_adopt(arena_t* arena, arena_t* other) {
+    DEBUG_ASSERT(arena && arena->data, "Arena is null or not initialized!");
+    DEBUG_ASSERT(other && arena != other, "?");
+    if (!other->data) {
+        return;
+    }
+
+    // The last arena in the chain has an uninitialized child, which becomes 'other'.
+    arena_t* last = arena;
+    while (arena_get_child(last)->data) {
+        last = arena_get_child(last);
+    }
+    *arena_get_child(last) = *other;
+
+    other->data = NULL;
+    other->capacity = 0;
+    other->size = 0;
+    other->pool = NULL;
+}
@@ -8,17 +8,25 @@
     All arenas will store another arena at *data when initialized.
     e.g MEMORY [ arena_t, rest of of the allocated data ]
                    ^-- data*
+
+    An arena is only used by one thread at a time. For parallel phases every thread gets its own arena,
+    drawing its blocks from a shared 'arena_block_pool_t' (see 'arena_pool.h').
+    When a worker is done, its allocations (e.g. an AST fragment) are handed over with 'arena_adopt'.
 */
+struct arena_block_pool_t;
+
 typedef struct arena_t {
     size_t size;
     size_t capacity;
     uint8_t* data;
+    struct arena_block_pool_t* pool; // where 'data' came from, NULL if it was malloc'd.
 } arena_t;
 
 
 // Initialize the arena allocator
 arena_t arena_new(size_t available_capacity);
 void arena_init(arena_t* arena, size_t available_capacity);
+void arena_init_from_pool(arena_t* arena, struct arena_block_pool_t* pool); // blocks are returned to the pool when freed.
 void arena_free(arena_t* arena);
 void arena_reset(arena_t* arena);
 
@@ -26,4 +34,8 @@ void arena_reset(arena_t* arena);
 void* arena_alloc(arena_t* arena, size_t size); 
 void* arena_alloc_zeroed(arena_t* arena, size_t size);
 
+// Moves the blocks of 'other' to the end of 'arena' without copying, so pointers into them stay valid
+// and are freed with 'arena'. 'other' is left uninitialized. The thread which allocated from 'other' must be done with it.
+void arena_adopt(arena_t* arena, arena_t* other);
+
 #endif
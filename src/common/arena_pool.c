@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stb/stb_ds.h>
+
+#include "arena_pool.h"
+#include "arena.h"
+#include "error.h"
+
+#define ALIGN_UP(value, alignment) (((value) + (alignment) - 1) & ~((alignment) - 1))
+#define BLOCK_HEADER_SIZE ALIGN_UP(sizeof(concurrent_arena_block_t), alignof(max_align_t))
+
+void arena_block_pool_init(arena_block_pool_t* pool, size_t block_size) {
+    DEBUG_ASSERT(pool, "pool is null");
+    RUNTIME_ASSERT(block_size > sizeof(arena_t) && block_size > BLOCK_HEADER_SIZE, "block size %zu is too small", block_size);
+    RUNTIME_ASSERT(mtx_init(&pool->lock, mtx_plain) == thrd_success, "could not create a mutex");
+    pool->block_size = block_size;
+    pool->free_blocks = NULL;
+    pool->block_count = 0;
+}
+
+void arena_block_pool_cleanup(arena_block_pool_t* pool) {
+    DEBUG_ASSERT(pool, "pool is null");
+    DEBUG_ASSERT(arrlenu(pool->free_blocks) == pool->block_count, "%zu blocks are still in use", pool->block_count - arrlenu(pool->free_blocks));
+
+    for (size_t i = 0; i < arrlenu(pool->free_blocks); i++) {
+        free(pool->free_blocks[i]);
+    }
+    arrfree(pool->free_blocks);
+    mtx_destroy(&pool->lock);
+    pool->block_count = 0;
+}
+
+void* arena_block_pool_acquire(arena_block_pool_t* pool) {
+    DEBUG_ASSERT(pool, "pool is null");
+
+    void* block = NULL;
+    mtx_lock(&pool->lock);
+    if (arrlenu(pool->free_blocks)) {
+        block = arrpop(pool->free_blocks);
+    }
+    else {
+        pool->block_count++;
+    }
+    mtx_unlock(&pool->lock);
+
+    if (!block) {
+        block = malloc(pool->block_size);
+        RUNTIME_ASSERT(block, "could not allocate memory for an arena block!");
+    }
+    return block;
+}
+
+void arena_block_pool_release(arena_block_pool_t* pool, void* block) {
+    DEBUG_ASSERT(pool && block, "?");
+    mtx_lock(&pool->lock);
+    arrput(pool->free_blocks, block);
+    mtx_unlock(&pool->lock);
+}
+
+static uint8_t* _block_data(concurrent_arena_block_t* block) {
+    return (uint8_t*)block + BLOCK_HEADER_SIZE;
+}
+
+static size_t _default_capacity(const concurrent_arena_t* arena) {
+    return arena->block_size - BLOCK_HEADER_SIZE;
+}
+
+static concurrent_arena_block_t* _new_block(concurrent_arena_t* arena, size_t capacity) {
+    concurrent_arena_block_t* block = NULL;
+    const bool Pooled = arena->pool && capacity == _default_capacity(arena);
+    if (Pooled) {
+        block = arena_block_pool_acquire(arena->pool);
+    }
+    else {
+        block = malloc(BLOCK_HEADER_SIZE + capacity);
+        RUNTIME_ASSERT(block, "could not allocate memory for an arena block!");
+    }
+
+    block->next = NULL;
+    block->capacity = capacity;
+    block->pooled = Pooled;
+    atomic_init(&block->used, 0);
+    return block;
+}
+
+// Slow path, 'seen' is the block which was full.
+static void* _grow(concurrent_arena_t* arena, concurrent_arena_block_t* seen, size_t size) {
+    void* ptr = NULL;
+    mtx_lock(&arena->grow_lock);
+    concurrent_arena_block_t* current = atomic_load_explicit(&arena->current, memory_order_relaxed);
+
+    if (size > _default_capacity(arena) && current) {
+        // Own block behind the current one, so the space left in the current one isn't wasted.
+        concurrent_arena_block_t* block = _new_block(arena, size);
+        atomic_store_explicit(&block->used, size, memory_order_relaxed);
+        block->next = current->next;
+        current->next = block;
+        ptr = _block_data(block);
+    }
+    else if (current == seen) {
+        // Nobody else has replaced it yet.
+        const size_t Capacity = size > _default_capacity(arena) ? size : _default_capacity(arena);
+        concurrent_arena_block_t* block = _new_block(arena, Capacity);
+        block->next = current;
+        atomic_store_explicit(&arena->current, block, memory_order_release);
+    }
+
+    mtx_unlock(&arena->grow_lock);
+    return ptr;
+}
+
+void concurrent_arena_init(concurrent_arena_t* arena, arena_block_pool_t* pool, size_t block_size) {
+    DEBUG_ASSERT(arena, "arena is null");
+    arena->pool = pool;
+    arena->block_size = pool ? pool->block_size : block_size + BLOCK_HEADER_SIZE;
+    atomic_init(&arena->current, NULL);
+    RUNTIME_ASSERT(mtx_init(&arena->grow_lock, mtx_plain) == thrd_success, "could not create a mutex");
+}
+
+void concurrent_arena_free(concurrent_arena_t* arena) {
+    DEBUG_ASSERT(arena, "arena is null");
+
+    concurrent_arena_block_t* block = atomic_load(&arena->current);
+    while (block) {
+        concurrent_arena_block_t* next = block->next;
+        if (block->pooled) {
+            arena_block_pool_release(arena->pool, block);
+        }
+        else {
+            free(block);
+        }
+        block = next;
+    }
+    atomic_store(&arena->current, NULL);
+    mtx_destroy(&arena->grow_lock);
+}
+
+void* concurrent_arena_alloc(concurrent_arena_t* arena, size_t size) {
+    DEBUG_ASSERT(arena, "arena is null");
+    const size_t Size = ALIGN_UP(size ? size : 1, alignof(max_align_t));
+
+    for (;;) {
+        concurrent_arena_block_t* block = atomic_load_explicit(&arena->current, memory_order_acquire);
+        if (block) {
+            // Threads which overshoot the block just retry in the next one.
+            const size_t Offset = atomic_fetch_add_explicit(&block->used, Size, memory_order_relaxed);
+            if (Offset + Size <= block->capacity) {
+                return _block_data(block) + Offset;
+            }
+        }
+
+        void* ptr = _grow(arena, block, Size);
+        if (ptr) {
+            return ptr;
+        }
+    }
+}
+
+void* concurrent_arena_alloc_zeroed(concurrent_arena_t* arena, size_t size) {
+    void* data = concurrent_arena_alloc(arena, size);
+    memset(data, 0, size);
+    return data;
+}
@@ -0,0 +1,61 @@
+#ifndef COMMON_ARENA_POOL_H
+#define COMMON_ARENA_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+/*
+    Memory for parallel phases.
+
+    'arena_block_pool_t' hands out fixed size blocks to the arenas of many threads, and keeps the freed ones for reuse,
+    so threads starting up & finishing don't keep going back to malloc.
+
+    'concurrent_arena_t' is an arena which any thread can allocate from at the same time (e.g. interned strings & types
+    shared by the whole translation unit). Allocating is a single atomic add, the lock is only taken to add a block.
+
+    Ownership:
+        - An 'arena_t' belongs to one thread, give each task its own with 'arena_init_from_pool'.
+        - Allocations of a finished task are moved into the translation unit's arena with 'arena_adopt', no copying.
+          Waiting on the task's group (see 'thread_pool.h') makes its writes visible to the adopting thread.
+        - Anything in a 'concurrent_arena_t' lives until the arena is freed, so it can be pointed to from any arena.
+        - The pool must outlive every arena using it.
+*/
+
+typedef struct arena_block_pool_t {
+    size_t block_size;  // in bytes, header of the arena included
+    mtx_t lock;
+    void** free_blocks; // stb_ds array
+    size_t block_count; // blocks allocated in total
+} arena_block_pool_t;
+
+void arena_block_pool_init(arena_block_pool_t* pool, size_t block_size);
+void arena_block_pool_cleanup(arena_block_pool_t* pool);  // every arena using the pool must be freed first
+void* arena_block_pool_acquire(arena_block_pool_t* pool); // never NULL
+void arena_block_pool_release(arena_block_pool_t* pool, void* block);
+
+typedef struct concurrent_arena_block_t {
+    struct concurrent_arena_block_t* next; // previously filled block
+    size_t capacity;
+    atomic_size_t used;
+    bool pooled;
+    // data follows, aligned to 'max_align_t'
+} concurrent_arena_block_t;
+
+typedef struct concurrent_arena_t {
+    arena_block_pool_t* pool; // NULL to malloc the blocks
+    size_t block_size;
+    _Atomic(concurrent_arena_block_t*) current;
+    mtx_t grow_lock;
+} concurrent_arena_t;
+
+void concurrent_arena_init(concurrent_arena_t* arena, arena_block_pool_t* pool, size_t block_size); // block_size is ignored with a pool
+void concurrent_arena_free(concurrent_arena_t* arena);
+
+// Thread safe, guaranteed to be non NULL & aligned to 'max_align_t'.
+void* concurrent_arena_alloc(concurrent_arena_t* arena, size_t size);
+void* concurrent_arena_alloc_zeroed(concurrent_arena_t* arena, size_t size);
+
+#endif
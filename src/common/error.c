@@ -0,0 +1,59 @@
+#include <string.h>
+
+#include "error.h"
+
+_Thread_local jmp_buf* g_Jumpluff = NULL;
+_Thread_local unwind_list_t* g_Unwind = NULL;
+
+// Followed by the user's data.
+typedef struct unwind_block_t {
+    struct unwind_block_t* prev;
+    struct unwind_block_t* next;
+    unwind_list_t* list; // NULL if there was no list to own it.
+    unwind_cleanup_t cleanup;
+    max_align_t align[];
+} unwind_block_t;
+
+void* unwind_alloc(size_t size, unwind_cleanup_t cleanup) {
+    unwind_block_t* block = malloc(sizeof(unwind_block_t) + size);
+    RUNTIME_ASSERT(block, "Could not allocate %zu bytes :^(", size);
+    memset(block->align, 0, size);
+    block->prev = NULL;
+    block->next = NULL;
+    block->list = g_Unwind;
+    block->cleanup = cleanup;
+    if (block->list) {
+        block->prev = block->list->last;
+        if (block->prev) {
+            block->prev->next = block;
+        }
+        block->list->last = block;
+    }
+    return block->align;
+}
+
+void unwind_free(void* data) {
+    if (!data) {
+        return;
+    }
+    unwind_block_t* block = (unwind_block_t*)((char*)data - offsetof(unwind_block_t, align));
+    if (block->cleanup) {
+        block->cleanup(data);
+    }
+    if (block->prev) {
+        block->prev->next = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+    else if (block->list) {
+        block->list->last = block->prev;
+    }
+    free(block);
+}
+
+void unwind_free_all(unwind_list_t* list) {
+    while (list->last) {
+        unwind_free(list->last->align);
+    }
+}
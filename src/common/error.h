@@ -9,17 +9,28 @@
 #define PANIC_EXIT_CODE EXIT_FAILURE
 #define ASSERT_EXIT_CODE EXIT_FAILURE
 
-// TODO: for multithreading and easier testing the jmp_buf should not be global.
-// For tests we define this macros again.
-#if !defined(MAYO_TESTS)
-#   include <setjmp.h>
-#   define SETJUMP() (setjmp(g_Jumpluff))
-#   define LONGJUMP(num) longjmp(g_Jumpluff, num)
-    extern jmp_buf g_Jumpluff;
-#else
-#   define SETJUMP() (1)
-#   define LONGJUMP(num) (exit(1))
-#endif
+// Errors unwind to the jump buffer set by 'SETJUMP' on the current thread, so concurrent compilations don't interfere.
+// If there's none (e.g. in tests) the program exits instead.
+// Restore the previous 'g_Jumpluff' when the function which called 'SETJUMP' returns.
+#include <setjmp.h>
+#define SETJUMP(buf) (g_Jumpluff = &(buf), setjmp(buf))
+#define LONGJUMP(num) (g_Jumpluff ? longjmp(*g_Jumpluff, num) : exit(num))
+extern _Thread_local jmp_buf* g_Jumpluff;
+
+// Scratch memory which would leak if an error unwinds past the function using it, is owned by the function which set
+// the jump instead. 'unwind_alloc' allocates it on the current thread's 'g_Unwind' (if any), and the user gives it back
+// with 'unwind_free' when it's done. Whatever is left after an error is freed with 'unwind_free_all'.
+typedef void (*unwind_cleanup_t)(void* data); // frees what 'data' points to, not 'data' itself.
+
+typedef struct unwind_list_t {
+    struct unwind_block_t* last;
+} unwind_list_t;
+
+extern _Thread_local unwind_list_t* g_Unwind;
+
+void* unwind_alloc(size_t size, unwind_cleanup_t cleanup); // zeroed, never NULL.
+void unwind_free(void* data);
+void unwind_free_all(unwind_list_t* list);
 
 #define PANIC(...)                                                                                      \
     do {                                                                                                \
@@ -0,0 +1,3 @@
+// Implementation of stb_ds for the 'mayo' library, the tests define it in 'tests/test_main.c' instead.
+#define STB_DS_IMPLEMENTATION
+#include <stb/stb_ds.h>
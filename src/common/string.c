@@ -281,14 +281,14 @@ void print_str_unescaped(const char* str) {
 }
 
 const char* int_to_str(int num) {
-    static char str[21] = { 0 }; // largest 64 bit number has at max, 20 digits + 1 for null-terminator
+    static _Thread_local char str[21] = { 0 }; // largest 64 bit number has at max, 20 digits + 1 for null-terminator
     memset((void*)&str, 0, sizeof(str));
     sprintf((char*)&str, "%i", num);
     return (char*)&str;
 }
 
 const char* uint_to_str(unsigned int num) {
-    static char str[21] = { 0 }; // largest 64 bit number has at max, 20 digits + 1 for null-terminator
+    static _Thread_local char str[21] = { 0 }; // largest 64 bit number has at max, 20 digits + 1 for null-terminator
     memset((void*)&str, 0, sizeof(str));
     sprintf((char*)&str, "%u", num);
     return (char*)&str;
@@ -387,3 +387,12 @@ bool issym(char c) {
     }
     return false;
 }
+
+uint32_t str_hash(const char* str) {
+    uint32_t hash = 2166136261u;
+    for (; *str; str++) {
+        hash ^= (uint8_t)*str;
+        hash *= 16777619u;
+    }
+    return hash;
+}
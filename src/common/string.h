@@ -56,5 +56,6 @@ bool is_integer(const char* str);
 bool is_floating_point(const char* str);
 bool issym(char c);
 float str2f32(const char* str);
+uint32_t str_hash(const char* str); // FNV-1a
 
 #endif
@@ -59,28 +59,22 @@ void* sym_table_get(const sym_table_t* table, const char* key) {
     const symbol_t* sym = &table->head[Index];
 
     const size_t IterLimit = 8;
-    for (size_t i = 0; i < IterLimit; i++) {
-        // Index doesn't exist
-        if (!sym->key) {
-            if (table->parent) {
-                return sym_table_get(table->parent, key);
-            }
-            return NULL;
+    for (size_t i = 0; sym && sym->key; i++) {
+        if (i == IterLimit) {
+            PANIC("Iteration limit reached!");
         }
 
         // Key existed
         if (strcmp(sym->key, key) == 0) {
             return sym->data;
         }
-
-        // collision
-        if (!sym->other) {
-            return NULL;
-        }
-        sym = sym->other;
+        sym = sym->other; // collision
     }
 
-    PANIC("Iteration limit reached!");
+    // Not in this table
+    if (table->parent) {
+        return sym_table_get(table->parent, key);
+    }
     return NULL;
 }
 
@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L // sysconf
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+#include "error.h"
+
+#define DEQUE_INITIAL_CAPACITY 64
+
+// Which pool & deque the current thread pushes to, only set on worker threads.
+static _Thread_local thread_pool_t* s_CurrentPool = NULL;
+static _Thread_local size_t s_CurrentWorker = 0;
+
+static void _deque_init(task_deque_t* deque) {
+    RUNTIME_ASSERT(mtx_init(&deque->lock, mtx_plain) == thrd_success, "could not create a mutex");
+    deque->capacity = DEQUE_INITIAL_CAPACITY;
+    deque->tasks = malloc(sizeof(task_t) * deque->capacity);
+    RUNTIME_ASSERT(deque->tasks, "could not allocate memory for a task deque!");
+    deque->top = 0;
+    deque->bottom = 0;
+    atomic_init(&deque->size, 0);
+}
+
+static void _deque_cleanup(task_deque_t* deque) {
+    DEBUG_ASSERT(atomic_load(&deque->size) == 0, "task deque still has tasks");
+    mtx_destroy(&deque->lock);
+    free(deque->tasks);
+    deque->tasks = NULL;
+}
+
+static void _deque_push_bottom(task_deque_t* deque, task_t task) {
+    mtx_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity) {
+        // Unwrap to the beginning of the new buffer.
+        const size_t NewCapacity = deque->capacity * 2;
+        task_t* tasks = malloc(sizeof(task_t) * NewCapacity);
+        RUNTIME_ASSERT(tasks, "could not allocate memory for a task deque!");
+        for (size_t i = deque->top; i < deque->bottom; i++) {
+            tasks[i - deque->top] = deque->tasks[i & (deque->capacity - 1)];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->bottom -= deque->top;
+        deque->top = 0;
+        deque->capacity = NewCapacity;
+    }
+    deque->tasks[deque->bottom & (deque->capacity - 1)] = task;
+    deque->bottom++;
+    atomic_fetch_add(&deque->size, 1);
+    mtx_unlock(&deque->lock);
+}
+
+static bool _deque_pop_bottom(task_deque_t* deque, task_t* task) {
+    if (!atomic_load_explicit(&deque->size, memory_order_relaxed)) {
+        return false;
+    }
+
+    bool found = false;
+    mtx_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom & (deque->capacity - 1)];
+        atomic_fetch_sub(&deque->size, 1);
+        found = true;
+    }
+    mtx_unlock(&deque->lock);
+    return found;
+}
+
+static bool _deque_steal_top(task_deque_t* deque, task_t* task) {
+    if (!atomic_load_explicit(&deque->size, memory_order_relaxed)) {
+        return false;
+    }
+
+    // Don't wait on a busy deque, there might be work in the others.
+    if (mtx_trylock(&deque->lock) != thrd_success) {
+        return false;
+    }
+
+    bool found = false;
+    if (deque->bottom != deque->top) {
+        *task = deque->tasks[deque->top & (deque->capacity - 1)];
+        deque->top++;
+        atomic_fetch_sub(&deque->size, 1);
+        found = true;
+    }
+    mtx_unlock(&deque->lock);
+    return found;
+}
+
+// Deque of the current thread in 'pool', the shared one if it's not a worker of it.
+static size_t _current_deque(const thread_pool_t* pool) {
+    return s_CurrentPool == pool ? s_CurrentWorker : pool->worker_count;
+}
+
+// Own deque first (newest task, likely still in the cache), then steal from the others.
+static bool _find_task(thread_pool_t* pool, size_t own, task_t* task) {
+    bool found = _deque_pop_bottom(&pool->deques[own], task);
+
+    const size_t DequeCount = pool->worker_count + 1;
+    for (size_t i = 1; !found && i < DequeCount; i++) {
+        found = _deque_steal_top(&pool->deques[(own + i) % DequeCount], task);
+    }
+
+    if (found) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+    return found;
+}
+
+static void _run_task(const task_t* task) {
+    task->fn(task->user);
+    atomic_fetch_sub_explicit(&task->group->pending, 1, memory_order_release);
+}
+
+static int _worker_main(void* arg) {
+    thread_pool_worker_t* worker = arg;
+    thread_pool_t* pool = worker->pool;
+    s_CurrentPool = pool;
+    s_CurrentWorker = worker->index;
+
+    while (!atomic_load(&pool->stop)) {
+        task_t task;
+        if (_find_task(pool, worker->index, &task)) {
+            _run_task(&task);
+            continue;
+        }
+
+        // Nothing to do, sleep until something gets spawned.
+        mtx_lock(&pool->sleep_lock);
+        atomic_fetch_add(&pool->sleeping, 1);
+        while (!atomic_load(&pool->queued) && !atomic_load(&pool->stop)) {
+            cnd_wait(&pool->wake, &pool->sleep_lock);
+        }
+        atomic_fetch_sub(&pool->sleeping, 1);
+        mtx_unlock(&pool->sleep_lock);
+    }
+
+    s_CurrentPool = NULL;
+    return 0;
+}
+
+size_t thread_pool_default_size(void) {
+    const long Count = sysconf(_SC_NPROCESSORS_ONLN);
+    return Count > 0 ? (size_t)Count : 1;
+}
+
+void thread_pool_init(thread_pool_t* pool, size_t worker_count) {
+    DEBUG_ASSERT(pool, "pool is null");
+
+    pool->worker_count = worker_count;
+    pool->workers = NULL;
+    pool->deques = NULL;
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->sleeping, 0);
+    atomic_init(&pool->stop, false);
+    if (thread_pool_is_serial(pool)) {
+        return;
+    }
+
+    RUNTIME_ASSERT(mtx_init(&pool->sleep_lock, mtx_plain) == thrd_success, "could not create a mutex");
+    RUNTIME_ASSERT(cnd_init(&pool->wake) == thrd_success, "could not create a condition variable");
+
+    pool->deques = malloc(sizeof(task_deque_t) * (worker_count + 1));
+    pool->workers = malloc(sizeof(thread_pool_worker_t) * worker_count);
+    RUNTIME_ASSERT(pool->deques && pool->workers, "could not allocate memory for the thread pool!");
+    for (size_t i = 0; i < worker_count + 1; i++) {
+        _deque_init(&pool->deques[i]);
+    }
+
+    // Deques have to exist before any worker starts stealing.
+    for (size_t i = 0; i < worker_count; i++) {
+        pool->workers[i] = (thread_pool_worker_t) { .pool = pool, .index = i };
+        RUNTIME_ASSERT(
+            thrd_create(&pool->workers[i].thread, _worker_main, &pool->workers[i]) == thrd_success,
+            "could not create a worker thread"
+        );
+    }
+}
+
+void thread_pool_cleanup(thread_pool_t* pool) {
+    DEBUG_ASSERT(pool, "pool is null");
+    if (thread_pool_is_serial(pool)) {
+        return;
+    }
+
+    mtx_lock(&pool->sleep_lock);
+    atomic_store(&pool->stop, true);
+    cnd_broadcast(&pool->wake);
+    mtx_unlock(&pool->sleep_lock);
+
+    for (size_t i = 0; i < pool->worker_count; i++) {
+        thrd_join(pool->workers[i].thread, NULL);
+    }
+    for (size_t i = 0; i < pool->worker_count + 1; i++) {
+        _deque_cleanup(&pool->deques[i]);
+    }
+
+    mtx_destroy(&pool->sleep_lock);
+    cnd_destroy(&pool->wake);
+    free(pool->deques);
+    free(pool->workers);
+    pool->deques = NULL;
+    pool->workers = NULL;
+    pool->worker_count = 0;
+}
+
+bool thread_pool_is_serial(const thread_pool_t* pool) {
+    return pool->worker_count == 0;
+}
+
+void task_group_init(task_group_t* group, thread_pool_t* pool) {
+    DEBUG_ASSERT(group && pool, "?");
+    group->pool = pool;
+    atomic_init(&group->pending, 0);
+}
+
+void task_group_spawn(task_group_t* group, fn_task fn, void* user) {
+    DEBUG_ASSERT(group && fn, "?");
+    thread_pool_t* pool = group->pool;
+    if (thread_pool_is_serial(pool)) {
+        fn(user);
+        return;
+    }
+
+    // 'queued' goes up before the push, so it never underflows when the task is taken right away.
+    atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+    atomic_fetch_add(&pool->queued, 1);
+    const task_t Task = { .fn = fn, .user = user, .group = group };
+    _deque_push_bottom(&pool->deques[_current_deque(pool)], Task);
+
+    if (atomic_load(&pool->sleeping)) {
+        mtx_lock(&pool->sleep_lock);
+        cnd_signal(&pool->wake);
+        mtx_unlock(&pool->sleep_lock);
+    }
+}
+
+void task_group_wait(task_group_t* group) {
+    DEBUG_ASSERT(group, "group is null");
+    thread_pool_t* pool = group->pool;
+    if (thread_pool_is_serial(pool)) {
+        return;
+    }
+
+    // Help out instead of blocking, so tasks can wait on groups of their own without deadlocking.
+    const size_t Own = _current_deque(pool);
+    while (atomic_load_explicit(&group->pending, memory_order_acquire)) {
+        task_t task;
+        if (_find_task(pool, Own, &task)) {
+            _run_task(&task);
+        }
+        else {
+            thrd_yield();
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef COMMON_THREAD_POOL_H
+#define COMMON_THREAD_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+/*
+    Work-stealing task scheduler.
+    Every worker has its own deque: the owner pushes & pops from the bottom (newest first),
+    idle workers steal from the top of the others (oldest first). Threads which aren't workers
+    (e.g. main) push to a shared deque, which the workers steal from as well.
+
+    Tasks are spawned into a group, waiting on a group runs queued tasks on the waiting thread
+    until every task of the group has finished, so tasks can spawn & wait on groups of their own.
+
+    Usage:
+        thread_pool_t pool;
+        thread_pool_init(&pool, thread_pool_default_size());
+
+        task_group_t group;
+        task_group_init(&group, &pool);
+        for (size_t i = 0; i < FnCount; i++) {
+            task_group_spawn(&group, generate_function, &functions[i]);
+        }
+        task_group_wait(&group);
+
+        thread_pool_cleanup(&pool);
+
+    With 0 workers the pool is serial: tasks run right away on the spawning thread, in the order they're spawned.
+*/
+
+typedef void (*fn_task)(void* user);
+
+struct task_group_t;
+
+typedef struct task_t {
+    fn_task fn;
+    void* user;
+    struct task_group_t* group;
+} task_t;
+
+// Ring buffer, grows when full.
+typedef struct task_deque_t {
+    mtx_t lock;
+    task_t* tasks;
+    size_t capacity;    // always a power of 2
+    size_t top;         // stolen from
+    size_t bottom;      // pushed & popped by the owner
+    atomic_size_t size; // so empty deques can be skipped without locking
+} task_deque_t;
+
+struct thread_pool_t;
+
+typedef struct thread_pool_worker_t {
+    struct thread_pool_t* pool;
+    size_t index;
+    thrd_t thread;
+} thread_pool_worker_t;
+
+typedef struct thread_pool_t {
+    size_t worker_count;
+    thread_pool_worker_t* workers;
+    task_deque_t* deques;   // one per worker + one shared by the other threads (last)
+
+    atomic_size_t queued;   // tasks in all of the deques
+    atomic_size_t sleeping; // workers waiting for tasks
+    atomic_bool stop;
+    mtx_t sleep_lock;
+    cnd_t wake;
+} thread_pool_t;
+
+typedef struct task_group_t {
+    thread_pool_t* pool;
+    atomic_size_t pending; // spawned tasks which haven't finished yet
+} task_group_t;
+
+// Threads available on the machine.
+size_t thread_pool_default_size(void);
+
+void thread_pool_init(thread_pool_t* pool, size_t worker_count);
+void thread_pool_cleanup(thread_pool_t* pool); // all groups must have been waited on.
+bool thread_pool_is_serial(const thread_pool_t* pool);
+
+void task_group_init(task_group_t* group, thread_pool_t* pool);
+void task_group_spawn(task_group_t* group, fn_task fn, void* user);
+void task_group_wait(task_group_t* group);
+
+#endif
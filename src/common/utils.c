@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <stb/stb_ds.h>
 
 #include "utils.h"
 
@@ -80,3 +81,12 @@ void print_spaces(size_t space_count) {
         printf(" ");
     }
 }
+
+bool str_array_contains(const char** array, const char* str) {
+    for (size_t i = 0; i < arrlenu(array); i++) {
+        if (strcmp(array[i], str) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
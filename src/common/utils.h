@@ -56,4 +56,5 @@ bool is_dir(const char *path);
 char* read_file_contents(const char* fpath);
 bool write_file_contents(const char* fpath, const char* contents);
 size_t count_digits(size_t num);
+bool str_array_contains(const char** array, const char* str); // 'array' is an stb array
 void print_spaces(size_t space_count);
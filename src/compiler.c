@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 200809L // open_memstream
+#include <stdio.h>
+#include <string.h>
+#include <stb/stb_ds.h>
+
+#include "compiler.h"
+
+#include "common/arena.h"
+#include "common/error.h"
+#include "common/stats.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantics.h"
+#include "parser/ast_print.h"
+#include "backend_qbe.h"
+#include "optimizer/optimize.h"
+
+// Use "optimal" size for debug builds. Just so we can test more of our arena implementation.
+#ifdef NDEBUG
+#define ARENA_CAPACITY 4096
+#else
+#define ARENA_CAPACITY sizeof(ast_node_t) * 2
+#endif
+
+// Everything allocated during a compilation, lives in the caller of '_compile' so it can be cleaned up after a longjmp.
+typedef struct compile_unit_t {
+    arena_t arena;
+    lexer_t lexer;
+    parser_t parser;
+    unwind_list_t unwind; // scratch memory of the phases, left behind by an error
+    const char* path;   // either path or source is set
+    const char* source;
+} compile_unit_t;
+
+static void _compile_unit_cleanup(compile_unit_t* unit) {
+    unwind_free_all(&unit->unwind);
+    parser_cleanup(&unit->parser);
+    lexer_cleanup(&unit->lexer);
+    arena_free(&unit->arena);
+}
+
+static int _compile(mayo_compiler_t* compiler, compile_unit_t* unit, FILE* out) {
+    const program_params_t* Params = &compiler->params;
+    jmp_buf* previous_jump = g_Jumpluff;
+    unwind_list_t* previous_unwind = g_Unwind;
+    g_Unwind = &unit->unwind;
+
+    compiler->stats = (mayo_compile_stats_t) { 0 };
+    compiler->exit_code = SETJUMP(compiler->jump);
+    if (!compiler->exit_code) {
+        // Lex
+        PERF_BEGIN(LexBegin);
+        if (unit->path) {
+            lexer_init(&unit->lexer, &unit->arena, unit->path);
+        }
+        else {
+            // The lexer takes ownership of the content, copy it to the arena so it's freed with it.
+            const size_t Size = strlen(unit->source) + 1;
+            char* content = arena_alloc(&unit->arena, Size);
+            memcpy(content, unit->source, Size);
+            lexer_str(&unit->lexer, &unit->arena, content, NULL);
+        }
+        unit->parser = parser_new(&unit->arena, &unit->lexer);
+
+        lexer_lex(&unit->lexer);
+        if (Params->print_tokens) {
+            const size_t TkCount = arrlenu(unit->lexer.tokens);
+            for (size_t tk_idx = 0; tk_idx < TkCount; tk_idx++) {
+                token_print_pretty(&unit->lexer.tokens[tk_idx]);
+            }
+        }
+        compiler->stats.lex_duration = PERF_END(LexBegin);
+
+        // Parsing
+        PERF_BEGIN(ParseBegin);
+        parser_parse(&unit->parser);
+        compiler->stats.parse_duration = PERF_END(ParseBegin);
+
+        PERF_BEGIN(AnalysisBegin);
+        semantic_analysis(&unit->arena, unit->parser.node_root);
+        perform_ast_optimizations(&unit->arena, unit->parser.node_root, Params);
+        compiler->stats.analysis_duration = PERF_END(AnalysisBegin);
+
+        if (Params->print_ast) {
+            print_ast_tree(unit->parser.node_root);
+        }
+
+        // Output qbe
+        PERF_BEGIN(QbeBegin);
+        generate_qbe(out, unit->parser.node_root, Params);
+        compiler->stats.qbe_gen_duration = PERF_END(QbeBegin);
+    }
+
+    g_Jumpluff = previous_jump;
+    g_Unwind = previous_unwind;
+    return compiler->exit_code;
+}
+
+void mayo_compiler_init(mayo_compiler_t* compiler, const program_params_t* params) {
+    DEBUG_ASSERT(compiler && params, "?");
+    *compiler = (mayo_compiler_t) {
+        .params = *params,
+        .exit_code = 0,
+        .stats = { 0 }
+    };
+}
+
+void mayo_compiler_cleanup(mayo_compiler_t* compiler) {
+    DEBUG_ASSERT(compiler, "?");
+    *compiler = (mayo_compiler_t) { 0 };
+}
+
+int mayo_compile_file(mayo_compiler_t* compiler, const char* path, FILE* out) {
+    DEBUG_ASSERT(compiler && path && out, "?");
+
+    compile_unit_t unit = { .path = path };
+    arena_init(&unit.arena, ARENA_CAPACITY);
+
+    const int ExitCode = _compile(compiler, &unit, out);
+    _compile_unit_cleanup(&unit);
+    return ExitCode;
+}
+
+char* mayo_compile_to_qbe(mayo_compiler_t* compiler, const char* source, size_t* out_length) {
+    DEBUG_ASSERT(compiler && source, "?");
+
+    char* buffer = NULL;
+    size_t length = 0;
+    FILE* out = open_memstream(&buffer, &length);
+    RUNTIME_ASSERT(out, "could not open a memory stream");
+
+    compile_unit_t unit = { .source = source };
+    arena_init(&unit.arena, ARENA_CAPACITY);
+
+    const int ExitCode = _compile(compiler, &unit, out);
+    _compile_unit_cleanup(&unit);
+    fclose(out);
+
+    if (ExitCode) {
+        free(buffer);
+        return NULL;
+    }
+    if (out_length) {
+        *out_length = length;
+    }
+    return buffer;
+}
@@ -0,0 +1,49 @@
+#ifndef MAYO_COMPILER_H
+#define MAYO_COMPILER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include "cli/cli.h"
+
+/*
+    Owns all the state of a single compilation, so multiple compilers can run at the same time (one per thread).
+    Errors during a compilation unwind back to the compiler (see 'SETJUMP'), and are reported by the return value.
+
+    Usage:
+        mayo_compiler_t compiler;
+        mayo_compiler_init(&compiler, &params);
+        size_t len;
+        char* qbe = mayo_compile_to_qbe(&compiler, "fn main() -> i32 { return 0; }", &len);
+        ...
+        free(qbe);
+        mayo_compiler_cleanup(&compiler);
+*/
+
+typedef struct mayo_compile_stats_t {
+    clock_t lex_duration;
+    clock_t parse_duration;
+    clock_t analysis_duration;
+    clock_t qbe_gen_duration;
+} mayo_compile_stats_t;
+
+typedef struct mayo_compiler_t {
+    program_params_t params; // not owned, only the flags are used.
+    jmp_buf jump;
+    int exit_code; // of the last compilation, 0 on success.
+    mayo_compile_stats_t stats;
+} mayo_compiler_t;
+
+void mayo_compiler_init(mayo_compiler_t* compiler, const program_params_t* params);
+void mayo_compiler_cleanup(mayo_compiler_t* compiler);
+
+// Writes the QBE IL of the file at 'path' to 'out'. Returns 0 on success.
+int mayo_compile_file(mayo_compiler_t* compiler, const char* path, FILE* out);
+
+// Returns the QBE IL of 'source' as a null-terminated string, which the caller must free(), or NULL if compilation failed.
+// 'out_length' is optional.
+char* mayo_compile_to_qbe(mayo_compiler_t* compiler, const char* source, size_t* out_length);
+
+#endif
@@ -18,7 +18,7 @@
 #define LEXER_ERROR(pos, ...)                   \
     do {                                        \
         PRINT_ERROR_IN_FILE(pos, __VA_ARGS__);  \
-        exit(1);                                \
+        LONGJUMP(1);                            \
     } while(0)
 
 void lexer_init(lexer_t* lexer, arena_t* arena, const char* fpath) {
@@ -234,7 +234,9 @@ void lexer_lex(lexer_t* lexer) {
         if (SymbolKind != TOK_NONE) {
             // Floats: don't capture DOT after numbers. Push the dot to word.
             // Also having this after eat_symbol, checks cases like "0..9234", which would be invalid and not captured by this.
-            if (SymbolKind == TOK_DOT && is_integer(lexer->word.chars)) {
+            // A letter after the dot is a method on the number instead, like "0..10.step(2)".
+            const char Next = lexer_peek(lexer);
+            if (SymbolKind == TOK_DOT && is_integer(lexer->word.chars) && !isalpha(Next) && Next != '_') {
                 string_push(&lexer->word, '.');
                 continue;
             }            
@@ -9,7 +9,7 @@
 #define LEXER_ERROR(pos, ...)                   \
     do {                                        \
         PRINT_ERROR_IN_FILE(pos, __VA_ARGS__);  \
-        exit(1);                                \
+        LONGJUMP(1);                            \
     } while(0)
 
 char lexer_eat(lexer_t* lexer) {
@@ -68,6 +68,7 @@ _DEF(TOK_KEYWORD_CONST, "const"),
 _DEF(TOK_KEYWORD_LET, "let"),
 _DEF(TOK_KEYWORD_STRUCT, "struct"),
 _DEF(TOK_KEYWORD_EXTERN, "extern"),
+_DEF(TOK_KEYWORD_INLINE, "inline"),
 #endif
 
 #if defined(_TK_VALUES)
@@ -7,107 +7,58 @@
 #include "common/stats.h"
 #include "common/utils.h"
 
-#include "lexer.h"
-#include "parser.h"
-#include "semantics.h"
-#include "parser/ast_type.h"
-#include "parser/ast_print.h"
-#include "backend_qbe.h"
-#include "optimizer/optimize.h"
+#include "compiler.h"
 #include "string.h"
 
-#define STB_DS_IMPLEMENTATION
 #include <stb/stb_ds.h>
 
-jmp_buf g_Jumpluff;
-
-// Use "optimal" size for debug builds. Just so we can test more of our arena implementation.
-#ifdef NDEBUG
-#define ARENA_CAPACITY 4096
-#else
-#define ARENA_CAPACITY sizeof(ast_node_t) * 2
-#endif
-
+// Errors while parsing the arguments unwind back here, so 'main' doesn't need to worry about its locals being clobbered.
+static int _parse_params(int argc, char** argv, program_params_t* params) {
+    jmp_buf jump;
+    const int ExitCode = SETJUMP(jump);
+    if (!ExitCode) {
+        *params = cli_parse(argc, argv);
+        RUNTIME_ASSERT(!params->do_compilation || arrlenu(params->input_files) > 0, "no input files :^(");
+    }
+    g_Jumpluff = NULL;
+    return ExitCode;
+}
 
 int main(int argc, char** argv) {
     clock_t arg_parse_duration = 0;
-    clock_t lex_duration = 0;
-    clock_t parse_duration = 0;
-    clock_t analysis_duration = 0;
-    clock_t qbe_gen_duration = 0;
+    mayo_compiler_t compiler = { 0 };
+    program_params_t params = { 0 };
 
     PERF_BEGIN(ProgramBegin);
     
-    int exit_code = SETJUMP();
-    if (!exit_code) {
-        g_Params = cli_parse(argc, argv);
-        if (!g_Params.do_compilation) {
-            goto clean_params;
-        }
-    }
-    else {
+    int exit_code = _parse_params(argc, argv, &params);
+    if (exit_code || !params.do_compilation) {
         goto clean_params;
     }
     arg_parse_duration = PERF_END(ProgramBegin);
-
-    // Get path 
-    const size_t InputFileCount = arrlenu(g_Params.input_files);
-    RUNTIME_ASSERT(InputFileCount > 0, "no input files :^(");
-    const char* Path = g_Params.input_files[0];
-
-    // Initialize lexer & parser
-    arena_t arena;
-    arena_init(&arena, ARENA_CAPACITY);
-
-    lexer_t lexer = { 0 };
-    lexer_init(&lexer, &arena, Path);
-    parser_t parser = parser_new(&arena, &lexer);
-
-    exit_code = SETJUMP();
-    if (!exit_code) {
-        // Lex
-        PERF_BEGIN(LexBegin);
-        lexer_lex(&lexer);
-        if (g_Params.print_tokens) {
-            const size_t TkCount = arrlenu(lexer.tokens);
-            for (size_t tk_idx = 0; tk_idx < TkCount; tk_idx++) {
-                token_print_pretty(&lexer.tokens[tk_idx]);
-            }
-        }
-        lex_duration = PERF_END(LexBegin);
-
-        // Parsing
-        PERF_BEGIN(ParseBegin);
-        parser_parse(&parser);
-        parse_duration = PERF_END(ParseBegin);
-
-        PERF_BEGIN(AnalysisBegin);
-        semantic_analysis(&arena, parser.node_root);
-        perform_ast_optimizations(parser.node_root);
-        analysis_duration = PERF_END(AnalysisBegin);
-
-        if (g_Params.print_ast) {
-            print_ast_tree(parser.node_root);
-        }
-
-        // Output qbe
-        PERF_BEGIN(QbeBegin);
-        FILE* f = fopen("output.ssa", "w");
-        generate_qbe(f, parser.node_root);
-        fclose(f);
-        qbe_gen_duration = PERF_END(QbeBegin);
-
+    const char* Path = params.input_files[0];
+
+    // Output qbe
+    mayo_compiler_init(&compiler, &params);
+    FILE* f = fopen("output.ssa", "w");
+    RUNTIME_ASSERT(f, "could not open 'output.ssa'");
+    exit_code = mayo_compile_file(&compiler, Path, f);
+    fclose(f);
+    if (exit_code) {
+        remove("output.ssa");
+    }
+    else {
         CMD("qbe output.ssa -o output.s");
 
         // generate command to gcc
         {
             const char* CmdTemplate = "gcc -o output.o output.s ";
-            const size_t DesiredLen = strlen(g_Params.cflags) + strlen(CmdTemplate) + 1;
+            const size_t DesiredLen = strlen(params.cflags) + strlen(CmdTemplate) + 1;
             
             // assemble
             char* cmd = malloc(DesiredLen);
             strcpy(cmd, CmdTemplate);
-            strcat(cmd, g_Params.cflags);
+            strcat(cmd, params.cflags);
             CMD(cmd);
             free(cmd);
         }
@@ -115,25 +66,20 @@ int main(int argc, char** argv) {
         CMD("./output.o");
     }
     
-    parser_cleanup(&parser);
-    lexer_cleanup(&lexer); 
-    arena_free(&arena);
 clean_params:;
-    cli_delete_params(&g_Params);
+    cli_delete_params(&params);
     
     clock_t ProgramDuration = PERF_END(ProgramBegin);
 
     // Print performance
     printf("PERFORMANCE:\n");
     printf("  Arg parse duration: ");     PRINT_DURATION(arg_parse_duration); printf("\n");
-    printf("  Code lex duration: ");      PRINT_DURATION(lex_duration); printf("\n");
-    printf("  Code parse duration: ");    PRINT_DURATION(parse_duration); printf("\n");
-    printf("  Code analysis duration: "); PRINT_DURATION(analysis_duration); printf("\n");
-    printf("  Qbe Generate duration: ");       PRINT_DURATION(qbe_gen_duration); printf("\n");
+    printf("  Code lex duration: ");      PRINT_DURATION(compiler.stats.lex_duration); printf("\n");
+    printf("  Code parse duration: ");    PRINT_DURATION(compiler.stats.parse_duration); printf("\n");
+    printf("  Code analysis duration: "); PRINT_DURATION(compiler.stats.analysis_duration); printf("\n");
+    printf("  Qbe Generate duration: ");       PRINT_DURATION(compiler.stats.qbe_gen_duration); printf("\n");
     printf("  Program duration: ");       PRINT_DURATION(ProgramDuration); printf("\n");
 
-
+    mayo_compiler_cleanup(&compiler);
     return exit_code;
 } 
-
-
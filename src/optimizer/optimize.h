@@ -1,8 +1,25 @@
 #ifndef MAYO_OPTIMIZE_H
 #define MAYO_OPTIMIZE_H
 
+#include <stddef.h>
+#include <stdbool.h>
+
+// Max size of a function in AST nodes to be inlined, when not set in the params.
+#define INLINE_DEFAULT_THRESHOLD 40
+
+struct arena_t;
 struct ast_node_t;
+struct program_params_t;
+
+// New nodes are allocated from the arena of the AST.
+void perform_ast_optimizations(struct arena_t* arena, struct ast_node_t* ast, const struct program_params_t* params);
+
+// Individual passes, 'perform_ast_optimizations' runs the ones enabled in the params.
+void ast_inline_functions(struct arena_t* arena, struct ast_node_t* ast, size_t threshold); // 'inline fn' regardless of the threshold
+void ast_eliminate_dead_code(struct ast_node_t* ast);
+void ast_hoist_loop_invariants(struct arena_t* arena, struct ast_node_t* ast);
 
-void perform_ast_optimizations(struct ast_node_t* ast);
+// Has no side effects & owns no arrays, so it can be dropped or reordered.
+bool ast_is_pure(struct ast_node_t* ast);
 
 #endif
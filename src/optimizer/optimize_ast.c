@@ -1,155 +1,492 @@
+#include <string.h>
 #include <stb/stb_ds.h>
 #include "optimize.h"
 
 #include "../cli/cli.h"
 #include "../parser/ast_type.h"
+#include "../parser/ast_visit.h"
 
-#define DO_ON_CHILDREN(body, code)                      \
-    do {                                                \
-        size_t _count = arrlenu(body);                  \
-        for (size_t _it = 0; _it < _count; _it++ ) {    \
-            code;                                       \
-        }                                               \
-    } while(0)
+/*
+    Constant folding & algebraic simplification, done bottom-up so folded children fold their parents as well.
+    Values are computed with the width & signedness of the operands' 'expr_type', e.g. 'cast<u8>(200) + cast<u8>(100)' is 44.
+*/
 
-static void _ast_constant_folding(struct ast_node_t* ast) {
-    switch (ast->kind) {
-        case AST_TRANSLATION_UNIT: {
-            DO_ON_CHILDREN(
-                ast->data.translation_unit.body, 
-                _ast_constant_folding(ast->data.translation_unit.body[_it])
-            );
-            break;
+typedef enum constant_kind_t {
+    CONSTANT_NONE,
+    CONSTANT_INTEGER,   // integers, chars & bools
+    CONSTANT_FLOAT,
+} constant_kind_t;
+
+typedef struct constant_t {
+    constant_kind_t kind;
+    int64_t integer;    // bit pattern, wrapped to the type
+    double f;
+} constant_t;
+
+typedef enum value_class_t {
+    VALUE_OTHER,
+    VALUE_BOOL,
+    VALUE_INTEGER,
+    VALUE_FLOAT,
+} value_class_t;
+
+typedef struct value_type_t {
+    value_class_t kind;
+    uint32_t bits;
+    bool is_signed;
+} value_type_t;
+
+static value_type_t _value_type(const datatype_t* type) {
+    if (type->kind != DATATYPE_PRIMITIVE || !type->typename) {
+        return (value_type_t) { .kind = VALUE_OTHER };
+    }
+
+    static const struct {
+        const char* typename;
+        value_type_t type;
+    } sTypes[] = {
+        { "bool", { VALUE_BOOL, 1, false } },
+        { "char", { VALUE_INTEGER, 8, false } }, // backend extends chars as unsigned
+        { "i8",   { VALUE_INTEGER, 8, true } },
+        { "u8",   { VALUE_INTEGER, 8, false } },
+        { "i16",  { VALUE_INTEGER, 16, true } },
+        { "u16",  { VALUE_INTEGER, 16, false } },
+        { "i32",  { VALUE_INTEGER, 32, true } },
+        { "u32",  { VALUE_INTEGER, 32, false } },
+        { "i64",  { VALUE_INTEGER, 64, true } },
+        { "u64",  { VALUE_INTEGER, 64, false } },
+        { "f32",  { VALUE_FLOAT, 32, true } },
+        { "f64",  { VALUE_FLOAT, 64, true } },
+    };
+    for (size_t i = 0; i < sizeof(sTypes) / sizeof(sTypes[0]); i++) {
+        if (strcmp(sTypes[i].typename, type->typename) == 0) {
+            return sTypes[i].type;
         }
-        case AST_FUNCTION_DECLARATION: {
-            DO_ON_CHILDREN(
-                ast->data.function_declaration.body, 
-                _ast_constant_folding(ast->data.function_declaration.body[_it])
-            );
+    }
+    return (value_type_t) { .kind = VALUE_OTHER };
+}
+
+static int64_t _wrap_integer(int64_t value, value_type_t type) {
+    if (type.kind == VALUE_BOOL) {
+        return value != 0;
+    }
+    if (type.bits >= 64) {
+        return value;
+    }
+
+    const uint64_t Mask = (UINT64_C(1) << type.bits) - 1;
+    uint64_t bits = (uint64_t)value & Mask;
+    if (type.is_signed && (bits >> (type.bits - 1))) {
+        bits |= ~Mask; // sign extend
+    }
+    return (int64_t)bits;
+}
+
+static constant_t _get_constant(const ast_node_t* ast) {
+    switch (ast->kind) {
+        case AST_BOOL_LITERAL:    { return (constant_t) { .kind = CONSTANT_INTEGER, .integer = ast->data.boolean }; }
+        case AST_CHAR_LITERAL:    { return (constant_t) { .kind = CONSTANT_INTEGER, .integer = (uint8_t)ast->data.c }; }
+        case AST_INTEGER_LITERAL: { return (constant_t) { .kind = CONSTANT_INTEGER, .integer = ast->data.integer }; }
+        case AST_FLOAT_LITERAL:   { return (constant_t) { .kind = CONSTANT_FLOAT, .f = ast->data.f32 }; }
+        default:                  { return (constant_t) { .kind = CONSTANT_NONE }; }
+    }
+}
+
+// Turns the node into a literal of its 'expr_type', the old children are left in the arena.
+static bool _set_constant(ast_node_t* ast, constant_t value) {
+    const value_type_t Type = _value_type(&ast->expr_type);
+    if (value.kind == CONSTANT_NONE || Type.kind == VALUE_OTHER) {
+        return false;
+    }
+
+    if (Type.kind == VALUE_FLOAT) {
+        const double F = value.kind == CONSTANT_FLOAT ? value.f : (double)value.integer;
+        ast->kind = AST_FLOAT_LITERAL;
+        ast->data.f32 = (float)F;
+        return true;
+    }
+    if (value.kind == CONSTANT_FLOAT) {
+        return false; // float -> integer is not castable
+    }
+
+    const int64_t Integer = _wrap_integer(value.integer, Type);
+    if (Type.kind == VALUE_BOOL) {
+        ast->kind = AST_BOOL_LITERAL;
+        ast->data.boolean = Integer != 0;
+    }
+    else if (strcmp(ast->expr_type.typename, "char") == 0) {
+        ast->kind = AST_CHAR_LITERAL;
+        ast->data.c = (char)Integer;
+    }
+    else {
+        ast->kind = AST_INTEGER_LITERAL;
+        ast->data.integer = Integer;
+    }
+    return true;
+}
+
+static bool _fold_integer_op(op_t op, int64_t lhs, int64_t rhs, value_type_t type, constant_t* result) {
+    const uint64_t ULhs = (uint64_t)lhs, URhs = (uint64_t)rhs;
+    int64_t value = 0;
+
+    switch (op) {
+        // Unsigned math, so overflow wraps instead of being undefined.
+        case BINARY_OP_ADD      : { value = (int64_t)(ULhs + URhs); break; }
+        case BINARY_OP_SUBTRACT : { value = (int64_t)(ULhs - URhs); break; }
+        case BINARY_OP_MULTIPLY : { value = (int64_t)(ULhs * URhs); break; }
+        case BINARY_OP_SHIFT_LEFT: {
+            if (URhs >= type.bits) { return false; }
+            value = (int64_t)(ULhs << URhs);
             break;
         }
-        case AST_IF_STATEMENT: {
-            DO_ON_CHILDREN(
-                ast->data.if_statement.body, 
-                _ast_constant_folding(ast->data.if_statement.body[_it])
-            );
-            DO_ON_CHILDREN(
-                ast->data.if_statement.else_body, 
-                _ast_constant_folding(ast->data.if_statement.else_body[_it])
-            );
+        case BINARY_OP_DIVIDE:
+        case BINARY_OP_MODULO: {
+            if (rhs == 0 || (type.is_signed && lhs == INT64_MIN && rhs == -1)) {
+                return false; // left for the runtime
+            }
+            if (type.is_signed) {
+                value = op == BINARY_OP_DIVIDE ? lhs / rhs : lhs % rhs;
+            }
+            else {
+                value = (int64_t)(op == BINARY_OP_DIVIDE ? ULhs / URhs : ULhs % URhs);
+            }
             break;
         }
-        case AST_WHILE_LOOP: {
-            _ast_constant_folding(ast->data.expr);
-            DO_ON_CHILDREN(
-                ast->data.while_loop.body, 
-                _ast_constant_folding(ast->data.while_loop.body[_it])
-            );
+
+#define COMPARE(cmp) value = type.is_signed ? (lhs cmp rhs) : (ULhs cmp URhs)
+        case BINARY_OP_LESS_THAN                : { COMPARE(<);  break; }
+        case BINARY_OP_LESS_OR_EQUAL_THAN       : { COMPARE(<=); break; }
+        case BINARY_OP_GREATER_THAN             : { COMPARE(>);  break; }
+        case BINARY_OP_GREATER_OR_EQUAL_THAN    : { COMPARE(>=); break; }
+#undef COMPARE
+        case BINARY_OP_EQUAL                    : { value = lhs == rhs; break; }
+        case BINARY_OP_NOT_EQUAL                : { value = lhs != rhs; break; }
+        case BINARY_OP_AND                      : { value = lhs && rhs; break; }
+        case BINARY_OP_OR                       : { value = lhs || rhs; break; }
+
+        default: { return false; }
+    }
+
+    *result = (constant_t) { .kind = CONSTANT_INTEGER, .integer = value };
+    return true;
+}
+
+static bool _fold_float_op(op_t op, double lhs, double rhs, value_type_t type, constant_t* result) {
+    double value = 0.0;
+    bool is_comparison = false;
+
+    switch (op) {
+        case BINARY_OP_ADD      : { value = lhs + rhs; break; }
+        case BINARY_OP_SUBTRACT : { value = lhs - rhs; break; }
+        case BINARY_OP_MULTIPLY : { value = lhs * rhs; break; }
+        case BINARY_OP_DIVIDE   : {
+            if (rhs == 0.0) { return false; }
+            value = lhs / rhs;
             break;
         }
-        case AST_VARIABLE_DECLARATION: {
-            _ast_constant_folding(ast->data.variable_declaration.expr);
-            break;
+
+        case BINARY_OP_LESS_THAN                : { is_comparison = true; value = lhs < rhs; break; }
+        case BINARY_OP_LESS_OR_EQUAL_THAN       : { is_comparison = true; value = lhs <= rhs; break; }
+        case BINARY_OP_GREATER_THAN             : { is_comparison = true; value = lhs > rhs; break; }
+        case BINARY_OP_GREATER_OR_EQUAL_THAN    : { is_comparison = true; value = lhs >= rhs; break; }
+        case BINARY_OP_EQUAL                    : { is_comparison = true; value = lhs == rhs; break; }
+        case BINARY_OP_NOT_EQUAL                : { is_comparison = true; value = lhs != rhs; break; }
+
+        default: { return false; }
+    }
+
+    if (is_comparison) {
+        *result = (constant_t) { .kind = CONSTANT_INTEGER, .integer = value != 0.0 };
+        return true;
+    }
+
+    // Round like the target type would.
+    *result = (constant_t) { .kind = CONSTANT_FLOAT, .f = type.bits == 32 ? (double)(float)value : value };
+    return true;
+}
+
+static ast_visit_result_t _ast_is_pure_pre(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit; (void)user;
+    switch (ast->kind) {
+        case AST_GET_VARIABLE:
+        case AST_GET_MEMBER:
+        case AST_CAST_STATEMENT:
+        case AST_BOOL_LITERAL:
+        case AST_CHAR_LITERAL:
+        case AST_INTEGER_LITERAL:
+        case AST_FLOAT_LITERAL:
+        case AST_STRING_LITERAL: {
+            return AST_VISIT_CONTINUE;
         }
-        case AST_RETURN: {
-            _ast_constant_folding(ast->data.expr);
-            break;
+
+        case AST_UNARY_OP: {
+            return ast->data.unary_op.operation == UNARY_OP_NEGATE ? AST_VISIT_CONTINUE : AST_VISIT_STOP;
         }
 
         case AST_BINARY_OP: {
-            _ast_constant_folding(ast->data.binary_op.left);
-            _ast_constant_folding(ast->data.binary_op.right);
-            
-            const ast_node_t* Lhs = ast->data.binary_op.left;
-            const ast_node_t* Rhs = ast->data.binary_op.right;
-
-            ast_kind_t lkind = ast->data.binary_op.left->kind;
-            ast_kind_t rkind = ast->data.binary_op.right->kind;
-            
-            if (lkind == AST_BOOL_LITERAL && rkind == AST_BOOL_LITERAL) {
-                switch(ast->data.binary_op.operation) {
-                    case BINARY_OP_EQUAL: {
-                        ast->kind = AST_BOOL_LITERAL;
-                        ast->data.boolean = Lhs->data.boolean == Rhs->data.boolean;
-                        break;
-                    }
-                    case BINARY_OP_NOT_EQUAL: {
-                        ast->kind = AST_BOOL_LITERAL;
-                        ast->data.boolean = Lhs->data.boolean != Rhs->data.boolean;
-                        break;
-                    }
+            return ast->data.binary_op.operation == BINARY_OP_ASSIGN ? AST_VISIT_STOP : AST_VISIT_CONTINUE;
+        }
 
-                    default: { break; }
-                }
+        default: {
+            return AST_VISIT_STOP; // calls, initializers...
+        }
+    }
+}
+
+bool ast_is_pure(ast_node_t* ast) {
+    const ast_visitor_t Visitor = { .pre = _ast_is_pure_pre };
+    return ast_visit(&ast, &Visitor);
+}
+
+// Same variable or member of the same variable, e.g. 'a.b.c' and 'a.b.c'.
+static bool _ast_is_same_lvalue(const ast_node_t* lhs, const ast_node_t* rhs) {
+    while (lhs->kind == AST_GET_MEMBER && rhs->kind == AST_GET_MEMBER) {
+        if (strcmp(lhs->data.get_member.member, rhs->data.get_member.member) != 0) {
+            return false;
+        }
+        lhs = lhs->data.get_member.expr;
+        rhs = rhs->data.get_member.expr;
+    }
+
+    return
+        lhs->kind == AST_GET_VARIABLE &&
+        rhs->kind == AST_GET_VARIABLE &&
+        strcmp(lhs->data.literal, rhs->data.literal) == 0;
+}
+
+static int _power_of_two_exponent(int64_t value) {
+    if (value <= 1 || (value & (value - 1)) != 0) {
+        return -1;
+    }
+    int exponent = 0;
+    while (value > 1) {
+        value >>= 1;
+        exponent++;
+    }
+    return exponent;
+}
+
+// 'x op constant' where x isn't constant, might replace the node in 'visit->slot'.
+static void _simplify_binary_op(ast_node_t* ast, const ast_visit_t* visit) {
+    ast_binary_op_t* op = &ast->data.binary_op;
+    const constant_t Lhs = _get_constant(op->left);
+    const constant_t Rhs = _get_constant(op->right);
+    const value_type_t Type = _value_type(&op->left->expr_type);
+
+    // false && x, true && x, true || x, false || x
+    // Not swapped like the others, the right side is only evaluated when the left one doesn't decide the result.
+    if (Lhs.kind == CONSTANT_INTEGER && (op->operation == BINARY_OP_AND || op->operation == BINARY_OP_OR)) {
+        const bool C = Lhs.integer != 0;
+        const bool Decides = op->operation == BINARY_OP_AND ? !C : C;
+        if (Decides) {
+            // The right side is never evaluated, its buffers (e.g. a call's arguments) aren't in the arena.
+            ast_node_t* right = op->right;
+            if (_set_constant(ast, Lhs)) {
+                ast_free_tree(right);
             }
+        }
+        else {
+            *visit->slot = op->right;
+        }
+        return;
+    }
 
-            if (lkind == AST_INTEGER_LITERAL && rkind == AST_INTEGER_LITERAL) {
-                switch(ast->data.binary_op.operation) {
-                    case BINARY_OP_ADD: { 
-                        ast->kind = AST_INTEGER_LITERAL;
-                        ast->data.integer = Lhs->data.integer + Rhs->data.integer;
-                        break;
-                    }
-                    case BINARY_OP_SUBTRACT: { 
-                        ast->kind = AST_INTEGER_LITERAL;
-                        ast->data.integer = Lhs->data.integer - Rhs->data.integer;
-                        break;
-                    }
-                    case BINARY_OP_MODULO: { 
-                        ast->kind = AST_INTEGER_LITERAL;
-                        ast->data.integer = Lhs->data.integer % Rhs->data.integer;
-                        break;
-                    }
+    // Keep the constant on the right for commutative ops.
+    if (Lhs.kind != CONSTANT_NONE && (
+        op->operation == BINARY_OP_ADD ||
+        op->operation == BINARY_OP_MULTIPLY ||
+        op->operation == BINARY_OP_EQUAL ||
+        op->operation == BINARY_OP_NOT_EQUAL
+    )) {
+        ast_node_t* tmp = op->left;
+        op->left = op->right;
+        op->right = tmp;
+        _simplify_binary_op(ast, visit);
+        return;
+    }
 
-                    case BINARY_OP_EQUAL: {
-                        ast->kind = AST_BOOL_LITERAL;
-                        ast->data.boolean = Lhs->data.integer == Rhs->data.integer;
-                        break;
-                    }
-                    case BINARY_OP_NOT_EQUAL: {
-                        ast->kind = AST_BOOL_LITERAL;
-                        ast->data.boolean = Lhs->data.integer != Rhs->data.integer;
-                        break;
+    ast_node_t* x = op->left;
+    const bool XIsPure = ast_is_pure(x);
+
+    // x - x
+    if (op->operation == BINARY_OP_SUBTRACT && Type.kind == VALUE_INTEGER && _ast_is_same_lvalue(op->left, op->right)) {
+        _set_constant(ast, (constant_t) { .kind = CONSTANT_INTEGER, .integer = 0 });
+        return;
+    }
+
+    if (Rhs.kind == CONSTANT_INTEGER && Type.kind == VALUE_INTEGER) {
+        const int64_t C = _wrap_integer(Rhs.integer, Type);
+        switch (op->operation) {
+            case BINARY_OP_ADD:
+            case BINARY_OP_SUBTRACT: {
+                if (C == 0) { *visit->slot = x; }
+                return;
+            }
+
+            case BINARY_OP_MULTIPLY: {
+                if (C == 1) {
+                    *visit->slot = x;
+                }
+                else if (C == 0 && XIsPure) {
+                    _set_constant(ast, Rhs);
+                }
+                else {
+                    const int Exponent = _power_of_two_exponent(C);
+                    if (Exponent > 0) {
+                        op->operation = BINARY_OP_SHIFT_LEFT;
+                        op->right->data.integer = Exponent;
                     }
-                    default: { break; }
                 }
+                return;
             }
 
-            break;
-        }
+            case BINARY_OP_DIVIDE: {
+                if (C == 1) { *visit->slot = x; }
+                return;
+            }
 
-        case AST_UNARY_OP: {
-            _ast_constant_folding(ast->data.unary_op.operand);
-            ast_kind_t kind = ast->data.unary_op.operand->kind;
-            switch (ast->data.unary_op.operation) {
-                case UNARY_OP_NEGATE: {
-                    if (kind == AST_INTEGER_LITERAL) {
-                        ast->data.integer = ast->data.unary_op.operand->data.integer * -1;
-                        ast->kind = AST_INTEGER_LITERAL;
-                    }
-                    break;
+            case BINARY_OP_MODULO: {
+                if (C == 1 && XIsPure) {
+                    _set_constant(ast, (constant_t) { .kind = CONSTANT_INTEGER, .integer = 0 });
                 }
+                return;
+            }
 
-                default: {
-                    
-                }
+            default: { return; }
+        }
+    }
+
+    if (Rhs.kind == CONSTANT_INTEGER && Type.kind == VALUE_BOOL) {
+        const bool C = Rhs.integer != 0;
+        switch (op->operation) {
+            // x == true, x != false, x && true, x || false
+            case BINARY_OP_EQUAL:       { if (C) { *visit->slot = x; } return; }
+            case BINARY_OP_NOT_EQUAL:   { if (!C) { *visit->slot = x; } return; }
+            case BINARY_OP_AND: {
+                if (C) { *visit->slot = x; }
+                else if (XIsPure) { _set_constant(ast, Rhs); }
+                return;
             }
+            case BINARY_OP_OR: {
+                if (!C) { *visit->slot = x; }
+                else if (XIsPure) { _set_constant(ast, Rhs); }
+                return;
+            }
+            default: { return; }
+        }
+    }
+
+    if (Rhs.kind == CONSTANT_FLOAT && Type.kind == VALUE_FLOAT) {
+        if ((op->operation == BINARY_OP_MULTIPLY || op->operation == BINARY_OP_DIVIDE) && Rhs.f == 1.0) {
+            *visit->slot = x;
+        }
+    }
+}
+
+static void _fold_binary_op(ast_node_t* ast, const ast_visit_t* visit) {
+    const ast_binary_op_t* Op = &ast->data.binary_op;
+    if (Op->operation == BINARY_OP_ASSIGN || Op->operation == BINARY_OP_ARRAY_INDEX) {
+        return;
+    }
+
+    const constant_t Lhs = _get_constant(Op->left);
+    const constant_t Rhs = _get_constant(Op->right);
+    if (Lhs.kind == CONSTANT_NONE || Rhs.kind == CONSTANT_NONE) {
+        _simplify_binary_op(ast, visit);
+        return;
+    }
+
+    const value_type_t Type = _value_type(&Op->left->expr_type);
+    constant_t result = { 0 };
+    bool folded = false;
+    if (Type.kind == VALUE_FLOAT && Lhs.kind == CONSTANT_FLOAT && Rhs.kind == CONSTANT_FLOAT) {
+        folded = _fold_float_op(Op->operation, Lhs.f, Rhs.f, Type, &result);
+    }
+    else if ((Type.kind == VALUE_INTEGER || Type.kind == VALUE_BOOL) && Lhs.kind == CONSTANT_INTEGER && Rhs.kind == CONSTANT_INTEGER) {
+        folded = _fold_integer_op(Op->operation, _wrap_integer(Lhs.integer, Type), _wrap_integer(Rhs.integer, Type), Type, &result);
+    }
+
+    if (folded) {
+        _set_constant(ast, result);
+    }
+}
 
+static void _fold_unary_op(ast_node_t* ast) {
+    if (ast->data.unary_op.operation != UNARY_OP_NEGATE) {
+        return;
+    }
 
+    constant_t value = _get_constant(ast->data.unary_op.operand);
+    if (value.kind == CONSTANT_INTEGER) {
+        value.integer = (int64_t)(0 - (uint64_t)value.integer);
+    }
+    else if (value.kind == CONSTANT_FLOAT) {
+        value.f = -value.f;
+    }
+    _set_constant(ast, value);
+}
+
+static void _fold_cast(ast_node_t* ast, const ast_visit_t* visit) {
+    ast_node_t* expr = ast->data.cast_statement.expr;
+
+    // cast<i32>(x) where x already is an i32
+    if (datatype_cmp(&expr->expr_type, &ast->expr_type)) {
+        *visit->slot = expr;
+        return;
+    }
+
+    // The value of the literal is in the type of the expression, wrap it to the target type.
+    const value_type_t From = _value_type(&expr->expr_type);
+    constant_t value = _get_constant(expr);
+    if (value.kind == CONSTANT_INTEGER) {
+        value.integer = _wrap_integer(value.integer, From);
+    }
+    _set_constant(ast, value);
+}
+
+// Called after the children have been folded.
+static ast_visit_result_t _ast_constant_folding(struct ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)user;
+
+    switch (ast->kind) {
+        case AST_BINARY_OP: {
+            _fold_binary_op(ast, visit);
             break;
         }
 
+        case AST_UNARY_OP: {
+            _fold_unary_op(ast);
+            break;
+        }
+
+        case AST_CAST_STATEMENT: {
+            _fold_cast(ast, visit);
+            break;
+        }
 
         default : {
             // Optimization either not implemented or available for this node.
         }
     }
 
-
+    return AST_VISIT_CONTINUE;
 }
 
-void perform_ast_optimizations(struct ast_node_t* ast) {
-    if (g_Params.opt_ast_constant_folding) {
-        _ast_constant_folding(ast);
+void perform_ast_optimizations(struct arena_t* arena, struct ast_node_t* ast, const program_params_t* params) {
+    // Inlining first, so the arguments of inlined calls can be folded.
+    const size_t InlineThreshold = !params->opt_ast_inline ? 0 :
+        params->opt_inline_threshold ? params->opt_inline_threshold : INLINE_DEFAULT_THRESHOLD;
+    ast_inline_functions(arena, ast, InlineThreshold);
+
+    if (params->opt_ast_constant_folding) {
+        const ast_visitor_t Visitor = { .post = _ast_constant_folding };
+        ast_visit(&ast, &Visitor);
+    }
+    if (params->opt_ast_dead_code) {
+        ast_eliminate_dead_code(ast);
+    }
+    // Last, so the hoisted expressions are already folded.
+    if (params->opt_ast_licm) {
+        ast_hoist_loop_invariants(arena, ast);
     }
 }
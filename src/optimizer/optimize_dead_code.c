@@ -0,0 +1,127 @@
+#include <stb/stb_ds.h>
+#include "optimize.h"
+
+#include "../parser/ast_type.h"
+#include "../parser/ast_visit.h"
+
+/*
+    Removes statements which can never run:
+        - anything after a 'return', 'break' or 'continue' in the same body.
+        - the untaken branch of 'if true'/'if false', the taken one is spliced into the parent's body.
+        - 'while false' loops.
+    Conditions are only constant after constant folding, so this should run after it.
+    Splicing a branch into its parent doesn't change which declaration a name refers to,
+    the backend looks variables up per function, not per scope.
+*/
+
+// Bodies have already been pruned, so a terminator is always the last statement.
+static bool _ast_terminates(const ast_node_t* stmt) {
+    switch (stmt->kind) {
+        case AST_RETURN:
+        case AST_BREAK:
+        case AST_CONTINUE: {
+            return true;
+        }
+
+        case AST_IF_STATEMENT: {
+            ast_node_t** body = stmt->data.if_statement.body;
+            ast_node_t** else_body = stmt->data.if_statement.else_body;
+            return
+                arrlenu(body) && _ast_terminates(arrlast(body)) &&
+                arrlenu(else_body) && _ast_terminates(arrlast(else_body));
+        }
+
+        default: {
+            return false;
+        }
+    }
+}
+
+static void _ast_free_body(ast_node_t** body) {
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        ast_free_tree(body[i]);
+    }
+    arrfree(body);
+}
+
+static void _eliminate_dead_code_in_body(ast_node_t*** body_ptr) {
+    ast_node_t** body = *body_ptr;
+    ast_node_t** pruned = NULL;
+    bool reachable = true;
+
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        ast_node_t* stmt = body[i];
+        if (!reachable) {
+            ast_free_tree(stmt);
+            continue;
+        }
+
+        if (stmt->kind == AST_WHILE_LOOP && stmt->data.while_loop.expr->kind == AST_BOOL_LITERAL && !stmt->data.while_loop.expr->data.boolean) {
+            ast_free_tree(stmt);
+            continue;
+        }
+
+        if (stmt->kind == AST_IF_STATEMENT && stmt->data.if_statement.expr->kind == AST_BOOL_LITERAL) {
+            ast_if_statement_t* if_statement = &stmt->data.if_statement;
+            ast_node_t** taken = if_statement->expr->data.boolean ? if_statement->body : if_statement->else_body;
+            ast_node_t** untaken = if_statement->expr->data.boolean ? if_statement->else_body : if_statement->body;
+
+            for (size_t j = 0; j < arrlenu(taken); j++) {
+                arrput(pruned, taken[j]);
+            }
+            reachable = !arrlenu(taken) || !_ast_terminates(arrlast(taken));
+
+            // The if node & its condition are in the arena, only the arrays are owned.
+            arrfree(taken);
+            _ast_free_body(untaken);
+            if_statement->body = NULL;
+            if_statement->else_body = NULL;
+            continue;
+        }
+
+        arrput(pruned, stmt);
+        reachable = !_ast_terminates(stmt);
+    }
+
+    arrfree(body);
+    *body_ptr = pruned;
+}
+
+// Called after the children have been pruned, bodies of the parent can be modified here.
+static ast_visit_result_t _ast_dead_code_elimination(struct ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit; (void)user;
+
+    switch (ast->kind) {
+        case AST_FUNCTION_DECLARATION: {
+            _eliminate_dead_code_in_body(&ast->data.function_declaration.body);
+            break;
+        }
+
+        case AST_IF_STATEMENT: {
+            _eliminate_dead_code_in_body(&ast->data.if_statement.body);
+            _eliminate_dead_code_in_body(&ast->data.if_statement.else_body);
+            break;
+        }
+
+        case AST_WHILE_LOOP: {
+            _eliminate_dead_code_in_body(&ast->data.while_loop.body);
+            break;
+        }
+
+        case AST_FOR_LOOP: {
+            _eliminate_dead_code_in_body(&ast->data.for_loop.body);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return AST_VISIT_CONTINUE;
+}
+
+void ast_eliminate_dead_code(struct ast_node_t* ast) {
+    const ast_visitor_t Visitor = { .post = _ast_dead_code_elimination };
+    ast_visit(&ast, &Visitor);
+}
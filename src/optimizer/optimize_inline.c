@@ -0,0 +1,556 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stb/stb_ds.h>
+#include "optimize.h"
+
+#include "../common/arena.h"
+#include "../common/error.h"
+#include "../parser/ast_type.h"
+#include "../parser/ast_visit.h"
+#include "../semantics/struct_layout.h"
+
+/*
+    Inlines calls to small functions, callees are processed before their callers so calls inside them are inlined first.
+
+    A call 'f(a, b)' in a statement is replaced by, right before the statement:
+        let x.inline3: T = a;       // parameters, in the order the arguments were evaluated
+        let y.inline3: T = b;
+        <body of f, locals renamed to 'name.inlineN'>
+        let return.inline3: R = <expression of the return>;
+    and the call itself by 'return.inline3'. The renamed names can't collide with the caller's, '.' isn't allowed in identifiers.
+
+    Only callees which return at the end of their body are inlined, as nothing can jump over the rest of an inlined body.
+    Moving the call in front of the statement is only allowed if that doesn't change the order of side effects:
+        - the call is the whole expression of the statement ('f(x);', 'let v = f(x);', 'x = f(x);', 'return f(x);', 'if f(x) {}')
+        - or the rest of the expression has no side effects, and the callee only writes to its own locals.
+    Conditions of while loops are evaluated on every iteration, so calls there are never inlined.
+*/
+
+typedef struct inline_fn_t {
+    ast_node_t* decl;
+    size_t* callees;        // stb_ds array, indices into the inliner's functions
+    bool recursive;         // calls itself directly or through other functions
+    bool processed;         // calls inside of it have been inlined
+    bool in_progress;
+} inline_fn_t;
+
+typedef struct inliner_t {
+    arena_t* arena;
+    size_t threshold;       // max size of a callee without the 'inline' keyword, in nodes
+    inline_fn_t* functions; // stb_ds array
+    size_t inline_count;    // for unique names
+} inliner_t;
+
+// Programs don't have many functions, a linear search is fine.
+static inline_fn_t* _find_function(const inliner_t* inliner, const char* name) {
+    for (size_t i = 0; i < arrlenu(inliner->functions); i++) {
+        if (strcmp(inliner->functions[i].decl->data.function_declaration.name, name) == 0) {
+            return &inliner->functions[i];
+        }
+    }
+    return NULL;
+}
+
+/* Call graph */
+
+typedef struct callee_search_t {
+    inliner_t* inliner;
+    size_t caller;
+} callee_search_t;
+
+static ast_visit_result_t _collect_callees(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    const callee_search_t* Search = user;
+    if (ast->kind != AST_FUNCTION_CALL) {
+        return AST_VISIT_CONTINUE;
+    }
+
+    inliner_t* inliner = Search->inliner;
+    inline_fn_t* caller = &inliner->functions[Search->caller];
+    const inline_fn_t* Callee = _find_function(inliner, ast->data.function_call.name);
+    if (!Callee) {
+        return AST_VISIT_CONTINUE;
+    }
+
+    const size_t Index = (size_t)(Callee - inliner->functions);
+    for (size_t i = 0; i < arrlenu(caller->callees); i++) {
+        if (caller->callees[i] == Index) {
+            return AST_VISIT_CONTINUE;
+        }
+    }
+    arrput(caller->callees, Index);
+    return AST_VISIT_CONTINUE;
+}
+
+static bool _reaches(const inliner_t* inliner, size_t from, size_t target, bool* visited) {
+    if (visited[from]) {
+        return false;
+    }
+    visited[from] = true;
+
+    const inline_fn_t* Fn = &inliner->functions[from];
+    for (size_t i = 0; i < arrlenu(Fn->callees); i++) {
+        if (Fn->callees[i] == target || _reaches(inliner, Fn->callees[i], target, visited)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void _build_call_graph(inliner_t* inliner, ast_node_t* translation_unit) {
+    ast_node_t** body = translation_unit->data.translation_unit.body;
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (body[i]->kind == AST_FUNCTION_DECLARATION) {
+            const inline_fn_t Fn = { .decl = body[i] };
+            arrput(inliner->functions, Fn);
+        }
+    }
+
+    // Calls can only be resolved once every function is known.
+    for (size_t i = 0; i < arrlenu(inliner->functions); i++) {
+        callee_search_t search = { .inliner = inliner, .caller = i };
+        const ast_visitor_t Visitor = { .pre = _collect_callees, .user = &search };
+        ast_visit(&inliner->functions[i].decl, &Visitor);
+    }
+
+    bool* visited = calloc(arrlenu(inliner->functions) + 1, sizeof(bool));
+    RUNTIME_ASSERT(visited, "could not allocate memory!");
+    for (size_t i = 0; i < arrlenu(inliner->functions); i++) {
+        memset(visited, 0, arrlenu(inliner->functions) * sizeof(bool));
+        inliner->functions[i].recursive = _reaches(inliner, i, i, visited);
+    }
+    free(visited);
+}
+
+/* Callee analysis */
+
+static ast_visit_result_t _count_nodes(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)ast; (void)visit;
+    (*(size_t*)user)++;
+    return AST_VISIT_CONTINUE;
+}
+
+static size_t _body_size(ast_node_t** body) {
+    size_t size = 0;
+    const ast_visitor_t Visitor = { .pre = _count_nodes, .user = &size };
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        ast_visit(&body[i], &Visitor);
+    }
+    return size;
+}
+
+static ast_visit_result_t _count_returns(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    if (ast->kind == AST_RETURN) {
+        (*(size_t*)user)++;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+static bool _returns_only_at_end(ast_node_t** body) {
+    size_t returns = 0;
+    const ast_visitor_t Visitor = { .pre = _count_returns, .user = &returns };
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        ast_visit(&body[i], &Visitor);
+    }
+
+    const bool EndsWithReturn = arrlenu(body) && arrlast(body)->kind == AST_RETURN;
+    return returns == (EndsWithReturn ? 1u : 0u);
+}
+
+static bool _can_inline(const inliner_t* inliner, const inline_fn_t* callee) {
+    const ast_function_declaration_t* Decl = &callee->decl->data.function_declaration;
+    if (Decl->external || callee->recursive || !callee->processed) {
+        return false;
+    }
+
+    // Structs are passed by value & would have to be copied.
+    // An array parameter shares the caller's array, while 'let a: T[N] = arr;' would be a copy.
+    for (size_t i = 0; i < arrlenu(Decl->args); i++) {
+        if (!layout_is_value_type(&Decl->args[i].data.variable_declaration.type)) {
+            return false;
+        }
+    }
+
+    const bool ReturnsVoid = Decl->return_type.kind == DATATYPE_PRIMITIVE && strcmp(Decl->return_type.typename, "void") == 0;
+    if (!ReturnsVoid && !layout_is_value_type(&Decl->return_type)) {
+        return false;
+    }
+    if (!ReturnsVoid && (!arrlenu(Decl->body) || arrlast(Decl->body)->kind != AST_RETURN)) {
+        return false;
+    }
+    if (!_returns_only_at_end(Decl->body)) {
+        return false;
+    }
+
+    return Decl->inline_hint || _body_size(Decl->body) <= inliner->threshold;
+}
+
+static ast_visit_result_t _writes_only_locals_pre(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit; (void)user;
+    if (ast->kind == AST_FUNCTION_CALL) {
+        return AST_VISIT_STOP;
+    }
+    if (ast->kind == AST_BINARY_OP && ast->data.binary_op.operation == BINARY_OP_ASSIGN && ast->data.binary_op.left->kind != AST_GET_VARIABLE) {
+        return AST_VISIT_STOP;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+// Doesn't call anything & only assigns to its own variables, so reordering it with pure expressions is fine.
+static bool _writes_only_locals(const inline_fn_t* fn) {
+    ast_node_t** body = fn->decl->data.function_declaration.body;
+    const ast_visitor_t Visitor = { .pre = _writes_only_locals_pre };
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (!ast_visit(&body[i], &Visitor)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Call sites */
+
+typedef struct call_search_t {
+    const inliner_t* inliner;
+    ast_node_t** found;
+} call_search_t;
+
+static ast_visit_result_t _find_reorderable_call(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    call_search_t* search = user;
+
+    // Right side of a short circuiting op might not be evaluated.
+    if (ast->kind == AST_BINARY_OP && (ast->data.binary_op.operation == BINARY_OP_AND || ast->data.binary_op.operation == BINARY_OP_OR)) {
+        return AST_VISIT_SKIP;
+    }
+    if (ast->kind != AST_FUNCTION_CALL) {
+        return AST_VISIT_CONTINUE;
+    }
+
+    const inline_fn_t* Callee = _find_function(search->inliner, ast->data.function_call.name);
+    if (Callee && _can_inline(search->inliner, Callee) && _writes_only_locals(Callee)) {
+        search->found = visit->slot;
+        return AST_VISIT_STOP;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+static ast_visit_result_t _has_other_side_effects(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    const call_search_t* Search = user;
+    if (visit->slot == Search->found) {
+        return AST_VISIT_CONTINUE; // the arguments are still checked
+    }
+    if (ast->kind == AST_FUNCTION_CALL) {
+        // Calls which can't be observed can be reordered as well, e.g. 'f(x) + g(x)'.
+        const inline_fn_t* Callee = _find_function(Search->inliner, ast->data.function_call.name);
+        const bool Observable = !Callee || Callee->decl->data.function_declaration.external || !_writes_only_locals(Callee);
+        return Observable ? AST_VISIT_STOP : AST_VISIT_CONTINUE;
+    }
+    if (ast->kind == AST_BINARY_OP && ast->data.binary_op.operation == BINARY_OP_ASSIGN) {
+        return AST_VISIT_STOP;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+// Slot of a call in the expression which can be moved in front of the statement, NULL if there is none.
+static ast_node_t** _find_call_in_expr(const inliner_t* inliner, ast_node_t** slot) {
+    if (!*slot) {
+        return NULL;
+    }
+
+    if ((*slot)->kind == AST_FUNCTION_CALL) {
+        const inline_fn_t* Callee = _find_function(inliner, (*slot)->data.function_call.name);
+        if (Callee && _can_inline(inliner, Callee)) {
+            return slot;
+        }
+    }
+
+    call_search_t search = { .inliner = inliner, .found = NULL };
+    const ast_visitor_t FindVisitor = { .pre = _find_reorderable_call, .user = &search };
+    ast_visit(slot, &FindVisitor);
+    if (!search.found) {
+        return NULL;
+    }
+
+    const ast_visitor_t EffectVisitor = { .pre = _has_other_side_effects, .user = &search };
+    return ast_visit(slot, &EffectVisitor) ? search.found : NULL;
+}
+
+static ast_node_t** _find_call_site(const inliner_t* inliner, ast_node_t** stmt) {
+    ast_node_t* ast = *stmt;
+    switch (ast->kind) {
+        case AST_FUNCTION_CALL:
+        case AST_UNARY_OP: {
+            return _find_call_in_expr(inliner, stmt);
+        }
+
+        case AST_RETURN: {
+            return _find_call_in_expr(inliner, &ast->data.expr);
+        }
+
+        case AST_VARIABLE_DECLARATION: {
+            return _find_call_in_expr(inliner, &ast->data.variable_declaration.expr);
+        }
+
+        case AST_IF_STATEMENT: {
+            return _find_call_in_expr(inliner, &ast->data.if_statement.expr);
+        }
+
+        case AST_BINARY_OP: {
+            if (ast->data.binary_op.operation != BINARY_OP_ASSIGN) {
+                return _find_call_in_expr(inliner, stmt);
+            }
+            // The value is evaluated before the address it's stored to.
+            return ast_is_pure(ast->data.binary_op.left) ? _find_call_in_expr(inliner, &ast->data.binary_op.right) : NULL;
+        }
+
+        default: {
+            return NULL;
+        }
+    }
+}
+
+/* Inlining */
+
+typedef struct rename_t {
+    const char** names;     // stb_ds array, variables declared in the callee
+    const char** renamed;   // stb_ds array, same indices
+} rename_t;
+
+static const char* _inline_name(arena_t* arena, const char* name, size_t id) {
+    const int Length = snprintf(NULL, 0, "%s.inline%zu", name, id);
+    char* str = arena_alloc(arena, (size_t)Length + 1);
+    snprintf(str, (size_t)Length + 1, "%s.inline%zu", name, id);
+    return str;
+}
+
+static void _add_rename(rename_t* rename, arena_t* arena, const char* name, size_t id) {
+    for (size_t i = 0; i < arrlenu(rename->names); i++) {
+        if (strcmp(rename->names[i], name) == 0) {
+            return;
+        }
+    }
+    arrput(rename->names, name);
+    arrput(rename->renamed, _inline_name(arena, name, id));
+}
+
+static const char* _renamed(const rename_t* rename, const char* name) {
+    if (!name) {
+        return NULL;
+    }
+    for (size_t i = 0; i < arrlenu(rename->names); i++) {
+        if (strcmp(rename->names[i], name) == 0) {
+            return rename->renamed[i];
+        }
+    }
+    return name; // not declared in the callee
+}
+
+static ast_visit_result_t _apply_rename(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    const rename_t* Rename = user;
+    switch (ast->kind) {
+        case AST_GET_VARIABLE:          { ast->data.literal = _renamed(Rename, ast->data.literal); break; }
+        case AST_VARIABLE_DECLARATION:  { ast->data.variable_declaration.name = _renamed(Rename, ast->data.variable_declaration.name); break; }
+        case AST_FOR_LOOP:              { ast->data.for_loop.identifier = _renamed(Rename, ast->data.for_loop.identifier); break; }
+        default: { break; }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+typedef struct declared_names_t {
+    rename_t* rename;
+    arena_t* arena;
+    size_t id;
+} declared_names_t;
+
+static ast_visit_result_t _collect_declared_names(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    declared_names_t* ctx = user;
+    if (ast->kind == AST_VARIABLE_DECLARATION && ast->data.variable_declaration.name) { // variadic arguments are unnamed
+        _add_rename(ctx->rename, ctx->arena, ast->data.variable_declaration.name, ctx->id);
+    }
+    else if (ast->kind == AST_FOR_LOOP) {
+        _add_rename(ctx->rename, ctx->arena, ast->data.for_loop.identifier, ctx->id);
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+static ast_node_t* _clone_renamed(arena_t* arena, const ast_node_t* ast, const rename_t* rename) {
+    ast_node_t* clone = ast_clone_tree(arena, ast);
+    const ast_visitor_t Visitor = { .pre = _apply_rename, .user = (void*)rename };
+    ast_visit(&clone, &Visitor);
+    return clone;
+}
+
+// Inlines the call in '*call_slot', returns the statements to insert before the statement containing it.
+// Without 'result_used' the call is the statement, and nothing is left in its place.
+static ast_node_t** _inline_call(inliner_t* inliner, ast_node_t** call_slot, bool result_used) {
+    ast_node_t* call = *call_slot;
+    const inline_fn_t* Callee = _find_function(inliner, call->data.function_call.name);
+    const ast_function_declaration_t* Decl = &Callee->decl->data.function_declaration;
+    const size_t Id = inliner->inline_count++;
+
+    // Every variable of the callee gets a unique name.
+    rename_t rename = { 0 };
+    declared_names_t declared = { .rename = &rename, .arena = inliner->arena, .id = Id };
+    for (size_t i = 0; i < arrlenu(Decl->args); i++) {
+        _add_rename(&rename, inliner->arena, Decl->args[i].data.variable_declaration.name, Id);
+    }
+    const ast_visitor_t DeclaredVisitor = { .pre = _collect_declared_names, .user = &declared };
+    for (size_t i = 0; i < arrlenu(Decl->body); i++) {
+        ast_visit(&Decl->body[i], &DeclaredVisitor);
+    }
+
+    ast_node_t** stmts = NULL;
+
+    // Parameters
+    for (size_t i = 0; i < arrlenu(Decl->args); i++) {
+        const ast_variable_declaration_t* Param = &Decl->args[i].data.variable_declaration;
+        ast_node_t* param = ast_arena_new(inliner->arena, AST_VARIABLE_DECLARATION);
+        param->position = call->position;
+        param->data.variable_declaration = (ast_variable_declaration_t) {
+            .name = _renamed(&rename, Param->name),
+            .type = Param->type,
+            .expr = call->data.function_call.args[i],
+        };
+        arrput(stmts, param);
+    }
+    arrfree(call->data.function_call.args);
+
+    // Body
+    const size_t BodyCount = arrlenu(Decl->body);
+    const bool EndsWithReturn = BodyCount && Decl->body[BodyCount - 1]->kind == AST_RETURN;
+    for (size_t i = 0; i < BodyCount - (EndsWithReturn ? 1 : 0); i++) {
+        arrput(stmts, _clone_renamed(inliner->arena, Decl->body[i], &rename));
+    }
+
+    // Return value
+    ast_node_t* value = EndsWithReturn ? _clone_renamed(inliner->arena, Decl->body[BodyCount - 1]->data.expr, &rename) : NULL;
+    if (result_used) {
+        DEBUG_ASSERT(value, "a function with a return value has to end with a return!");
+        ast_node_t* result = ast_arena_new(inliner->arena, AST_VARIABLE_DECLARATION);
+        result->position = call->position;
+        result->data.variable_declaration = (ast_variable_declaration_t) {
+            .name = _inline_name(inliner->arena, "return", Id),
+            .type = Decl->return_type,
+            .expr = value,
+        };
+        arrput(stmts, result);
+
+        ast_node_t* get = ast_arena_new(inliner->arena, AST_GET_VARIABLE);
+        get->position = call->position;
+        get->expr_type = call->expr_type;
+        get->data.literal = result->data.variable_declaration.name;
+        *call_slot = get;
+    }
+    else if (value && !ast_is_pure(value)) {
+        arrput(stmts, value);
+    }
+
+    arrfree(rename.names);
+    arrfree(rename.renamed);
+    return stmts;
+}
+
+static void _inline_calls_in_body(inliner_t* inliner, ast_node_t*** body_ptr) {
+    for (size_t i = 0; i < arrlenu(*body_ptr); i++) {
+        ast_node_t** stmt = &(*body_ptr)[i];
+        ast_node_t** call_slot = _find_call_site(inliner, stmt);
+        if (!call_slot) {
+            continue;
+        }
+
+        // The call is the statement, the whole statement is replaced.
+        const bool ResultUsed = call_slot != stmt;
+        ast_node_t** stmts = _inline_call(inliner, call_slot, ResultUsed);
+        const size_t Count = arrlenu(stmts);
+        if (!ResultUsed) {
+            arrdel(*body_ptr, i);
+        }
+        if (Count) {
+            arrinsn(*body_ptr, i, Count);
+            memcpy(&(*body_ptr)[i], stmts, Count * sizeof(ast_node_t*));
+        }
+        arrfree(stmts);
+
+        // The arguments are now in declarations which are checked next, so 'f(g(x))' inlines both.
+        i--;
+    }
+}
+
+static ast_visit_result_t _inline_calls(struct ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    inliner_t* inliner = user;
+
+    switch (ast->kind) {
+        case AST_FUNCTION_DECLARATION: {
+            _inline_calls_in_body(inliner, &ast->data.function_declaration.body);
+            break;
+        }
+
+        case AST_IF_STATEMENT: {
+            _inline_calls_in_body(inliner, &ast->data.if_statement.body);
+            _inline_calls_in_body(inliner, &ast->data.if_statement.else_body);
+            break;
+        }
+
+        case AST_WHILE_LOOP: {
+            _inline_calls_in_body(inliner, &ast->data.while_loop.body);
+            break;
+        }
+
+        case AST_FOR_LOOP: {
+            _inline_calls_in_body(inliner, &ast->data.for_loop.body);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return AST_VISIT_CONTINUE;
+}
+
+// Callees first, so their bodies are final when they're inlined.
+static void _process_function(inliner_t* inliner, size_t index) {
+    inline_fn_t* fn = &inliner->functions[index];
+    if (fn->processed || fn->in_progress) {
+        return;
+    }
+
+    fn->in_progress = true;
+    for (size_t i = 0; i < arrlenu(fn->callees); i++) {
+        _process_function(inliner, fn->callees[i]);
+    }
+
+    if (!fn->decl->data.function_declaration.external) {
+        const ast_visitor_t Visitor = { .post = _inline_calls, .user = inliner };
+        ast_visit(&fn->decl, &Visitor);
+    }
+    fn->in_progress = false;
+    fn->processed = true;
+}
+
+void ast_inline_functions(struct arena_t* arena, struct ast_node_t* ast, size_t threshold) {
+    DEBUG_ASSERT(ast->kind == AST_TRANSLATION_UNIT, "?");
+
+    inliner_t inliner = {
+        .arena = arena,
+        .threshold = threshold,
+        .functions = NULL,
+        .inline_count = 0
+    };
+    _build_call_graph(&inliner, ast);
+
+    for (size_t i = 0; i < arrlenu(inliner.functions); i++) {
+        _process_function(&inliner, i);
+    }
+
+    for (size_t i = 0; i < arrlenu(inliner.functions); i++) {
+        arrfree(inliner.functions[i].callees);
+    }
+    arrfree(inliner.functions);
+}
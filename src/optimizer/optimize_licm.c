@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stb/stb_ds.h>
+#include "optimize.h"
+
+#include "../common/arena.h"
+#include "../common/utils.h"
+#include "../parser/ast_type.h"
+#include "../parser/ast_visit.h"
+#include "../semantics/struct_layout.h"
+
+/*
+    Loop-invariant code motion for while loops.
+    Expressions in a loop which read only variables the loop never assigns, are computed once before the loop:
+        while i < n * 4 { sum = sum + c.r * 2; i = i + 1; }
+    becomes
+        let licm.0: i32 = n * 4;
+        let licm.1: i32 = c.r * 2;
+        while i < licm.0 { sum = sum + licm.1; i = i + 1; }
+    The loop might not run at all & the expression might be behind an if, so only expressions which can't trap are
+    hoisted: no calls, no dereferences or indexing, division only by a constant, members only of struct variables.
+    Members are memory, so they are hoisted only from loops which don't store to memory or call anything.
+    Inner loops are handled first, their hoisted expressions can then move out of the outer loop as well.
+*/
+
+typedef struct licm_t {
+    arena_t* arena;
+    const char** address_taken; // variables of the current function which have '&' used on them
+    size_t hoisted_count;
+} licm_t;
+
+typedef struct licm_loop_t {
+    const char** variant;       // variables assigned or declared in the loop
+    bool writes_memory;         // stores through pointers, members & indices, or calls
+} licm_loop_t;
+
+static ast_visit_result_t _collect_address_taken(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    const char*** address_taken = user;
+    if (ast->kind == AST_UNARY_OP && ast->data.unary_op.operation == UNARY_OP_ADDRESS_OF) {
+        const ast_node_t* Operand = ast->data.unary_op.operand;
+        while (Operand->kind == AST_GET_MEMBER) {
+            Operand = Operand->data.get_member.expr;
+        }
+        if (Operand->kind == AST_GET_VARIABLE) {
+            arrput(*address_taken, Operand->data.literal);
+        }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+static ast_visit_result_t _collect_loop_effects(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    licm_loop_t* loop = user;
+    switch (ast->kind) {
+        case AST_BINARY_OP: {
+            if (ast->data.binary_op.operation == BINARY_OP_ASSIGN) {
+                const ast_node_t* Lhs = ast->data.binary_op.left;
+                if (Lhs->kind == AST_GET_VARIABLE) {
+                    arrput(loop->variant, Lhs->data.literal);
+                }
+                else {
+                    loop->writes_memory = true;
+                }
+            }
+            break;
+        }
+
+        case AST_VARIABLE_DECLARATION: {
+            if (ast->data.variable_declaration.name) { // variadic arguments are unnamed
+                arrput(loop->variant, ast->data.variable_declaration.name);
+            }
+            break;
+        }
+
+        case AST_FOR_LOOP: {
+            arrput(loop->variant, ast->data.for_loop.identifier);
+            break;
+        }
+
+        case AST_FUNCTION_CALL: {
+            loop->writes_memory = true;
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+// 'a.b.c' where 'a' & 'a.b' are structs, not pointers which could be null.
+static bool _is_member_of_variable(const ast_node_t* ast) {
+    while (ast->kind == AST_GET_MEMBER) {
+        ast = ast->data.get_member.expr;
+        if (ast->expr_type.kind != DATATYPE_PRIMITIVE) {
+            return false;
+        }
+    }
+    return ast->kind == AST_GET_VARIABLE && ast->expr_type.kind == DATATYPE_PRIMITIVE;
+}
+
+static bool _is_invariant(const ast_node_t* ast, const licm_loop_t* loop) {
+    switch (ast->kind) {
+        case AST_BOOL_LITERAL:
+        case AST_CHAR_LITERAL:
+        case AST_INTEGER_LITERAL:
+        case AST_FLOAT_LITERAL: {
+            return true;
+        }
+
+        case AST_GET_VARIABLE: {
+            return !str_array_contains(loop->variant, ast->data.literal);
+        }
+
+        case AST_GET_MEMBER: {
+            return !loop->writes_memory && _is_member_of_variable(ast) && _is_invariant(ast->data.get_member.expr, loop);
+        }
+
+        case AST_CAST_STATEMENT: {
+            return _is_invariant(ast->data.cast_statement.expr, loop);
+        }
+
+        case AST_UNARY_OP: {
+            return ast->data.unary_op.operation == UNARY_OP_NEGATE && _is_invariant(ast->data.unary_op.operand, loop);
+        }
+
+        case AST_BINARY_OP: {
+            const ast_binary_op_t* Op = &ast->data.binary_op;
+            switch (Op->operation) {
+                case BINARY_OP_ASSIGN:
+                case BINARY_OP_ARRAY_INDEX: {
+                    return false;
+                }
+
+                // Can't divide by zero, or overflow with INT_MIN / -1.
+                case BINARY_OP_DIVIDE:
+                case BINARY_OP_MODULO: {
+                    if (Op->right->kind != AST_INTEGER_LITERAL || Op->right->data.integer == 0 || Op->right->data.integer == -1) {
+                        return false;
+                    }
+                    break;
+                }
+
+                default: {
+                    break;
+                }
+            }
+            return _is_invariant(Op->left, loop) && _is_invariant(Op->right, loop);
+        }
+
+        default: {
+            return false; // calls, dereferences, initializers...
+        }
+    }
+}
+
+// Worth a temporary of its own, literals & variables already are one.
+static bool _is_hoistable(const ast_node_t* ast, const licm_loop_t* loop) {
+    switch (ast->kind) {
+        case AST_GET_MEMBER:
+        case AST_CAST_STATEMENT:
+        case AST_UNARY_OP:
+        case AST_BINARY_OP: {
+            break;
+        }
+
+        default: {
+            return false;
+        }
+    }
+    // Structs are pointers to memory which the loop could change.
+    return layout_is_value_type(&ast->expr_type) && _is_invariant(ast, loop);
+}
+
+typedef struct licm_hoist_t {
+    licm_t* licm;
+    const licm_loop_t* loop;
+    ast_node_t** hoisted;   // declarations to insert before the loop
+} licm_hoist_t;
+
+static ast_visit_result_t _hoist_invariants(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    licm_hoist_t* ctx = user;
+
+    // Statements & the target of an assignment stay, their operands can still move.
+    const bool IsStatement = visit->role == AST_ROLE_ROOT || visit->role == AST_ROLE_BODY || visit->role == AST_ROLE_ELSE_BODY;
+    const bool IsAssigned = visit->role == AST_ROLE_LEFT && visit->parent->data.binary_op.operation == BINARY_OP_ASSIGN;
+    if (IsStatement || IsAssigned || !_is_hoistable(ast, ctx->loop)) {
+        return AST_VISIT_CONTINUE;
+    }
+
+    const size_t Id = ctx->licm->hoisted_count++;
+    const int Length = snprintf(NULL, 0, "licm.%zu", Id);
+    char* name = arena_alloc(ctx->licm->arena, (size_t)Length + 1);
+    snprintf(name, (size_t)Length + 1, "licm.%zu", Id);
+
+    ast_node_t* decl = ast_arena_new(ctx->licm->arena, AST_VARIABLE_DECLARATION);
+    decl->position = ast->position;
+    decl->data.variable_declaration = (ast_variable_declaration_t) {
+        .name = name,
+        .type = ast->expr_type,
+        .expr = ast,
+    };
+    arrput(ctx->hoisted, decl);
+
+    ast_node_t* get = ast_arena_new(ctx->licm->arena, AST_GET_VARIABLE);
+    get->position = ast->position;
+    get->expr_type = ast->expr_type;
+    get->data.literal = name;
+    *visit->slot = get;
+    return AST_VISIT_SKIP;
+}
+
+// Returns the declarations of the hoisted expressions, to be inserted before the loop.
+static ast_node_t** _hoist_from_loop(licm_t* licm, ast_node_t* loop_node) {
+    licm_loop_t loop = { 0 };
+    const ast_visitor_t EffectsVisitor = { .pre = _collect_loop_effects, .user = &loop };
+    ast_visit(&loop_node, &EffectsVisitor);
+    if (loop.writes_memory) {
+        for (size_t i = 0; i < arrlenu(licm->address_taken); i++) {
+            arrput(loop.variant, licm->address_taken[i]);
+        }
+    }
+
+    licm_hoist_t hoist = { .licm = licm, .loop = &loop, .hoisted = NULL };
+    const ast_visitor_t HoistVisitor = { .pre = _hoist_invariants, .user = &hoist };
+    ast_visit(&loop_node, &HoistVisitor);
+
+    arrfree(loop.variant);
+    return hoist.hoisted;
+}
+
+static void _hoist_in_body(licm_t* licm, ast_node_t*** body_ptr) {
+    ast_node_t** body = *body_ptr;
+    ast_node_t** out = NULL;
+    bool changed = false;
+
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (body[i]->kind == AST_WHILE_LOOP) {
+            ast_node_t** hoisted = _hoist_from_loop(licm, body[i]);
+            for (size_t j = 0; j < arrlenu(hoisted); j++) {
+                arrput(out, hoisted[j]);
+            }
+            changed |= arrlenu(hoisted) != 0;
+            arrfree(hoisted);
+        }
+        arrput(out, body[i]);
+    }
+
+    if (changed) {
+        arrfree(body);
+        *body_ptr = out;
+    }
+    else {
+        arrfree(out);
+    }
+}
+
+static ast_visit_result_t _licm_pre(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    licm_t* licm = user;
+    if (ast->kind == AST_FUNCTION_DECLARATION) {
+        if (licm->address_taken) {
+            stbds_header(licm->address_taken)->length = 0;
+        }
+        const ast_visitor_t Visitor = { .pre = _collect_address_taken, .user = &licm->address_taken };
+        for (size_t i = 0; i < arrlenu(ast->data.function_declaration.body); i++) {
+            ast_visit(&ast->data.function_declaration.body[i], &Visitor);
+        }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+// Called after the inner loops have been handled, bodies of the parent can be modified here.
+static ast_visit_result_t _licm_post(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    licm_t* licm = user;
+
+    switch (ast->kind) {
+        case AST_FUNCTION_DECLARATION: {
+            _hoist_in_body(licm, &ast->data.function_declaration.body);
+            break;
+        }
+
+        case AST_IF_STATEMENT: {
+            _hoist_in_body(licm, &ast->data.if_statement.body);
+            _hoist_in_body(licm, &ast->data.if_statement.else_body);
+            break;
+        }
+
+        case AST_WHILE_LOOP: {
+            _hoist_in_body(licm, &ast->data.while_loop.body);
+            break;
+        }
+
+        case AST_FOR_LOOP: {
+            _hoist_in_body(licm, &ast->data.for_loop.body);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return AST_VISIT_CONTINUE;
+}
+
+void ast_hoist_loop_invariants(struct arena_t* arena, struct ast_node_t* ast) {
+    licm_t licm = { .arena = arena, .address_taken = NULL, .hoisted_count = 0 };
+    const ast_visitor_t Visitor = { .pre = _licm_pre, .post = _licm_post, .user = &licm };
+    ast_visit(&ast, &Visitor);
+    arrfree(licm.address_taken);
+}
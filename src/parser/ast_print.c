@@ -8,6 +8,7 @@
 #include "ast_print.h"
 #include "ast_kinds.h"
 #include "ast_type.h"
+#include "ast_visit.h"
 
 
 /*
@@ -15,9 +16,8 @@
         These allows drawing the pipes past grand children.
         For the last child the branch should be cleared so "BRANCH_LAST_CHILD_CHAR" can be printed.
 */
-#define HAS_BRANCH(depth)   (bool)(sPrintTreeBranchBits & (1 << (depth)))
-#define SET_BRANCH(depth)   (sPrintTreeBranchBits |= 1 << (depth))
-#define CLEAR_BRANCH(depth) (sPrintTreeBranchBits &= ~(1 << (depth)))
+#define HAS_BRANCH(ctx, depth)          (bool)((ctx)->branches[depth])
+#define SET_BRANCH(ctx, depth, value)   ((ctx)->branches[depth] = (value))
 
 #define AST_TYPE_COLOR STDOUT_BLUE
 #define AST_SECONDARY_COLOR STDOUT_RED
@@ -27,7 +27,10 @@
 #define BRANCH_LAST_CHILD_CHAR "\u2517"
 #define BRANCH_CONNECT_CHILD_CHAR "\u2501"
 
-static uint64_t sPrintTreeBranchBits = 0;
+typedef struct print_ctx_t {
+    bool* branches; // for every printed depth
+    size_t* depths; // visit depth -> printed depth, headers like "if-body:" add depth.
+} print_ctx_t;
 
 const char* op_to_str(op_t op) {
     DEBUG_ASSERT(op >= 0 && op < OP_COUNT, "op is out of range");
@@ -49,9 +52,9 @@ const char* ast_kind_to_str(ast_kind_t kind) {
     return sAst2Str[kind];    
 }
 
-static void print_ast_indention(size_t depth) {
+static void print_ast_indention(const print_ctx_t* ctx, size_t depth) {
     for (size_t i = 0; i < depth; i++) {
-        if (HAS_BRANCH(i)) {
+        if (HAS_BRANCH(ctx, i)) {
             /* parent of the child */
             if ((i+1) == depth) {
                 printf(BRANCH_COLOR "" BRANCH_CHILD_CHAR BRANCH_CONNECT_CHILD_CHAR " " STDOUT_RESET);
@@ -75,91 +78,46 @@ static void print_ast_indention(size_t depth) {
 
 /*
     Print func for every type. I do this to force type safety, this could just be a HUGE switch statement.
+    Only the node itself is printed, children are printed by the visitor.
 */
-#define SPACE_MULTIPLIER 3
-#define AST_PRINT(depth, ...)       \
-    do {                            \
-        print_ast_indention(depth); \
-        printf(__VA_ARGS__);        \
+#define AST_PRINT(ctx, depth, ...)          \
+    do {                                    \
+        print_ast_indention(ctx, depth);    \
+        printf(__VA_ARGS__);                \
     } while (0)
 
-#define AST_PRINT_SETUP(depth, kind, ...)       \
+#define AST_PRINT_SETUP(ctx, depth, kind, ...)  \
     do {                                        \
-        print_ast_indention(depth);             \
+        print_ast_indention(ctx, depth);        \
         printf(AST_TYPE_COLOR "%s " STDOUT_RESET, ast_kind_to_str(kind));   \
         printf(__VA_ARGS__);                    \
     } while (0)
 
-#define AST_PRINT_SETUP_NO_ADDITIONAL(depth, kind) \
-    AST_PRINT_SETUP(depth, kind, "\n")
-
-#define AST_PRINT_NODE_BODY(array, depth)  \
-    do {                                                        \
-        SET_BRANCH(depth);                                      \
-        const size_t Len = arrlenu(array);                      \
-        for (size_t i = 0; i < Len; i++) {                      \
-            if ((i+1) == Len) { CLEAR_BRANCH(depth); }          \
-            print_ast_internal(array[i], depth+1);              \
-        }                                                       \
-    } while(0)
+#define AST_PRINT_SETUP_NO_ADDITIONAL(ctx, depth, kind) \
+    AST_PRINT_SETUP(ctx, depth, kind, "\n")
 
 #define PRINT_POS(pos) printf("<%s:%zu:%zu:%i>", pos.filepath, pos.line, pos.column, pos.length);
 
-static void print_ast_internal(const ast_node_t* node, size_t depth);
-
-static void print_ast_unary_op(const ast_unary_op_t* unary_op, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_UNARY_OP, "<%s>\n", op_to_str(unary_op->operation));
-
-    print_ast_internal(unary_op->operand, depth+1);
+static void print_ast_unary_op(const print_ctx_t* ctx, const ast_unary_op_t* unary_op, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_UNARY_OP, "<%s>\n", op_to_str(unary_op->operation));
 }
 
-static void print_ast_binary_op(const ast_binary_op_t* binary_op, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_BINARY_OP, "<%s>\n", op_to_str(binary_op->operation));
-
-    SET_BRANCH(depth);
-    print_ast_internal(binary_op->left, depth+1);
-    CLEAR_BRANCH(depth);
-    print_ast_internal(binary_op->right, depth+1);
+static void print_ast_binary_op(const print_ctx_t* ctx, const ast_binary_op_t* binary_op, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_BINARY_OP, "<%s>\n", op_to_str(binary_op->operation));
 }
 
-
-static void print_ast_if_statement(const ast_if_statement_t* if_statement, size_t depth) {
-    AST_PRINT_SETUP_NO_ADDITIONAL(depth, AST_IF_STATEMENT);
-
-    SET_BRANCH(depth);
-    AST_PRINT(depth+1, "if-expr: \n");
-    print_ast_internal(if_statement->expr, depth+2);
-
-    if (!if_statement->else_body) { CLEAR_BRANCH(depth); }
-
-    SET_BRANCH(depth+1);
-    AST_PRINT(depth+1, "if-body: \n");
-    AST_PRINT_NODE_BODY(if_statement->body, depth+1);
-
-    if (if_statement->else_body) {
-        CLEAR_BRANCH(depth);
-        AST_PRINT(depth+1, "else-body: \n");
-        SET_BRANCH(depth+1);
-        AST_PRINT_NODE_BODY(if_statement->else_body, depth+1);
-    }
-}
-
-static void print_ast_variable_declaration(const ast_variable_declaration_t* var_decl, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_VARIABLE_DECLARATION, "<%s: ", var_decl->name);
+static void print_ast_variable_declaration(const print_ctx_t* ctx, const ast_variable_declaration_t* var_decl, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_VARIABLE_DECLARATION, "<%s: ", var_decl->name);
     datatype_print(&var_decl->type);
     printf(">\n");
-
-    print_ast_internal(var_decl->expr, depth+1);
 }
 
-static void print_ast_field_initializer(const ast_field_initializer_t* field_init, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_FIELD_INITIALIZER, "<%s>\n", field_init->name);
-
-    print_ast_internal(field_init->expr, depth+1);
+static void print_ast_field_initializer(const print_ctx_t* ctx, const ast_field_initializer_t* field_init, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_FIELD_INITIALIZER, "<%s>\n", field_init->name);
 }
 
-static void print_ast_function_declaration(const ast_function_declaration_t* func_decl, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_FUNCTION_DECLARATION, "<%s> <(", func_decl->name);
+static void print_ast_function_declaration(const print_ctx_t* ctx, const ast_function_declaration_t* func_decl, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_FUNCTION_DECLARATION, "<%s> <(", func_decl->name);
     /* Args */
     const size_t ArgCount = arrlenu(func_decl->args);
     for (size_t i = 0; i < ArgCount; i++) {
@@ -174,12 +132,10 @@ static void print_ast_function_declaration(const ast_function_declaration_t* fun
     printf(")> -> <");
     datatype_print(&func_decl->return_type);
     printf(">\n");
-
-    AST_PRINT_NODE_BODY(func_decl->body, depth);
 }
 
-static void print_ast_struct_declaration(const ast_struct_declaration_t* struct_decl, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_STRUCT_DECLARATION, "<%s> <{", struct_decl->name);
+static void print_ast_struct_declaration(const print_ctx_t* ctx, const ast_struct_declaration_t* struct_decl, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_STRUCT_DECLARATION, "<%s> <{", struct_decl->name);
     /* Members */
     const size_t MemberCount = arrlenu(struct_decl->members);
     for (size_t i = 0; i < MemberCount; i++) {
@@ -194,160 +150,104 @@ static void print_ast_struct_declaration(const ast_struct_declaration_t* struct_
     printf("}>\n");
 }
 
-static void print_ast_struct_initializer_list(const ast_struct_initializer_list_t* init_list, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_STRUCT_INITIALIZER_LIST, "<%s>\n", init_list->name);
-    /* Fields */
-    SET_BRANCH(depth);
-
-    // AST_PRINT_NODE_BODY(init_list->fields);
-    const size_t FieldCount = arrlenu(init_list->fields);
-    for (size_t i = 0; i < FieldCount; i++) {
-        if ((i+1) == FieldCount) { CLEAR_BRANCH(depth); }
-
-        const ast_field_initializer_t* Field = &init_list->fields[i];
-        print_ast_field_initializer(Field, depth + 1);
-    }
+static void print_ast_struct_initializer_list(const print_ctx_t* ctx, const ast_struct_initializer_list_t* init_list, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_STRUCT_INITIALIZER_LIST, "<%s>\n", init_list->name);
 }
 
-static void print_ast_array_initializer_list(const ast_array_initializer_list_t* init_list, size_t depth) {
-    AST_PRINT_SETUP_NO_ADDITIONAL(depth, AST_ARRAY_INITIALIZER_LIST);
-    /* Fields */
-    SET_BRANCH(depth);
-    const size_t ExprsCount = arrlenu(init_list->exprs);
-    for (size_t i = 0; i < ExprsCount; i++) {
-        if ((i+1) == ExprsCount) { CLEAR_BRANCH(depth); }
-
-        const ast_node_t* Expr = init_list->exprs[i];
-        print_ast_internal(Expr, depth + 1);
-    }
-}
-
-static void print_ast_function_call(const ast_function_call_t* func_call, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_FUNCTION_CALL, "<%s>\n", func_call->name);
-    /* Args */
-    SET_BRANCH(depth);
-    const size_t ArgCount = arrlenu(func_call->args);
-    for (size_t i = 0; i < ArgCount; i++) {
-        if ((i+1) == ArgCount) { CLEAR_BRANCH(depth); }
-
-        const ast_node_t* Arg = func_call->args[i];
-        print_ast_internal(Arg, depth + 1);
-    }
+static void print_ast_function_call(const print_ctx_t* ctx, const ast_function_call_t* func_call, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_FUNCTION_CALL, "<%s>\n", func_call->name);
 }
 
-static void print_ast_while_loop(const ast_while_loop_t* while_loop, size_t depth) {
-    AST_PRINT_SETUP_NO_ADDITIONAL(depth, AST_WHILE_LOOP);
-    
-    if (while_loop->body)
-        SET_BRANCH(depth);
-    
-    print_ast_internal(while_loop->expr, depth + 1);
-    AST_PRINT_NODE_BODY(while_loop->body, depth);
+static void print_ast_for_loop(const print_ctx_t* ctx, const ast_for_loop_t* for_loop, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_FOR_LOOP, "<%s> <%zu..%zu>\n", for_loop->identifier, for_loop->iter.from, for_loop->iter.to);
 }
 
-static void print_ast_for_loop(const ast_for_loop_t* for_loop, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_FOR_LOOP, "<%s> <%zu..%zu>\n", for_loop->identifier, for_loop->iter.from, for_loop->iter.to);
-    AST_PRINT_NODE_BODY(for_loop->body, depth);
-}
-
-static void print_ast_translation_unit(const ast_translation_unit_t* unit, size_t depth) {
-    AST_PRINT_SETUP_NO_ADDITIONAL(depth, AST_TRANSLATION_UNIT);
-    AST_PRINT_NODE_BODY(unit->body, depth);
-}
-
-static void print_ast_literal(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, node->kind, "<%s> ", node->data.literal);
+static void print_ast_literal(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, node->kind, "<%s> ", node->data.literal);
     PRINT_POS(node->position);
     printf("\n");
 }
 
-static void print_ast_cast(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_CAST_STATEMENT, "type: <");
+static void print_ast_cast(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_CAST_STATEMENT, "type: <");
     datatype_print(&node->data.cast_statement.target_type);
     printf("> ");
     PRINT_POS(node->position);
     printf("\n");
-    print_ast_internal(node->data.cast_statement.expr, depth + 1);
 }
 
-static void print_get_member(const ast_get_member_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, AST_GET_MEMBER, " '%s'\n", node->member);
-    print_ast_internal(node->expr, depth + 1);
+static void print_get_member(const print_ctx_t* ctx, const ast_get_member_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, AST_GET_MEMBER, " '%s'\n", node->member);
 }
 
-static void print_return(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP_NO_ADDITIONAL(depth, AST_RETURN);
-    print_ast_internal(node->data.expr, depth + 1);
-}
-
-static void print_bool_literal(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, node->kind, AST_SECONDARY_COLOR "'%s " STDOUT_RESET , BOOL2STR(node->data.boolean));
+static void print_bool_literal(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, node->kind, AST_SECONDARY_COLOR "'%s " STDOUT_RESET , BOOL2STR(node->data.boolean));
     PRINT_POS(node->position);
     printf("\n");
 }
 
-static void print_float_literal(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, node->kind, AST_SECONDARY_COLOR "'%f' " STDOUT_RESET , node->data.f32);
+static void print_float_literal(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, node->kind, AST_SECONDARY_COLOR "'%f' " STDOUT_RESET , node->data.f32);
     PRINT_POS(node->position);
     printf("\n");
 }
 
-static void print_integer_literal(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, node->kind, AST_SECONDARY_COLOR "'%li' " STDOUT_RESET , node->data.integer);
+static void print_integer_literal(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, node->kind, AST_SECONDARY_COLOR "'%li' " STDOUT_RESET , node->data.integer);
     PRINT_POS(node->position);
     printf("\n");
 }
 
-static void print_char_literal(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, node->kind, AST_SECONDARY_COLOR "'%c' " STDOUT_RESET , node->data.c);
+static void print_char_literal(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, node->kind, AST_SECONDARY_COLOR "'%c' " STDOUT_RESET , node->data.c);
     PRINT_POS(node->position);
     printf("\n");
 }
 
-static void print_basic(const ast_node_t* node, size_t depth) {
-    AST_PRINT_SETUP(depth, node->kind, " ");
+static void print_basic(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
+    AST_PRINT_SETUP(ctx, depth, node->kind, " ");
     PRINT_POS(node->position);
     printf("\n");
 }
 
-static void print_ast_internal(const ast_node_t* node, size_t depth) {
+static void print_ast_node(const print_ctx_t* ctx, const ast_node_t* node, size_t depth) {
     if (node == NULL) {
-        AST_PRINT_SETUP(depth, AST_NONE, "<null>\n");
+        AST_PRINT_SETUP(ctx, depth, AST_NONE, "<null>\n");
         return;
     }
 
     switch(node->kind) {
         /* ast types */
-        case AST_STRUCT_INITIALIZER_LIST : print_ast_struct_initializer_list(&node->data.struct_initializer_list, depth); break;
-        case AST_ARRAY_INITIALIZER_LIST  : print_ast_array_initializer_list(&node->data.array_initializer_list, depth); break;
-        case AST_TRANSLATION_UNIT        : print_ast_translation_unit    (&node->data.translation_unit, depth); break;
-        case AST_FIELD_INITIALIZER       : print_ast_field_initializer   (&node->data.field_initializer, depth); break;
-        case AST_VARIABLE_DECLARATION    : print_ast_variable_declaration(&node->data.variable_declaration, depth); break;
-        case AST_STRUCT_DECLARATION      : print_ast_struct_declaration  (&node->data.struct_declaration, depth); break;
-        case AST_FUNCTION_DECLARATION    : print_ast_function_declaration(&node->data.function_declaration, depth); break;
-        case AST_FUNCTION_CALL           : print_ast_function_call       (&node->data.function_call, depth); break;
-        case AST_WHILE_LOOP              : print_ast_while_loop          (&node->data.while_loop, depth); break;
-        case AST_FOR_LOOP                : print_ast_for_loop            (&node->data.for_loop, depth); break;
-        case AST_IF_STATEMENT            : print_ast_if_statement        (&node->data.if_statement, depth); break;
-        case AST_UNARY_OP                : print_ast_unary_op            (&node->data.unary_op, depth); break;
-        case AST_BINARY_OP               : print_ast_binary_op           (&node->data.binary_op, depth); break;
-        case AST_GET_MEMBER              : print_get_member              (&node->data.get_member, depth); break;
-        case AST_CAST_STATEMENT          : print_ast_cast                (node, depth); break;
-        case AST_RETURN                  : print_return                  (node, depth); break;
+        case AST_STRUCT_INITIALIZER_LIST : print_ast_struct_initializer_list(ctx, &node->data.struct_initializer_list, depth); break;
+        case AST_ARRAY_INITIALIZER_LIST  : AST_PRINT_SETUP_NO_ADDITIONAL(ctx, depth, AST_ARRAY_INITIALIZER_LIST); break;
+        case AST_TRANSLATION_UNIT        : AST_PRINT_SETUP_NO_ADDITIONAL(ctx, depth, AST_TRANSLATION_UNIT); break;
+        case AST_FIELD_INITIALIZER       : print_ast_field_initializer   (ctx, &node->data.field_initializer, depth); break;
+        case AST_VARIABLE_DECLARATION    : print_ast_variable_declaration(ctx, &node->data.variable_declaration, depth); break;
+        case AST_STRUCT_DECLARATION      : print_ast_struct_declaration  (ctx, &node->data.struct_declaration, depth); break;
+        case AST_FUNCTION_DECLARATION    : print_ast_function_declaration(ctx, &node->data.function_declaration, depth); break;
+        case AST_FUNCTION_CALL           : print_ast_function_call       (ctx, &node->data.function_call, depth); break;
+        case AST_WHILE_LOOP              : AST_PRINT_SETUP_NO_ADDITIONAL(ctx, depth, AST_WHILE_LOOP); break;
+        case AST_FOR_LOOP                : print_ast_for_loop            (ctx, &node->data.for_loop, depth); break;
+        case AST_IF_STATEMENT            : AST_PRINT_SETUP_NO_ADDITIONAL(ctx, depth, AST_IF_STATEMENT); break;
+        case AST_UNARY_OP                : print_ast_unary_op            (ctx, &node->data.unary_op, depth); break;
+        case AST_BINARY_OP               : print_ast_binary_op           (ctx, &node->data.binary_op, depth); break;
+        case AST_GET_MEMBER              : print_get_member              (ctx, &node->data.get_member, depth); break;
+        case AST_CAST_STATEMENT          : print_ast_cast                (ctx, node, depth); break;
+        case AST_RETURN                  : AST_PRINT_SETUP_NO_ADDITIONAL(ctx, depth, AST_RETURN); break;
 
         
         /* generic */
-        case AST_IMPORT      : print_ast_literal(node, depth); break;
-        case AST_GET_VARIABLE: print_ast_literal(node, depth); break;
-        case AST_BOOL_LITERAL  : print_bool_literal(node, depth); break;
-        case AST_INTEGER_LITERAL : print_integer_literal(node, depth); break;
-        case AST_FLOAT_LITERAL : print_float_literal(node, depth); break;
-        case AST_CHAR_LITERAL  : print_char_literal(node, depth); break;
-        case AST_STRING_LITERAL: print_ast_literal(node, depth); break;
+        case AST_IMPORT      : print_ast_literal(ctx, node, depth); break;
+        case AST_GET_VARIABLE: print_ast_literal(ctx, node, depth); break;
+        case AST_BOOL_LITERAL  : print_bool_literal(ctx, node, depth); break;
+        case AST_INTEGER_LITERAL : print_integer_literal(ctx, node, depth); break;
+        case AST_FLOAT_LITERAL : print_float_literal(ctx, node, depth); break;
+        case AST_CHAR_LITERAL  : print_char_literal(ctx, node, depth); break;
+        case AST_STRING_LITERAL: print_ast_literal(ctx, node, depth); break;
 
         /* basic */
-        case AST_BREAK   : print_basic(node, depth); break;
-        case AST_CONTINUE: print_basic(node, depth); break;
+        case AST_BREAK   : print_basic(ctx, node, depth); break;
+        case AST_CONTINUE: print_basic(ctx, node, depth); break;
 
         default: {
             PANIC("ast printing not implemented for type %s", ast_kind_to_str(node->kind));
@@ -356,7 +256,70 @@ static void print_ast_internal(const ast_node_t* node, size_t depth) {
     }
 }
 
+// Prints the labels like "if-body:" which group children, returns the depth for the child.
+static size_t print_ast_child_header(print_ctx_t* ctx, const ast_visit_t* visit, size_t parent_depth) {
+    const ast_node_t* Parent = visit->parent;
+    const bool IsLastInGroup = (visit->index + 1) == visit->count;
+
+    if (Parent->kind == AST_IF_STATEMENT) {
+        if (visit->index == 0) {
+            const char* Header = "if-expr";
+            bool has_more = true;
+            if (visit->role == AST_ROLE_BODY) {
+                Header = "if-body";
+                has_more = Parent->data.if_statement.else_body != NULL;
+            }
+            else if (visit->role == AST_ROLE_ELSE_BODY) {
+                Header = "else-body";
+                has_more = false;
+            }
+            SET_BRANCH(ctx, parent_depth, has_more);
+            AST_PRINT(ctx, parent_depth + 1, "%s: \n", Header);
+        }
+        SET_BRANCH(ctx, parent_depth + 1, !IsLastInGroup);
+        return parent_depth + 2;
+    }
+
+    if (visit->role == AST_ROLE_FIELD) {
+        SET_BRANCH(ctx, parent_depth, !visit->is_last);
+        print_ast_field_initializer(ctx, &Parent->data.struct_initializer_list.fields[visit->index], parent_depth + 1);
+        SET_BRANCH(ctx, parent_depth + 1, false);
+        return parent_depth + 2;
+    }
+
+    SET_BRANCH(ctx, parent_depth, !visit->is_last);
+    return parent_depth + 1;
+}
+
+static ast_visit_result_t print_ast_visit(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    print_ctx_t* ctx = user;
+
+    size_t depth = 0;
+    if (visit->parent) {
+        depth = print_ast_child_header(ctx, visit, ctx->depths[visit->depth - 1]);
+    }
+    if (arrlenu(ctx->depths) <= visit->depth) {
+        arrput(ctx->depths, depth);
+    }
+    ctx->depths[visit->depth] = depth;
+    while (arrlenu(ctx->branches) < depth + 2) {
+        arrput(ctx->branches, false);
+    }
+
+    print_ast_node(ctx, node, depth);
+    return AST_VISIT_CONTINUE;
+}
+
 void print_ast_tree(const ast_node_t* node) {
     DEBUG_ASSERT(node, "node is null");
-    print_ast_internal(node, 0);
+
+    print_ctx_t ctx = { 0 };
+
+    // The printer only reads the tree, the visitor just doesn't have a const variant.
+    ast_node_t* root = (ast_node_t*)node;
+    const ast_visitor_t Visitor = { .pre = print_ast_visit, .user = &ctx, .visit_null = true };
+    ast_visit(&root, &Visitor);
+
+    arrfree(ctx.branches);
+    arrfree(ctx.depths);
 }
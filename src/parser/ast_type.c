@@ -1,92 +1,120 @@
+#include <string.h>
 #include <stb/stb_ds.h>
 
 #include "../common/arena.h"
 #include "../common/error.h"
 
 #include "ast_type.h"
+#include "ast_visit.h"
 
-typedef void (*fn_on_ast)(ast_node_t* node, const void* additional);
+// Nodes are in the arena, only the dynamic arrays have to be freed. Children are freed before their parent.
+static ast_visit_result_t _ast_free_node(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    (void)visit; (void)user;
 
-#define AST_BODY_FREE(ast_body)             \
-    do {                                    \
-        size_t Len = arrlenu(ast_body);     \
-        for (size_t i = 0; i < Len; i++) {  \
-            _ast_free_node(ast_body[i]);    \
-        }                                   \
-        arrfree(ast_body);                  \
-    } while(0)
-
-//TODO: some way to do this with __VA_ARGS__, probably turn this is into a macro? Using a void* to pass additional args is kinda dirty.
-static void _ast_free_node(ast_node_t* parent) {
-    if (!parent) {
-        return;
-    }
-
-    // Print children
-    switch (parent->kind) {
+    switch (node->kind) {
         case AST_TRANSLATION_UNIT: {
-            AST_BODY_FREE(parent->data.translation_unit.body);
+            arrfree(node->data.translation_unit.body);
             break;
         }
 
         case AST_FUNCTION_CALL: {
-            AST_BODY_FREE(parent->data.function_call.args);
+            arrfree(node->data.function_call.args);
             break;
         }
 
-        case AST_RETURN: {
-            _ast_free_node(parent->data.expr);
+        case AST_IF_STATEMENT: {
+            arrfree(node->data.if_statement.body);
+            arrfree(node->data.if_statement.else_body);
             break;
         }
 
-        case AST_IF_STATEMENT: {
-            _ast_free_node(parent->data.if_statement.expr);
-
-            AST_BODY_FREE(parent->data.if_statement.body);
-            AST_BODY_FREE(parent->data.if_statement.else_body);
+        case AST_STRUCT_DECLARATION: {
+            arrfree(node->data.struct_declaration.members);
             break;
         }
 
-        case AST_BINARY_OP: {
-            _ast_free_node(parent->data.binary_op.left);
-            _ast_free_node(parent->data.binary_op.right);
+        case AST_FUNCTION_DECLARATION: {
+            arrfree(node->data.function_declaration.args);
+            arrfree(node->data.function_declaration.body);
             break;
         }
 
-        case AST_FIELD_INITIALIZER: {
-            _ast_free_node(parent->data.field_initializer.expr);
+        case AST_WHILE_LOOP: {
+            arrfree(node->data.while_loop.body);
             break;
         }
 
-        case AST_VARIABLE_DECLARATION: {
-            _ast_free_node(parent->data.variable_declaration.expr);
+        case AST_FOR_LOOP: {
+            arrfree(node->data.for_loop.body);
             break;
         }
-        
-        case AST_STRUCT_DECLARATION: {
-            arrfree(parent->data.struct_declaration.members);
+
+        case AST_STRUCT_INITIALIZER_LIST: {
+            arrfree(node->data.struct_initializer_list.fields);
             break;
         }
 
-        case AST_FUNCTION_DECLARATION: {
-            arrfree(parent->data.function_declaration.args);
-            AST_BODY_FREE(parent->data.function_declaration.body);
+        case AST_ARRAY_INITIALIZER_LIST: {
+            arrfree(node->data.array_initializer_list.exprs);
             break;
         }
 
-        case AST_WHILE_LOOP: {
-            _ast_free_node(parent->data.while_loop.expr);
-            AST_BODY_FREE(parent->data.while_loop.body);
+        default: { break; }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+// Points 'arr' to a copy of the stb_ds array.
+#define ARRAY_CLONE(arr) do {                                       \
+        const size_t _count = arrlenu(arr);                         \
+        const void* _src = (arr);                                   \
+        (arr) = NULL;                                               \
+        if (_count) {                                               \
+            arrsetlen(arr, _count);                                 \
+            memcpy((arr), _src, _count * sizeof(*(arr)));           \
+        }                                                           \
+    } while (0)
+
+// Replaces the node with a copy which owns its own arrays, the children are copied when they're visited.
+static ast_visit_result_t _ast_clone_node(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    ast_node_t* copy = arena_alloc(user, sizeof(ast_node_t));
+    *copy = *node;
+    *visit->slot = copy;
+
+    switch (copy->kind) {
+        case AST_TRANSLATION_UNIT:          { ARRAY_CLONE(copy->data.translation_unit.body); break; }
+        case AST_FUNCTION_CALL:             { ARRAY_CLONE(copy->data.function_call.args); break; }
+        case AST_STRUCT_DECLARATION:        { ARRAY_CLONE(copy->data.struct_declaration.members); break; }
+        case AST_WHILE_LOOP:                { ARRAY_CLONE(copy->data.while_loop.body); break; }
+        case AST_FOR_LOOP:                  { ARRAY_CLONE(copy->data.for_loop.body); break; }
+        case AST_STRUCT_INITIALIZER_LIST:   { ARRAY_CLONE(copy->data.struct_initializer_list.fields); break; }
+        case AST_ARRAY_INITIALIZER_LIST:    { ARRAY_CLONE(copy->data.array_initializer_list.exprs); break; }
+        case AST_IF_STATEMENT: {
+            ARRAY_CLONE(copy->data.if_statement.body);
+            ARRAY_CLONE(copy->data.if_statement.else_body);
             break;
         }
-
-        case AST_FOR_LOOP: {
-            AST_BODY_FREE(parent->data.for_loop.body);
+        case AST_FUNCTION_DECLARATION: {
+            ARRAY_CLONE(copy->data.function_declaration.args);
+            ARRAY_CLONE(copy->data.function_declaration.body);
             break;
         }
-
         default: { break; }
     }
+    return AST_VISIT_CONTINUE;
+}
+
+#undef ARRAY_CLONE
+
+ast_node_t* ast_clone_tree(arena_t* arena, const ast_node_t* node) {
+    if (!node) {
+        return NULL;
+    }
+
+    ast_node_t* root = (ast_node_t*)node; // replaced by the copy before anything is written
+    const ast_visitor_t Visitor = { .pre = _ast_clone_node, .user = arena };
+    ast_visit(&root, &Visitor);
+    return root;
 }
 
 ast_node_t* ast_arena_new(arena_t* arena, ast_kind_t kind) {
@@ -96,5 +124,10 @@ ast_node_t* ast_arena_new(arena_t* arena, ast_kind_t kind) {
 }
 
 void ast_free_tree(ast_node_t* node) {
-    _ast_free_node(node);
+    if (!node) {
+        return;
+    }
+
+    const ast_visitor_t Visitor = { .post = _ast_free_node };
+    ast_visit(&node, &Visitor);
 }
@@ -36,6 +36,7 @@ typedef struct ast_unary_op_t {
 typedef struct ast_get_member_t {
     const char* member;
     struct ast_node_t* expr;
+    const struct struct_member_t* resolved; // set by semantic analysis
 } ast_get_member_t;
 
 typedef struct ast_cast_statement_t {
@@ -58,6 +59,7 @@ typedef struct ast_variable_declaration_t {
 typedef struct ast_field_initializer_t {
     const char* name;
     struct ast_node_t* expr;
+    const struct struct_member_t* member; // set by semantic analysis
 } ast_field_initializer_t;
 
 typedef struct ast_function_declaration_t {
@@ -66,11 +68,13 @@ typedef struct ast_function_declaration_t {
     datatype_t return_type;
     struct ast_node_t** body;
     bool external;
+    bool inline_hint; // 'inline fn', inlined regardless of its size
 } ast_function_declaration_t;
 
 typedef struct ast_struct_declaration_t {
     const char* name;
     ast_variable_declaration_t* members;
+    struct struct_layout_t* layout; // set by semantic analysis
 } ast_struct_declaration_t;
 
 typedef struct ast_struct_initializer_list_t  {
@@ -140,5 +144,6 @@ struct arena_t;
 
 ast_node_t* ast_arena_new(struct arena_t* arena, ast_kind_t kind);
 void ast_free_tree(ast_node_t* node); // frees all it's children as well
+ast_node_t* ast_clone_tree(struct arena_t* arena, const ast_node_t* node); // deep copy, strings & types are shared
 
 #endif
@@ -0,0 +1,206 @@
+#include <stb/stb_ds.h>
+
+#include "../common/error.h"
+#include "ast_type.h"
+#include "ast_visit.h"
+
+typedef struct visit_frame_t {
+    ast_visit_t visit;
+    bool expanded; // 'pre' was called & children were pushed
+} visit_frame_t;
+
+typedef struct child_t {
+    ast_node_t** slot;
+    ast_role_t role;
+    size_t index;
+    size_t count;
+} child_t;
+
+static void _push_child(child_t** children, ast_node_t** slot, ast_role_t role, size_t index, size_t count, bool visit_null) {
+    if (!*slot && !visit_null) {
+        return;
+    }
+    const child_t Child = { .slot = slot, .role = role, .index = index, .count = count };
+    arrput(*children, Child);
+}
+
+static void _push_body(child_t** children, ast_node_t** body, ast_role_t role) {
+    const size_t Count = arrlenu(body);
+    for (size_t i = 0; i < Count; i++) {
+        _push_child(children, &body[i], role, i, Count, false);
+    }
+}
+
+// Collects the children of a node in the order they're evaluated.
+static void _collect_children(child_t** children, ast_node_t* node, bool visit_null) {
+    switch (node->kind) {
+        case AST_TRANSLATION_UNIT: {
+            _push_body(children, node->data.translation_unit.body, AST_ROLE_BODY);
+            break;
+        }
+
+        case AST_FUNCTION_DECLARATION: {
+            _push_body(children, node->data.function_declaration.body, AST_ROLE_BODY);
+            break;
+        }
+
+        case AST_FUNCTION_CALL: {
+            _push_body(children, node->data.function_call.args, AST_ROLE_ARG);
+            break;
+        }
+
+        case AST_IF_STATEMENT: {
+            _push_child(children, &node->data.if_statement.expr, AST_ROLE_CONDITION, 0, 1, visit_null);
+            _push_body(children, node->data.if_statement.body, AST_ROLE_BODY);
+            _push_body(children, node->data.if_statement.else_body, AST_ROLE_ELSE_BODY);
+            break;
+        }
+
+        case AST_WHILE_LOOP: {
+            _push_child(children, &node->data.while_loop.expr, AST_ROLE_CONDITION, 0, 1, visit_null);
+            _push_body(children, node->data.while_loop.body, AST_ROLE_BODY);
+            break;
+        }
+
+        case AST_FOR_LOOP: {
+            _push_body(children, node->data.for_loop.body, AST_ROLE_BODY);
+            break;
+        }
+
+        case AST_BINARY_OP: {
+            _push_child(children, &node->data.binary_op.left, AST_ROLE_LEFT, 0, 1, visit_null);
+            _push_child(children, &node->data.binary_op.right, AST_ROLE_RIGHT, 0, 1, visit_null);
+            break;
+        }
+
+        case AST_UNARY_OP: {
+            _push_child(children, &node->data.unary_op.operand, AST_ROLE_OPERAND, 0, 1, visit_null);
+            break;
+        }
+
+        case AST_CAST_STATEMENT: {
+            _push_child(children, &node->data.cast_statement.expr, AST_ROLE_OPERAND, 0, 1, visit_null);
+            break;
+        }
+
+        case AST_GET_MEMBER: {
+            _push_child(children, &node->data.get_member.expr, AST_ROLE_OPERAND, 0, 1, visit_null);
+            break;
+        }
+
+        case AST_RETURN: {
+            _push_child(children, &node->data.expr, AST_ROLE_OPERAND, 0, 1, visit_null);
+            break;
+        }
+
+        case AST_VARIABLE_DECLARATION: {
+            _push_child(children, &node->data.variable_declaration.expr, AST_ROLE_OPERAND, 0, 1, visit_null);
+            break;
+        }
+
+        case AST_FIELD_INITIALIZER: {
+            _push_child(children, &node->data.field_initializer.expr, AST_ROLE_OPERAND, 0, 1, visit_null);
+            break;
+        }
+
+        case AST_STRUCT_INITIALIZER_LIST: {
+            ast_field_initializer_t* fields = node->data.struct_initializer_list.fields;
+            const size_t Count = arrlenu(fields);
+            for (size_t i = 0; i < Count; i++) {
+                _push_child(children, &fields[i].expr, AST_ROLE_FIELD, i, Count, visit_null);
+            }
+            break;
+        }
+
+        case AST_ARRAY_INITIALIZER_LIST: {
+            _push_body(children, node->data.array_initializer_list.exprs, AST_ROLE_ELEMENT);
+            break;
+        }
+
+        default: { break; } // leaf
+    }
+}
+
+// A visitor may raise an error, so the buffers are owned by whoever catches it (see 'unwind_alloc').
+typedef struct visit_buffers_t {
+    visit_frame_t* stack;
+    child_t* children;
+} visit_buffers_t;
+
+static void _visit_buffers_free(void* data) {
+    visit_buffers_t* buffers = data;
+    arrfree(buffers->stack);
+    arrfree(buffers->children);
+}
+
+bool ast_visit(ast_node_t** root, const ast_visitor_t* visitor) {
+    DEBUG_ASSERT(root && visitor, "?");
+
+    visit_buffers_t* buffers = unwind_alloc(sizeof(visit_buffers_t), _visit_buffers_free);
+    bool completed = true;
+
+    const visit_frame_t RootFrame = {
+        .visit = { .slot = root, .parent = NULL, .role = AST_ROLE_ROOT, .count = 1, .is_last = true },
+        .expanded = false
+    };
+    arrput(buffers->stack, RootFrame);
+
+    while (arrlenu(buffers->stack)) {
+        visit_frame_t* stack = buffers->stack; // until a frame is pushed
+        const size_t Top = arrlenu(stack) - 1;
+
+        // Leaving the node
+        if (stack[Top].expanded) {
+            const ast_visit_t Visit = arrpop(buffers->stack).visit;
+
+            if (visitor->post && visitor->post(*Visit.slot, &Visit, visitor->user) == AST_VISIT_STOP) {
+                completed = false;
+                break;
+            }
+            continue;
+        }
+
+        // Entering the node
+        stack[Top].expanded = true;
+        const ast_visit_t Visit = stack[Top].visit;
+        ast_visit_result_t result = AST_VISIT_CONTINUE;
+        if (visitor->pre) {
+            result = visitor->pre(*Visit.slot, &Visit, visitor->user);
+        }
+        if (result == AST_VISIT_STOP) {
+            completed = false;
+            break;
+        }
+
+        ast_node_t* node = *Visit.slot; // might've been replaced
+        if (result == AST_VISIT_SKIP || !node) {
+            continue;
+        }
+
+        // Push in reverse, so the first child is visited first.
+        if (buffers->children) {
+            stbds_header(buffers->children)->length = 0;
+        }
+        _collect_children(&buffers->children, node, visitor->visit_null);
+        const child_t* Children = buffers->children;
+        const size_t ChildCount = arrlenu(Children);
+        for (size_t i = ChildCount; i-- > 0;) {
+            const visit_frame_t Frame = {
+                .visit = {
+                    .slot = Children[i].slot,
+                    .parent = node,
+                    .role = Children[i].role,
+                    .depth = Visit.depth + 1,
+                    .index = Children[i].index,
+                    .count = Children[i].count,
+                    .is_last = (i + 1) == ChildCount
+                },
+                .expanded = false
+            };
+            arrput(buffers->stack, Frame);
+        }
+    }
+
+    unwind_free(buffers);
+    return completed;
+}
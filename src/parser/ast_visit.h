@@ -0,0 +1,66 @@
+#ifndef MAYO_AST_VISIT_H
+#define MAYO_AST_VISIT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+    Generic AST traversal which uses an explicit stack instead of recursion,
+    so arbitrarily deep trees (e.g. "a + b + c + ..." with thousands of terms) can be walked.
+
+    Usage:
+        ast_visitor_t visitor = { .pre = on_enter, .post = on_leave, .user = &my_ctx };
+        ast_visit(&root, &visitor);
+
+    'pre' is called before the children are visited, 'post' after all of them have been visited.
+    Both may replace the node by writing into 'visit->slot', e.g. constant folding:
+        *visit->slot = folded_node;
+    A node replaced in 'pre' gets its children (and 'post') visited instead of the original one's.
+    Callbacks must not add or remove children of their parent, bodies can be modified in the parent's 'post'.
+*/
+
+struct ast_node_t;
+
+// Which part of the parent the child is stored in.
+typedef enum ast_role_t {
+    AST_ROLE_ROOT,
+    AST_ROLE_BODY,          // translation unit, function, loop & if bodies
+    AST_ROLE_ELSE_BODY,
+    AST_ROLE_CONDITION,     // if & while
+    AST_ROLE_LEFT,          // binary op
+    AST_ROLE_RIGHT,         // binary op
+    AST_ROLE_OPERAND,       // unary op, cast, get member, return & variable declaration
+    AST_ROLE_ARG,           // function call
+    AST_ROLE_FIELD,         // struct initializer list, 'index' is the index into the fields
+    AST_ROLE_ELEMENT,       // array initializer list
+} ast_role_t;
+
+typedef enum ast_visit_result_t {
+    AST_VISIT_CONTINUE,
+    AST_VISIT_SKIP,         // only from 'pre': don't visit the children, 'post' is still called.
+    AST_VISIT_STOP,         // stops the whole traversal.
+} ast_visit_result_t;
+
+typedef struct ast_visit_t {
+    struct ast_node_t** slot;   // where the node is stored, can be written to replace the node.
+    struct ast_node_t* parent;  // NULL for the root
+    ast_role_t role;
+    size_t depth;               // root is 0
+    size_t index;               // index of the child in its role (e.g. 3rd statement of a body)
+    size_t count;               // count of children in the same role
+    bool is_last;               // last child of the parent
+} ast_visit_t;
+
+typedef ast_visit_result_t (*fn_ast_visit)(struct ast_node_t* node, const ast_visit_t* visit, void* user);
+
+typedef struct ast_visitor_t {
+    fn_ast_visit pre;
+    fn_ast_visit post;
+    void* user;
+    bool visit_null; // empty optional children (e.g. 'return;') are passed as NULL nodes instead of skipped.
+} ast_visitor_t;
+
+// Returns false if the traversal was stopped by a callback.
+bool ast_visit(struct ast_node_t** root, const ast_visitor_t* visitor);
+
+#endif
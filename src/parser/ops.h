@@ -27,6 +27,9 @@ _DEF(BINARY_OP_NOT_EQUAL),
 _DEF(BINARY_OP_AND),
 _DEF(BINARY_OP_OR),
 
+/* not in the syntax, produced by the optimizer */
+_DEF(BINARY_OP_SHIFT_LEFT),
+
 /* left: the array, right: the index */
 _DEF(BINARY_OP_ARRAY_INDEX),
 _DEF(BINARY_OP_ASSIGN),
@@ -1,9 +1,11 @@
 #ifndef MYLANG_PARSER_ERROR_H
 #define MYLANG_PARSER_ERROR_H
 
-#define PARSER_ERROR(pos, ...) \
-    PRINT_ERROR_IN_FILE(pos, __VA_ARGS__); \
-    exit(-1)
+#define PARSER_ERROR(pos, ...)                  \
+    do {                                        \
+        PRINT_ERROR_IN_FILE(pos, __VA_ARGS__);  \
+        LONGJUMP(-1);                           \
+    } while(0)
 
 #define PARSER_WARNING(pos, ...) \
     PRINT_ERROR_IN_FILE(pos, __VA_ARGS__)
@@ -1,5 +1,6 @@
 #include <stb/stb_ds.h>
 #include <stdbool.h>
+#include <string.h>
 #include <threads.h>
 
 #include "../common/arena.h"
@@ -28,14 +29,32 @@ static range_t parser_eat_iterator(parser_t* parser) {
     parser_eat_expect(parser, TOK_DOUBLE_DOT);
     token_t tok_to = parser_eat_expect(parser, TOK_CONST_INTEGER);
     
-    return (range_t) {
+    range_t range = {
         .from = tok_from.data.integer,
         .to = tok_to.data.integer,
-
-        /* @TODO: */
         .step = 1,
         .reverse = false
     };
+
+    while (parser_eat_if(parser, TOK_DOT)) {
+        const token_t Method = parser_eat_expect(parser, TOK_IDENTIFIER);
+        parser_eat_expect(parser, TOK_PAREN_OPEN);
+        if (!strcmp(Method.data.str, "step")) {
+            const token_t Step = parser_eat_expect(parser, TOK_CONST_INTEGER);
+            if (Step.data.integer <= 0) {
+                PARSER_ERROR(Step.position, "the step of a range has to be positive");
+            }
+            range.step = (uint64_t)Step.data.integer;
+        }
+        else if (!strcmp(Method.data.str, "rev")) {
+            range.reverse = parser_eat_expect(parser, TOK_CONST_BOOLEAN).data.boolean;
+        }
+        else {
+            PARSER_ERROR(Method.position, "unknown range method '%s', expected 'step' or 'rev'", Method.data.str);
+        }
+        parser_eat_expect(parser, TOK_PAREN_CLOSE);
+    }
+    return range;
 }
 
 /* Returns the new modified type */
@@ -295,7 +314,8 @@ static ast_node_t* parse_extern_function_declaration(parser_t* parser) {
         .args = args,
         .return_type = ReturnType,
         .body = NULL,
-        .external = true
+        .external = true,
+        .inline_hint = false
     };
     return ast;
 }
@@ -326,7 +346,8 @@ static ast_node_t* parse_function_declaration(parser_t* parser) {
         .args = args,
         .return_type = ReturnType,
         .body = body,
-        .external = false
+        .external = false,
+        .inline_hint = false
     };
     return ast;
 }
@@ -515,6 +536,7 @@ static ast_node_t* parse_for_loop(parser_t* parser) {
 
     ast_node_t* out = ast_arena_new(parser->arena, AST_FOR_LOOP);
     out->data.for_loop = ast_for_loop;
+    out->position = IdentifierTok.position;
     return out;
 }
 
@@ -572,6 +594,7 @@ static ast_node_t* parse_struct_declaration(parser_t* parser) {
 
     ast_node_t* out = ast_arena_new(parser->arena, AST_STRUCT_DECLARATION);
     out->data.struct_declaration = struct_decl;
+    out->position = StructIdentifierTok.position;
     return out;
 }
 
@@ -633,6 +656,13 @@ ast_node_t** parse_global_scope(parser_t* parser) {
                 arrpush(global_scope, ast);
                 break;
             }
+            case TOK_KEYWORD_INLINE: {
+                parser_eat_expect(parser, TOK_KEYWORD_FN);
+                ast_node_t* ast = parse_function_declaration(parser);
+                ast->data.function_declaration.inline_hint = true;
+                arrpush(global_scope, ast);
+                break;
+            }
             case TOK_KEYWORD_STRUCT: {
                 ast_node_t* ast = parse_struct_declaration(parser);
                 arrpush(global_scope, ast);
@@ -721,6 +751,7 @@ ast_node_t** parse_body(parser_t* parser) {
 
             /* Errors */
             case TOK_KEYWORD_FN:
+            case TOK_KEYWORD_INLINE:
             case TOK_KEYWORD_IMPORT: {
                 PARSER_ERROR(tok.position, "'%s' are only allowed in global scope!", token_kind_to_str(tok.kind));
                 break;
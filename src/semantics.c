@@ -1,8 +1,11 @@
 #include <stb/stb_ds.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #include "semantics.h"
+#include "semantics/struct_layout.h"
 #include "parser.h"
+#include "parser/ast_visit.h"
 #include "string.h"
 #include "variant/variant.h"
 
@@ -25,9 +28,10 @@ typedef struct global_scope_t {
     
     // Work around for having to allocate datatypes for inner types.
     arena_t* arena;
-} global_scope_t;
 
-static datatype_t _analyze_expression(global_scope_t* global, const sym_table_t* variables, ast_node_t* expr);
+    // Marks where the variadic arguments begin, see '_analyze_func_call'.
+    ast_node_t* ghost_var;
+} global_scope_t;
 
 static bool _analyze_is_valid_type(const global_scope_t* global, const datatype_t* type) {
     const datatype_t* TrueType = datatype_underlying_type(type);
@@ -68,7 +72,8 @@ static bool _analyze_is_valid_type(const global_scope_t* global, const datatype_
     return var_decl != NULL;
 }
 
-static void _analyze_func_call(global_scope_t* global, const sym_table_t* variables, ast_node_t* node) {
+// Arguments have already been analyzed.
+static void _analyze_func_call(global_scope_t* global, ast_node_t* node) {
     DEBUG_ASSERT(node->kind == AST_FUNCTION_CALL, "?");
     const ast_function_call_t* FuncCall = &node->data.function_call;
             
@@ -98,33 +103,28 @@ static void _analyze_func_call(global_scope_t* global, const sym_table_t* variab
         ast_variable_declaration_t* argument_decl = &FuncDecl->data.function_declaration.args[i].data.variable_declaration;
         ast_node_t* argument_expr = FuncCall->args[i];
         
-        datatype_t ExprType = _analyze_expression(global, variables, argument_expr);
+        const datatype_t ExprType = argument_expr->expr_type;
         if (CheckArgType && !datatype_cmp(&argument_decl->type, &ExprType)) {
             char expr_type_str[0xFF] = { 0 };
             strncpy(expr_type_str, datatype_to_str(&ExprType), ARRAY_LEN(expr_type_str));
             ANALYZER_ERROR(node->position, "Argument expected type '%s', got '%s' instead!", datatype_to_str(&argument_decl->type), expr_type_str);
         }
-        argument_expr->expr_type = ExprType;
     }
 
     // @HACK: Insert a ghost variable decl to call arguments for the backend so it knows when the variadic parameters begin.
     if (IsVariadic) {
-        static ast_node_t ghost_var = {
-            .kind = AST_VARIABLE_DECLARATION,
-            .data.variable_declaration = {
-                .type = {
-                    .kind = DATATYPE_VARIADIC
-                }
-            }
-        };
-        arrins(node->data.function_call.args, DeclArgCount-1, &ghost_var);
+        if (!global->ghost_var) {
+            global->ghost_var = ast_arena_new(global->arena, AST_VARIABLE_DECLARATION);
+            global->ghost_var->data.variable_declaration.type.kind = DATATYPE_VARIADIC;
+        }
+        arrins(node->data.function_call.args, DeclArgCount-1, global->ghost_var);
     }
 
-    // @HACK: also set in _analyze_expression, but _analyze_func_call can also be called somewhere else.
     node->expr_type = FuncDecl->data.function_declaration.return_type;
 }
 
-static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_table_t* variables, ast_node_t* expr) {
+// Called after the children of the expression have been analyzed, their types are in 'expr_type'.
+static datatype_t _analyze_expression(global_scope_t* global, const sym_table_t* variables, ast_node_t* expr) {
     static const datatype_t BoolType = {
         .kind = DATATYPE_PRIMITIVE,
         .typename = "bool"
@@ -170,7 +170,7 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
         }
 
         case AST_FUNCTION_CALL: {
-            _analyze_func_call(global, variables, expr);
+            _analyze_func_call(global, expr);
             ast_node_t* func_decl = sym_table_get(&global->functions, expr->data.literal);
             DEBUG_ASSERT(func_decl->kind == AST_FUNCTION_DECLARATION, "?");
             return func_decl->data.function_declaration.return_type;
@@ -179,12 +179,12 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
         case AST_UNARY_OP: {
             switch (expr->data.unary_op.operation) {
                 case UNARY_OP_NEGATE: {
-                    return _analyze_expression(global, variables, expr->data.unary_op.operand); 
+                    return expr->data.unary_op.operand->expr_type;
                 }
                 case UNARY_OP_ADDRESS_OF: {
                     // Create a type which a pointer to this one.
                     datatype_t* inner = arena_alloc(global->arena, sizeof(datatype_t));
-                    *inner = _analyze_expression(global, variables, expr->data.unary_op.operand);
+                    *inner = expr->data.unary_op.operand->expr_type;
 
                     return (datatype_t) {
                         .kind = DATATYPE_POINTER,
@@ -199,8 +199,8 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
         }
 
         case AST_BINARY_OP: {
-            const datatype_t Lhs = _analyze_expression(global, variables, expr->data.binary_op.left);
-            const datatype_t Rhs = _analyze_expression(global, variables, expr->data.binary_op.right);
+            const datatype_t Lhs = expr->data.binary_op.left->expr_type;
+            const datatype_t Rhs = expr->data.binary_op.right->expr_type;
             if (expr->data.binary_op.operation == BINARY_OP_ARRAY_INDEX) {
                 if (Lhs.kind != DATATYPE_ARRAY) {
                     ANALYZER_ERROR(expr->position, "Array index: array expected!");
@@ -229,7 +229,7 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
         }
 
         case AST_STRUCT_INITIALIZER_LIST: {
-            const ast_struct_initializer_list_t* Initializer = &expr->data.struct_initializer_list; 
+            ast_struct_initializer_list_t* Initializer = &expr->data.struct_initializer_list; 
             
             // Basic type checking.
             const datatype_t Type = {
@@ -243,31 +243,24 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
             DEBUG_ASSERT(StructDecl->kind == AST_STRUCT_DECLARATION, "?");
 
             // Check that the initializer initializes actual members and do typechecking on the expressions.
+            const struct_layout_t* Layout = StructDecl->data.struct_declaration.layout;
             const size_t InitializerCount = arrlenu(Initializer->fields);
-            const size_t StructMemberCount = arrlenu(StructDecl->data.struct_declaration.members);
+            const size_t StructMemberCount = Layout->member_count;
             for (size_t i = 0; i < InitializerCount; i++) {
                 const char* InitializerField = Initializer->fields[i].name;
 
-                for (size_t j = 0; j < StructMemberCount; j++) {
-                    // Does this initializer match a member?
-                    const char* StructMember = StructDecl->data.struct_declaration.members[i].name;
-                    if (strcmp(InitializerField, StructMember)) {
-                        if (j == StructMemberCount-1) {
-                            ANALYZER_ERROR(expr->position, "Struct does not contain a field called '%s'", InitializerField);
-                        }
-                        continue;
-                    }
-
-                    // Matching field
-                    const datatype_t ExprType = _analyze_expression(global, variables, Initializer->fields[i].expr);
-                    const datatype_t* MemberType = &StructDecl->data.struct_declaration.members[i].type;
-
-                    if (!datatype_cmp(MemberType, &ExprType)) {
-                        ANALYZER_ERROR(Initializer->fields[i].expr->position, "expression not matching type! expected %s!", datatype_to_str(MemberType));
-                    }
-
-                    break;
+                // Does this initializer match a member?
+                const struct_member_t* Member = struct_layout_find_member(Layout, InitializerField);
+                if (!Member) {
+                    ANALYZER_ERROR(expr->position, "Struct does not contain a field called '%s'", InitializerField);
+                }
+
+                // Matching field
+                const datatype_t ExprType = Initializer->fields[i].expr->expr_type;
+                if (!datatype_cmp(Member->type, &ExprType)) {
+                    ANALYZER_ERROR(Initializer->fields[i].expr->position, "expression not matching type! expected %s!", datatype_to_str(Member->type));
                 }
+                Initializer->fields[i].member = Member;
             }
 
             if (InitializerCount != StructMemberCount) {
@@ -285,11 +278,11 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
             }
 
             // Get the type of the first initializer.
-            const datatype_t FirstExprType = _analyze_expression(global, variables, initializer_list[0]);
+            const datatype_t FirstExprType = initializer_list[0]->expr_type;
 
             // And check that every other initializer matches the type of the first.
             for (size_t i = 1; i < InitializerSize; i++) {
-                const datatype_t ExprType = _analyze_expression(global, variables, initializer_list[i]);
+                const datatype_t ExprType = initializer_list[i]->expr_type;
                 if (!datatype_cmp(&FirstExprType, &ExprType)) {
                     ANALYZER_ERROR(initializer_list[i]->position, "Invalid types used in initializer list!");
                 }
@@ -320,7 +313,7 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
             }
 
             // Is castable.
-            const datatype_t ExprType = _analyze_expression(global, variables, cast_expr);
+            const datatype_t ExprType = cast_expr->expr_type;
             if (datatype_cmp(&TargetType, &ExprType)) {
                 return TargetType;
             }
@@ -366,7 +359,7 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
 
         case AST_GET_MEMBER: {
             const ast_get_member_t* GetMember = &expr->data.get_member;
-            const datatype_t ExprType = _analyze_expression(global, variables, GetMember->expr);
+            const datatype_t ExprType = GetMember->expr->expr_type;
             const char* GetMemberName = GetMember->member;
             if (ExprType.kind == DATATYPE_ARRAY) {
                 ANALYZER_ERROR(expr->position, "Structure expected, got an array!");
@@ -384,16 +377,13 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
 
             // Find field type
             DEBUG_ASSERT(Decl->kind == AST_STRUCT_DECLARATION, "?");
-            const size_t MemberCount = arrlenu(Decl->data.struct_declaration.members);
-            for (size_t i = 0; i < MemberCount; i++) {
-                const ast_variable_declaration_t* MemberDecl = &Decl->data.struct_declaration.members[i];
-                if (strcmp(MemberDecl->name, GetMemberName) == 0) {
-                    return MemberDecl->type;
-                }
+            const struct_member_t* Member = struct_layout_find_member(Decl->data.struct_declaration.layout, GetMemberName);
+            if (!Member) {
+                ANALYZER_ERROR(expr->position, "Expression has no member called '%s'!", GetMemberName);
             }
 
-            ANALYZER_ERROR(expr->position, "Expression has no member called '%s'!", GetMemberName);
-            return (datatype_t){ 0 };
+            expr->data.get_member.resolved = Member;
+            return *Member->type;
         }
 
         default: {
@@ -404,102 +394,169 @@ static datatype_t _analyze_expression_impl(global_scope_t* global, const sym_tab
     return (datatype_t){ 0 };
 }
 
-static datatype_t _analyze_expression(global_scope_t* global, const sym_table_t* variables, ast_node_t* expr) {
-    expr->expr_type = _analyze_expression_impl(global, variables, expr);
-    return expr->expr_type;
+typedef struct analyzer_t {
+    global_scope_t* global;
+    sym_table_t** scopes; // innermost is last
+} analyzer_t;
+
+static void _analyzer_push_scope(analyzer_t* analyzer) {
+    sym_table_t* scope = malloc(sizeof(sym_table_t));
+    RUNTIME_ASSERT(scope, "Could not allocate memory for a scope :^(");
+    sym_table_init(scope);
+    scope->parent = arrlenu(analyzer->scopes) ? arrlast(analyzer->scopes) : NULL;
+    arrput(analyzer->scopes, scope);
 }
 
-static void _analyze_scoped_node(ast_node_t* node, global_scope_t* global, sym_table_t* variables) {
-    if (!node) {
-        return;
+static void _analyzer_pop_scope(analyzer_t* analyzer) {
+    sym_table_t* scope = arrpop(analyzer->scopes);
+    sym_table_cleanup(scope);
+    free(scope);
+}
+
+// The scopes an error left open.
+static void _analyzer_free(void* data) {
+    analyzer_t* analyzer = data;
+    while (arrlenu(analyzer->scopes)) {
+        _analyzer_pop_scope(analyzer);
     }
+    arrfree(analyzer->scopes);
+}
 
-    switch (node->kind) {
-        case AST_VARIABLE_DECLARATION: {
-            const char* VarName = node->data.variable_declaration.name;
+static void _analyze_variable_declaration(global_scope_t* global, sym_table_t* variables, ast_node_t* node) {
+    const char* VarName = node->data.variable_declaration.name;
 
-            // Already used?
-            {
-                ast_node_t* var_decl = sym_table_get(variables, VarName);
-                if (var_decl){
-                    ANALYZER_ERROR(node->position, "Variable called '%s' is already defined!", VarName);
-                }
-            }
+    // Already used?
+    {
+        ast_node_t* var_decl = sym_table_get(variables, VarName);
+        if (var_decl){
+            ANALYZER_ERROR(node->position, "Variable called '%s' is already defined!", VarName);
+        }
+    }
 
-            // Has a valid type?
-            const datatype_t* VarType = &node->data.variable_declaration.type;
-            const bool IsTypeValid = _analyze_is_valid_type(global, VarType);
-            if (!IsTypeValid) {
-                const datatype_t* UnderlyingType = datatype_underlying_type(VarType);
-                ANALYZER_ERROR(node->position, "Type '%s' is not defined!", UnderlyingType->typename);
-            }
+    // Has a valid type?
+    const datatype_t* VarType = &node->data.variable_declaration.type;
+    const bool IsTypeValid = _analyze_is_valid_type(global, VarType);
+    if (!IsTypeValid) {
+        const datatype_t* UnderlyingType = datatype_underlying_type(VarType);
+        ANALYZER_ERROR(node->position, "Type '%s' is not defined!", UnderlyingType->typename);
+    }
 
-            // Get type of expression
-            if (node->data.variable_declaration.expr) {
-                datatype_t ExprType = _analyze_expression(global, variables, node->data.variable_declaration.expr);
-                
-                if (!datatype_cmp(VarType, &ExprType)) {
-                    char expr_type_str[0xFF] = { 0 };
-                    strncpy(expr_type_str, datatype_to_str(&ExprType), ARRAY_LEN(expr_type_str));
-                    ANALYZER_ERROR(node->data.variable_declaration.expr->position, "Expression expected type '%s' got '%s'!", datatype_to_str(VarType), expr_type_str);
-                }
-            }
+    // Type of the expression
+    if (node->data.variable_declaration.expr) {
+        const datatype_t ExprType = node->data.variable_declaration.expr->expr_type;
+        
+        if (!datatype_cmp(VarType, &ExprType)) {
+            char expr_type_str[0xFF] = { 0 };
+            strncpy(expr_type_str, datatype_to_str(&ExprType), ARRAY_LEN(expr_type_str));
+            ANALYZER_ERROR(node->data.variable_declaration.expr->position, "Expression expected type '%s' got '%s'!", datatype_to_str(VarType), expr_type_str);
+        }
+    }
 
-            sym_table_insert(variables, VarName, node);
-            break;
+    sym_table_insert(variables, VarName, node);
+}
+
+static bool _is_scoped_body(const ast_visit_t* visit) {
+    if (visit->role != AST_ROLE_BODY && visit->role != AST_ROLE_ELSE_BODY) {
+        return false;
+    }
+    return visit->parent->kind == AST_IF_STATEMENT || visit->parent->kind == AST_WHILE_LOOP || visit->parent->kind == AST_FOR_LOOP;
+}
+
+static ast_visit_result_t _analyze_scoped_node_pre(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    analyzer_t* analyzer = user;
+
+    // Function's scope with the parameters
+    if (node->kind == AST_FUNCTION_DECLARATION) {
+        _analyzer_push_scope(analyzer);
+        sym_table_t* fn_scope = arrlast(analyzer->scopes);
+
+        const size_t Size = arrlenu(node->data.function_declaration.args);
+        for (size_t arg = 0; arg < Size; arg++) {
+            ast_node_t* argument = &node->data.function_declaration.args[arg]; 
+            _analyze_variable_declaration(analyzer->global, fn_scope, argument);
         }
+        return AST_VISIT_CONTINUE;
+    }
 
-        case AST_IF_STATEMENT: {
-            // expr
-            _analyze_expression(global, variables, node->data.if_statement.expr);
+    // Statements
+    if (visit->role == AST_ROLE_BODY || visit->role == AST_ROLE_ELSE_BODY) {
+        // if & else bodies have their own scopes.
+        if (_is_scoped_body(visit) && visit->index == 0) {
+            _analyzer_push_scope(analyzer);
+        }
 
-            sym_table_t if_scope = { 0 };
-            sym_table_init(&if_scope);
-            if_scope.parent = variables;
+        switch (node->kind) {
+            case AST_VARIABLE_DECLARATION:
+            case AST_IF_STATEMENT:
+            case AST_WHILE_LOOP:
+            case AST_FUNCTION_CALL:
+            case AST_RETURN:
+            case AST_UNARY_OP:
+            case AST_BINARY_OP: {
+                break;
+            }
 
-            CALL_ON_BODY(_analyze_scoped_node, node->data.if_statement.body, global, &if_scope);
-            sym_table_clear(&if_scope);
-            CALL_ON_BODY(_analyze_scoped_node, node->data.if_statement.else_body, global, &if_scope);
+            case AST_FOR_LOOP: {
+                const range_t* Range = &node->data.for_loop.iter;
+                if (Range->from < INT32_MIN || Range->from > INT32_MAX || Range->to < INT32_MIN || Range->to > INT32_MAX || Range->step > INT32_MAX) {
+                    ANALYZER_ERROR(node->position, "The range of a for loop has to fit in an 'i32'!");
+                }
 
-            sym_table_cleanup(&if_scope);
-            break;
+                // The iterator is an 'i32' in a scope around the body, popped in post.
+                ast_node_t* iterator = ast_arena_new(analyzer->global->arena, AST_VARIABLE_DECLARATION);
+                iterator->data.variable_declaration.name = node->data.for_loop.identifier;
+                iterator->data.variable_declaration.type = (datatype_t){ .kind = DATATYPE_PRIMITIVE, .typename = "i32" };
+                iterator->position = node->position;
+                _analyzer_push_scope(analyzer);
+                _analyze_variable_declaration(analyzer->global, arrlast(analyzer->scopes), iterator);
+                break;
+            }
+
+            default: {
+                ANALYZER_ERROR(node->position, "Unhandled!");
+                break;
+            }
         }
+    }
 
-        case AST_WHILE_LOOP: {
-            // expr
-            _analyze_expression(global, variables, node->data.while_loop.expr);
+    return AST_VISIT_CONTINUE;
+}
+
+static ast_visit_result_t _analyze_scoped_node_post(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    analyzer_t* analyzer = user;
 
-            sym_table_t loop_scope = { 0 };
-            sym_table_init(&loop_scope);
-            loop_scope.parent = variables;
-            CALL_ON_BODY(_analyze_scoped_node, node->data.while_loop.body, global, &loop_scope);
-            sym_table_cleanup(&loop_scope);
+    switch (node->kind) {
+        case AST_FUNCTION_DECLARATION: {
+            _analyzer_pop_scope(analyzer);
             break;
         }
 
-        case AST_FUNCTION_CALL: {
-            _analyze_func_call(global, variables, node);
+        case AST_VARIABLE_DECLARATION: {
+            _analyze_variable_declaration(analyzer->global, arrlast(analyzer->scopes), node);
             break;
         }
 
+        case AST_IF_STATEMENT:
+        case AST_WHILE_LOOP:
         case AST_RETURN: {
-            if (node->data.expr) {
-                _analyze_expression(global, variables, node->data.expr);
-            }
             break;
         }
 
-        case AST_UNARY_OP:
-        case AST_BINARY_OP: {
-            _analyze_expression(global, variables, node);
+        case AST_FOR_LOOP: {
+            _analyzer_pop_scope(analyzer);
             break;
         }
 
         default: {
-            ANALYZER_ERROR(node->position, "Unhandled!");
+            node->expr_type = _analyze_expression(analyzer->global, arrlast(analyzer->scopes), node);
             break;
         }
     }
+
+    if (_is_scoped_body(visit) && (visit->index + 1) == visit->count) {
+        _analyzer_pop_scope(analyzer);
+    }
+    return AST_VISIT_CONTINUE;
 }
 
 static void _analyze_global_node(ast_node_t* node, global_scope_t* global) {
@@ -535,34 +592,21 @@ static void _analyze_global_node(ast_node_t* node, global_scope_t* global) {
             }
             sym_table_insert(&global->functions, node->data.function_declaration.name, node);
             
-            // Check parameters & add them to the function's scope
-            sym_table_t fn_scope;
-            sym_table_init(&fn_scope);
-            const size_t Size = arrlenu(node->data.function_declaration.args);
-            for (size_t arg = 0; arg < Size; arg++) {
-                ast_node_t* argument = &node->data.function_declaration.args[arg]; 
-                _analyze_scoped_node(argument, global, &fn_scope);
-                sym_table_insert(&fn_scope, argument->data.variable_declaration.name, (void*)argument);
-            }
-
-            // Analyze body
-            CALL_ON_BODY(_analyze_scoped_node, node->data.function_declaration.body, global, &fn_scope);
-            sym_table_cleanup(&fn_scope);
+            // Parameters & body
+            analyzer_t* analyzer = unwind_alloc(sizeof(analyzer_t), _analyzer_free);
+            analyzer->global = global;
+            const ast_visitor_t Visitor = {
+                .pre = _analyze_scoped_node_pre,
+                .post = _analyze_scoped_node_post,
+                .user = analyzer
+            };
+            ast_visit(&node, &Visitor);
+            unwind_free(analyzer);
             break;
         }
 
         case AST_STRUCT_DECLARATION: {
-            const char* StructName = node->data.struct_declaration.name;
-            // Multiple definitions?
-            {
-                ast_node_t* struct_decl = sym_table_get(&global->structs, StructName);
-                if (struct_decl) {
-                    ANALYZER_ERROR(node->position, "Struct '%s' is defined more than once!", StructName);
-                }
-            }
-
-            // Define struct
-            sym_table_insert(&global->structs, StructName, node);
+            // Already defined & laid out by '_analyze_struct_declarations'.
             break;
         }
 
@@ -574,15 +618,96 @@ static void _analyze_global_node(ast_node_t* node, global_scope_t* global) {
     
 }
 
+// Marks a layout which is being computed, used to detect structs which contain themselves.
+static struct_layout_t s_LayoutInProgress = { 0 };
+
+static const struct_layout_t* _analyze_struct_layout(const char* typename, void* user) {
+    global_scope_t* global = user;
+    ast_node_t* node = sym_table_get(&global->structs, typename);
+    if (!node) {
+        return NULL;
+    }
+
+    ast_struct_declaration_t* decl = &node->data.struct_declaration;
+    if (decl->layout == &s_LayoutInProgress) {
+        ANALYZER_ERROR(node->position, "Struct '%s' contains itself!", decl->name);
+    }
+    if (decl->layout) {
+        return decl->layout;
+    }
+
+    // Members must have valid and unique types.
+    const size_t MemberCount = arrlenu(decl->members);
+    for (size_t i = 0; i < MemberCount; i++) {
+        const ast_variable_declaration_t* Member = &decl->members[i];
+        if (!_analyze_is_valid_type(global, &Member->type)) {
+            ANALYZER_ERROR(node->position, "In struct '%s' member '%s' has an undefined type '%s'!", decl->name, Member->name, datatype_underlying_type(&Member->type)->typename);
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(decl->members[j].name, Member->name) == 0) {
+                ANALYZER_ERROR(node->position, "In struct '%s' member '%s' is defined more than once!", decl->name, Member->name);
+            }
+        }
+    }
+
+    decl->layout = &s_LayoutInProgress;
+    decl->layout = struct_layout_new(global->arena, decl, _analyze_struct_layout, global);
+    return decl->layout;
+}
+
+// Defines every struct and computes their layouts once, before any function uses them.
+static void _analyze_struct_declarations(ast_node_t* root, global_scope_t* global) {
+    DEBUG_ASSERT(root->kind == AST_TRANSLATION_UNIT, "?");
+    ast_node_t** body = root->data.translation_unit.body;
+    const size_t Count = arrlenu(body);
+
+    for (size_t i = 0; i < Count; i++) {
+        ast_node_t* node = body[i];
+        if (node->kind != AST_STRUCT_DECLARATION) {
+            continue;
+        }
+
+        const char* StructName = node->data.struct_declaration.name;
+        // Multiple definitions?
+        {
+            ast_node_t* struct_decl = sym_table_get(&global->structs, StructName);
+            if (struct_decl) {
+                ANALYZER_ERROR(node->position, "Struct '%s' is defined more than once!", StructName);
+            }
+        }
+
+        // Define struct
+        node->data.struct_declaration.layout = NULL;
+        sym_table_insert(&global->structs, StructName, node);
+    }
+
+    for (size_t i = 0; i < Count; i++) {
+        if (body[i]->kind == AST_STRUCT_DECLARATION) {
+            _analyze_struct_layout(body[i]->data.struct_declaration.name, global);
+        }
+    }
+}
+
 void semantic_analysis(arena_t* arena, ast_node_t* node) {
     global_scope_t global = { 0 };
     sym_table_init(&global.functions);
     sym_table_init(&global.structs);
     global.arena = arena;
 
-    _analyze_global_node(node, &global);
+    // Catch errors to free the symbol tables, then pass them on to the caller.
+    jmp_buf* previous_jump = g_Jumpluff;
+    jmp_buf jump;
+    const int ExitCode = SETJUMP(jump);
+    if (!ExitCode) {
+        _analyze_struct_declarations(node, &global);
+        _analyze_global_node(node, &global);
+    }
+    g_Jumpluff = previous_jump;
 
     sym_table_cleanup(&global.functions);
     sym_table_cleanup(&global.structs);
+    if (ExitCode) {
+        LONGJUMP(ExitCode);
+    }
 }
 
@@ -0,0 +1,148 @@
+#include <string.h>
+#include <stb/stb_ds.h>
+
+#include "../common/arena.h"
+#include "../common/error.h"
+#include "../common/string.h"
+#include "../parser/ast_type.h"
+#include "struct_layout.h"
+
+#define ALIGN_UP(value, alignment) (((value) + (alignment) - 1) & ~((alignment) - 1))
+
+size_t layout_primitive_size(const char* typename) {
+#define IF_TYPE_RET(s1, ret) if (strcmp(typename, s1) == 0) { return ret; }
+    IF_TYPE_RET("bool", 1);
+    IF_TYPE_RET("char", 1);
+    IF_TYPE_RET("i8", 1);
+    IF_TYPE_RET("u8", 1);
+    IF_TYPE_RET("i16", 2);
+    IF_TYPE_RET("u16", 2);
+    IF_TYPE_RET("i32", 4);
+    IF_TYPE_RET("u32", 4);
+    IF_TYPE_RET("i64", 8);
+    IF_TYPE_RET("u64", 8);
+
+    IF_TYPE_RET("f32", 4);
+    IF_TYPE_RET("f64", 8);
+#undef IF_TYPE_RET
+    return 0;
+}
+
+bool layout_is_value_type(const datatype_t* type) {
+    if (type->kind == DATATYPE_POINTER) {
+        return true;
+    }
+    return type->kind == DATATYPE_PRIMITIVE && layout_primitive_size(type->typename) != 0;
+}
+
+static void _layout_of_type(
+    const datatype_t* type,
+    fn_find_layout find_layout,
+    void* user,
+    size_t* size,
+    size_t* alignment
+) {
+    switch (type->kind) {
+        case DATATYPE_POINTER: {
+            *size = 8;
+            *alignment = 8;
+            return;
+        }
+
+        case DATATYPE_ARRAY: {
+            size_t element_size = 0;
+            _layout_of_type(type->base, find_layout, user, &element_size, alignment);
+            *size = element_size * type->array_size;
+            return;
+        }
+
+        case DATATYPE_PRIMITIVE: {
+            const size_t PrimitiveSize = layout_primitive_size(type->typename);
+            if (PrimitiveSize) {
+                *size = PrimitiveSize;
+                *alignment = PrimitiveSize;
+                return;
+            }
+
+            const struct_layout_t* Inner = find_layout(type->typename, user);
+            RUNTIME_ASSERT(Inner, "no layout for type '%s'", type->typename);
+            *size = Inner->size;
+            *alignment = Inner->alignment;
+            return;
+        }
+
+        default: {
+            UNIMPLEMENTED("Invalid type");
+        }
+    }
+}
+
+struct_layout_t* struct_layout_new(
+    arena_t* arena,
+    const ast_struct_declaration_t* decl,
+    fn_find_layout find_layout,
+    void* user
+) {
+    const size_t MemberCount = arrlenu(decl->members);
+
+    struct_layout_t* layout = arena_alloc_zeroed(arena, sizeof(struct_layout_t));
+    layout->decl = decl;
+    layout->member_count = MemberCount;
+    layout->members = arena_alloc_zeroed(arena, sizeof(struct_member_t) * (MemberCount ? MemberCount : 1));
+    layout->alignment = 1;
+
+    // Keep the load factor at or under 50%.
+    layout->lookup_capacity = 1;
+    while (layout->lookup_capacity < MemberCount * 2) {
+        layout->lookup_capacity <<= 1;
+    }
+    layout->lookup = arena_alloc_zeroed(arena, sizeof(uint32_t) * layout->lookup_capacity);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < MemberCount; i++) {
+        const ast_variable_declaration_t* Decl = &decl->members[i];
+
+        size_t size = 0, alignment = 1;
+        _layout_of_type(&Decl->type, find_layout, user, &size, &alignment);
+        if (alignment == 0) { alignment = 1; }
+
+        offset = ALIGN_UP(offset, alignment);
+        layout->members[i] = (struct_member_t) {
+            .name = Decl->name,
+            .type = &Decl->type,
+            .index = i,
+            .offset = offset,
+            .size = size
+        };
+        offset += size;
+        if (alignment > layout->alignment) {
+            layout->alignment = alignment;
+        }
+
+        // Insert to the lookup, duplicates are reported by the caller.
+        const size_t Mask = layout->lookup_capacity - 1;
+        size_t slot = str_hash(Decl->name) & Mask;
+        while (layout->lookup[slot]) {
+            slot = (slot + 1) & Mask;
+        }
+        layout->lookup[slot] = (uint32_t)(i + 1);
+    }
+    layout->size = ALIGN_UP(offset, layout->alignment);
+
+    return layout;
+}
+
+const struct_member_t* struct_layout_find_member(const struct_layout_t* layout, const char* name) {
+    DEBUG_ASSERT(layout, "layout is null");
+    const size_t Mask = layout->lookup_capacity - 1;
+    size_t slot = str_hash(name) & Mask;
+
+    while (layout->lookup[slot]) {
+        const struct_member_t* Member = &layout->members[layout->lookup[slot] - 1];
+        if (strcmp(Member->name, name) == 0) {
+            return Member;
+        }
+        slot = (slot + 1) & Mask;
+    }
+    return NULL;
+}
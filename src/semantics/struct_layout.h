@@ -0,0 +1,57 @@
+#ifndef MAYO_STRUCT_LAYOUT_H
+#define MAYO_STRUCT_LAYOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Memory layout of a struct, computed once during semantic analysis.
+    Members are laid out in declaration order using natural alignment (same rules QBE uses for aggregate types),
+    so the offsets can be used directly by the backend.
+
+    The member lookup is an open addressing hash table allocated in the arena, so no cleanup is needed.
+*/
+
+struct arena_t;
+struct datatype_t;
+struct ast_struct_declaration_t;
+
+typedef struct struct_member_t {
+    const char* name;
+    const struct datatype_t* type;
+    size_t index;   // index in the declaration
+    size_t offset;  // in bytes from the beginning of the struct
+    size_t size;
+} struct_member_t;
+
+typedef struct struct_layout_t {
+    const struct ast_struct_declaration_t* decl;
+    struct_member_t* members;   // in declaration order
+    size_t member_count;
+
+    uint32_t* lookup;           // hash -> index+1 into members, 0 is an empty slot.
+    size_t lookup_capacity;     // always a power of 2
+
+    size_t size;
+    size_t alignment;
+} struct_layout_t;
+
+// Resolves the layout of a struct member's type, needed for nested structs. Returns NULL if the type does not exist.
+typedef const struct_layout_t* (*fn_find_layout)(const char* typename, void* user);
+
+struct_layout_t* struct_layout_new(
+    struct arena_t* arena,
+    const struct ast_struct_declaration_t* decl,
+    fn_find_layout find_layout,
+    void* user
+);
+const struct_member_t* struct_layout_find_member(const struct_layout_t* layout, const char* name);
+
+// Size & alignment of a builtin type, 0 if the typename is not a builtin.
+size_t layout_primitive_size(const char* typename);
+
+// Pointers & builtin types fit in a temporary, structs & arrays live in memory.
+bool layout_is_value_type(const struct datatype_t* type);
+
+#endif
@@ -49,7 +49,7 @@ static void _impl_datatype_to_str(const datatype_t* datatype, char* buffer, size
 }
 
 const char* datatype_to_str(const datatype_t* datatype) {
-    static char s_DatatypeStr[TYPE_BUFFER_LEN] = { 0 };
+    static _Thread_local char s_DatatypeStr[TYPE_BUFFER_LEN] = { 0 }; // per thread, so concurrent compilers don't share it
     memset(s_DatatypeStr, 0, sizeof(s_DatatypeStr));
     size_t size = 0;
     _impl_datatype_to_str(datatype, s_DatatypeStr, &size);
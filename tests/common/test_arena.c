@@ -1,6 +1,10 @@
 #include <criterion/criterion.h>
 
+#include <stdalign.h>
+#include <stb/stb_ds.h>
+
 #include "common/arena.h"
+#include "common/arena_pool.h"
 #include "criterion/internal/assert.h"
 
 /*
@@ -107,3 +111,106 @@ Test(arena_tests, arena_overflow) {
 
     arena_free(&arena);
 }
+
+Test(arena_tests, arena_from_pool) {
+    arena_block_pool_t pool;
+    arena_block_pool_init(&pool, 256);
+
+    {
+        arena_t arena;
+        arena_init_from_pool(&arena, &pool);
+        cr_expect(arena.capacity == 256);
+
+        // Overflows into more pooled blocks, bigger allocations get their own.
+        for (int i = 0; i < 16; i++) {
+            int64_t* n = arena_alloc(&arena, sizeof(int64_t) * 8);
+            n[7] = i;
+        }
+        char* big = arena_alloc_zeroed(&arena, 1024);
+        cr_expect(big[1023] == 0);
+        arena_free(&arena);
+    }
+
+    // Freed blocks are reused.
+    const size_t BlockCount = pool.block_count;
+    cr_expect(arrlenu(pool.free_blocks) == BlockCount);
+    {
+        arena_t arena;
+        arena_init_from_pool(&arena, &pool);
+        arena_alloc(&arena, 100);
+        cr_expect(pool.block_count == BlockCount);
+        arena_free(&arena);
+    }
+
+    arena_block_pool_cleanup(&pool);
+}
+
+Test(arena_tests, arena_adopt) {
+    arena_t arena = arena_new(32);
+    arena_t worker = arena_new(32);
+
+    int32_t* a = arena_alloc(&arena, sizeof(int32_t));
+    *a = 1;
+    int32_t* b = arena_alloc(&worker, sizeof(int32_t));
+    *b = 2;
+    char* c = arena_alloc(&worker, 64); // overflows to a child
+    strcpy(c, "adopted");
+
+    arena_adopt(&arena, &worker);
+    cr_expect(worker.data == NULL);
+    cr_expect(*a == 1);
+    cr_expect(*b == 2);
+    cr_expect_str_eq(c, "adopted");
+
+    // Still usable after adopting.
+    int32_t* d = arena_alloc(&arena, sizeof(int32_t));
+    *d = 3;
+    cr_expect(*d == 3);
+
+    arena_free(&arena);
+}
+
+#define CONCURRENT_THREAD_COUNT 4
+#define CONCURRENT_ALLOC_COUNT 10000
+
+static int _concurrent_alloc(void* user) {
+    concurrent_arena_t* arena = user;
+    uintptr_t** ptrs = malloc(sizeof(uintptr_t*) * CONCURRENT_ALLOC_COUNT);
+    for (size_t i = 0; i < CONCURRENT_ALLOC_COUNT; i++) {
+        ptrs[i] = concurrent_arena_alloc(arena, sizeof(uintptr_t) * (1 + i % 4));
+        ptrs[i][0] = (uintptr_t)ptrs[i];
+    }
+
+    // Nobody else wrote over them.
+    int overwritten = 0;
+    for (size_t i = 0; i < CONCURRENT_ALLOC_COUNT; i++) {
+        overwritten += ptrs[i][0] != (uintptr_t)ptrs[i];
+        overwritten += ((uintptr_t)ptrs[i] % alignof(max_align_t)) != 0;
+    }
+    free(ptrs);
+    return overwritten;
+}
+
+Test(arena_tests, concurrent_arena) {
+    arena_block_pool_t pool;
+    arena_block_pool_init(&pool, 1024);
+    concurrent_arena_t arena;
+    concurrent_arena_init(&arena, &pool, 0);
+
+    thrd_t threads[CONCURRENT_THREAD_COUNT];
+    for (int i = 0; i < CONCURRENT_THREAD_COUNT; i++) {
+        cr_assert(thrd_create(&threads[i], _concurrent_alloc, &arena) == thrd_success);
+    }
+    for (int i = 0; i < CONCURRENT_THREAD_COUNT; i++) {
+        int overwritten = -1;
+        thrd_join(threads[i], &overwritten);
+        cr_expect(overwritten == 0);
+    }
+
+    // Larger than a block
+    char* big = concurrent_arena_alloc_zeroed(&arena, 4096);
+    cr_expect(big[4095] == 0);
+
+    concurrent_arena_free(&arena);
+    arena_block_pool_cleanup(&pool);
+}
@@ -0,0 +1,52 @@
+#include <criterion/criterion.h>
+
+#include "common/error.h"
+
+static int s_Cleanups = 0;
+
+static void _count_cleanup(void* data) {
+    UNUSED(data);
+    s_Cleanups++;
+}
+
+Test(error_tests, unwind_frees_what_an_error_left) {
+    s_Cleanups = 0;
+    unwind_list_t list = { 0 };
+    unwind_list_t* previous_unwind = g_Unwind;
+    g_Unwind = &list;
+
+    // Given back by its user, so it's not in the list anymore.
+    int* returned = unwind_alloc(sizeof(int), _count_cleanup);
+    cr_expect_eq(*returned, 0);
+    unwind_free(returned);
+    cr_expect_eq(s_Cleanups, 1);
+    cr_expect_null(list.last);
+
+    jmp_buf* previous_jump = g_Jumpluff;
+    jmp_buf jump;
+    const int ExitCode = SETJUMP(jump);
+    if (!ExitCode) {
+        unwind_alloc(sizeof(int), _count_cleanup);
+        unwind_alloc(64, NULL);
+        LONGJUMP(EXIT_FAILURE);
+    }
+    g_Jumpluff = previous_jump;
+
+    cr_expect_eq(ExitCode, EXIT_FAILURE);
+    cr_expect_not_null(list.last);
+    unwind_free_all(&list);
+    cr_expect_eq(s_Cleanups, 2);
+    cr_expect_null(list.last);
+    g_Unwind = previous_unwind;
+}
+
+Test(error_tests, unwind_without_a_list) {
+    // e.g. a pass called directly, without a compiler.
+    unwind_list_t* previous_unwind = g_Unwind;
+    g_Unwind = NULL;
+    s_Cleanups = 0;
+    int* value = unwind_alloc(sizeof(int), _count_cleanup);
+    unwind_free(value);
+    cr_expect_eq(s_Cleanups, 1);
+    g_Unwind = previous_unwind;
+}
@@ -0,0 +1,114 @@
+#include <criterion/criterion.h>
+#include <stdatomic.h>
+
+#include "common/thread_pool.h"
+
+#define TASK_COUNT 10000
+
+static void _add_one(void* user) {
+    atomic_size_t* counter = user;
+    atomic_fetch_add(counter, 1);
+}
+
+Test(thread_pool_tests, runs_every_task) {
+    thread_pool_t pool;
+    thread_pool_init(&pool, 4);
+
+    atomic_size_t counter;
+    atomic_init(&counter, 0);
+
+    task_group_t group;
+    task_group_init(&group, &pool);
+    for (size_t i = 0; i < TASK_COUNT; i++) {
+        task_group_spawn(&group, _add_one, &counter);
+    }
+    task_group_wait(&group);
+    cr_expect_eq(atomic_load(&counter), TASK_COUNT);
+
+    // Groups can be reused after waiting.
+    for (size_t i = 0; i < TASK_COUNT; i++) {
+        task_group_spawn(&group, _add_one, &counter);
+    }
+    task_group_wait(&group);
+    cr_expect_eq(atomic_load(&counter), TASK_COUNT * 2);
+
+    thread_pool_cleanup(&pool);
+}
+
+typedef struct fib_job_t {
+    thread_pool_t* pool;
+    int n;
+    long result;
+} fib_job_t;
+
+static void _fib(void* user) {
+    fib_job_t* job = user;
+    if (job->n < 2) {
+        job->result = job->n;
+        return;
+    }
+
+    // Waits inside of tasks must not deadlock.
+    fib_job_t a = { .pool = job->pool, .n = job->n - 1 };
+    fib_job_t b = { .pool = job->pool, .n = job->n - 2 };
+    task_group_t group;
+    task_group_init(&group, job->pool);
+    task_group_spawn(&group, _fib, &a);
+    task_group_spawn(&group, _fib, &b);
+    task_group_wait(&group);
+    job->result = a.result + b.result;
+}
+
+Test(thread_pool_tests, nested_groups) {
+    const size_t WorkerCounts[] = { 0, 1, 4 };
+    for (size_t i = 0; i < sizeof(WorkerCounts) / sizeof(WorkerCounts[0]); i++) {
+        thread_pool_t pool;
+        thread_pool_init(&pool, WorkerCounts[i]);
+
+        fib_job_t job = { .pool = &pool, .n = 20 };
+        task_group_t group;
+        task_group_init(&group, &pool);
+        task_group_spawn(&group, _fib, &job);
+        task_group_wait(&group);
+        cr_expect_eq(job.result, 6765);
+
+        thread_pool_cleanup(&pool);
+    }
+}
+
+typedef struct order_t {
+    int order[8];
+    int count;
+} order_t;
+
+typedef struct order_job_t {
+    order_t* order;
+    int id;
+} order_job_t;
+
+static void _record_order(void* user) {
+    order_job_t* job = user;
+    job->order->order[job->order->count++] = job->id;
+}
+
+Test(thread_pool_tests, serial_is_deterministic) {
+    thread_pool_t pool;
+    thread_pool_init(&pool, 0);
+    cr_expect(thread_pool_is_serial(&pool));
+
+    order_t order = { 0 };
+    order_job_t jobs[8];
+    task_group_t group;
+    task_group_init(&group, &pool);
+    for (int i = 0; i < 8; i++) {
+        jobs[i] = (order_job_t) { .order = &order, .id = i };
+        task_group_spawn(&group, _record_order, &jobs[i]);
+    }
+    task_group_wait(&group);
+
+    cr_assert_eq(order.count, 8);
+    for (int i = 0; i < 8; i++) {
+        cr_expect_eq(order.order[i], i);
+    }
+    thread_pool_cleanup(&pool);
+}
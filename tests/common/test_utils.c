@@ -1,4 +1,5 @@
 #include <criterion/criterion.h>
+#include <stb/stb_ds.h>
 #include "common/utils.h"
 
 #define expect_digits(eval, expect) { \
@@ -27,3 +28,15 @@ Test(utils_tests, count_digits) {
     expect_digits(54362, 5);
     expect_digits(889245, 6);
 }
+
+Test(utils_tests, str_array_contains) {
+    const char** names = NULL;
+    cr_expect_not(str_array_contains(names, "a"));
+
+    arrput(names, "a");
+    arrput(names, "bc");
+    cr_expect(str_array_contains(names, "a"));
+    cr_expect(str_array_contains(names, "bc"));
+    cr_expect_not(str_array_contains(names, "b"));
+    arrfree(names);
+}
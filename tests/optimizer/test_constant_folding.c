@@ -0,0 +1,166 @@
+#include <criterion/criterion.h>
+#include <stb/stb_ds.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantics.h"
+#include "cli/cli.h"
+#include "optimizer/optimize.h"
+#include "common/arena.h"
+
+#define INITIALIZE_OPTIMIZER(code)                  \
+    arena_t arena; lexer_t lexer;                   \
+    arena_init(&arena, 0xFF);                       \
+    lexer_str(&lexer, &arena, code, NULL);          \
+    lexer_lex(&lexer);                              \
+    parser_t parser = parser_new(&arena, &lexer);   \
+    parser_parse(&parser);                          \
+    semantic_analysis(&arena, parser.node_root);    \
+    const program_params_t Params = { .opt_ast_constant_folding = true }; \
+    perform_ast_optimizations(&arena, parser.node_root, &Params)
+
+#define CLEANUP_OPTIMIZER()     \
+    parser_cleanup(&parser);    \
+    lexer_cleanup(&lexer);      \
+    arena_free(&arena)
+
+// Expression returned by the first statement of the function.
+static const ast_node_t* _returned_expr(const ast_node_t* root, const char* fn_name) {
+    ast_node_t** body = root->data.translation_unit.body;
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (body[i]->kind == AST_FUNCTION_DECLARATION && strcmp(body[i]->data.function_declaration.name, fn_name) == 0) {
+            return body[i]->data.function_declaration.body[0]->data.expr;
+        }
+    }
+    return NULL;
+}
+
+Test(constant_folding_tests, integer_arithmetic) {
+    char* code = "fn main() -> i32 { return (2 + 3) * 4 - (20 / 3) % 4; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* expr = _returned_expr(parser.node_root, "main");
+    cr_assert_eq(expr->kind, AST_INTEGER_LITERAL);
+    cr_expect_eq(expr->data.integer, 18);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(constant_folding_tests, wraps_to_type) {
+    char* code =
+        "fn a() -> u8 { return cast<u8>(200) + cast<u8>(100); }"
+        "fn main() -> i32 { return 2147483647 + 1; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* u8_expr = _returned_expr(parser.node_root, "a");
+    cr_assert_eq(u8_expr->kind, AST_INTEGER_LITERAL);
+    cr_expect_eq(u8_expr->data.integer, 44);
+
+    const ast_node_t* i32_expr = _returned_expr(parser.node_root, "main");
+    cr_assert_eq(i32_expr->kind, AST_INTEGER_LITERAL);
+    cr_expect_eq(i32_expr->data.integer, INT32_MIN);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(constant_folding_tests, comparisons_and_bools) {
+    char* code =
+        "fn a() -> bool { return (3 < 4) == ((-1 > 2) == false); }"
+        "fn main() -> i32 { return 0; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* expr = _returned_expr(parser.node_root, "a");
+    cr_assert_eq(expr->kind, AST_BOOL_LITERAL);
+    cr_expect_eq(expr->data.boolean, true);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(constant_folding_tests, division_by_zero_is_kept) {
+    char* code = "fn main() -> i32 { return 1 / 0; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* expr = _returned_expr(parser.node_root, "main");
+    cr_expect_eq(expr->kind, AST_BINARY_OP);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(constant_folding_tests, algebraic_identities) {
+    char* code =
+        "fn a(x: i32) -> i32 { return (0 + x * 1) / 1 - 0; }"
+        "fn b(x: i32) -> i32 { return x - x; }"
+        "fn c(x: i32) -> i32 { return x * 8; }"
+        "fn main() -> i32 { return 0; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* a = _returned_expr(parser.node_root, "a");
+    cr_assert_eq(a->kind, AST_GET_VARIABLE);
+    cr_expect_str_eq(a->data.literal, "x");
+
+    const ast_node_t* b = _returned_expr(parser.node_root, "b");
+    cr_assert_eq(b->kind, AST_INTEGER_LITERAL);
+    cr_expect_eq(b->data.integer, 0);
+
+    const ast_node_t* c = _returned_expr(parser.node_root, "c");
+    cr_assert_eq(c->kind, AST_BINARY_OP);
+    cr_expect_eq(c->data.binary_op.operation, BINARY_OP_SHIFT_LEFT);
+    cr_expect_eq(c->data.binary_op.right->data.integer, 3);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(constant_folding_tests, side_effects_are_kept) {
+    char* code =
+        "fn f() -> i32 { return 1; }"
+        "fn main() -> i32 { return f() * 0; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* expr = _returned_expr(parser.node_root, "main");
+    cr_expect_eq(expr->kind, AST_BINARY_OP);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(constant_folding_tests, short_circuits_skip_the_right_side) {
+    char* code =
+        "extern fn puts(str: char*) -> i32;"
+        "fn noisy(b: bool) -> bool { puts(\"noisy\"); return b; }"
+        "fn a() -> bool { return false && noisy(true); }"
+        "fn b() -> bool { return true || noisy(false); }"
+        "fn c() -> bool { return true && noisy(true); }"
+        "fn d() -> bool { return false || noisy(false); }"
+        "fn main() -> i32 { return 0; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* a = _returned_expr(parser.node_root, "a");
+    cr_assert_eq(a->kind, AST_BOOL_LITERAL);
+    cr_expect_eq(a->data.boolean, false);
+
+    const ast_node_t* b = _returned_expr(parser.node_root, "b");
+    cr_assert_eq(b->kind, AST_BOOL_LITERAL);
+    cr_expect_eq(b->data.boolean, true);
+
+    cr_expect_eq(_returned_expr(parser.node_root, "c")->kind, AST_FUNCTION_CALL);
+    cr_expect_eq(_returned_expr(parser.node_root, "d")->kind, AST_FUNCTION_CALL);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(constant_folding_tests, casts) {
+    char* code =
+        "fn a(x: i32) -> i32 { return cast<i32>(x); }"
+        "fn b() -> i64 { return cast<i64>(cast<i32>(cast<u8>(300))); }"
+        "fn main() -> i32 { return 0; }";
+    INITIALIZE_OPTIMIZER(code);
+
+    const ast_node_t* a = _returned_expr(parser.node_root, "a");
+    cr_expect_eq(a->kind, AST_GET_VARIABLE);
+
+    const ast_node_t* expr = _returned_expr(parser.node_root, "b");
+    cr_assert_eq(expr->kind, AST_INTEGER_LITERAL);
+    cr_expect_eq(expr->data.integer, 44);
+    cr_expect_str_eq(expr->expr_type.typename, "i64");
+
+    CLEANUP_OPTIMIZER();
+}
@@ -0,0 +1,92 @@
+#include <criterion/criterion.h>
+#include <stb/stb_ds.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantics.h"
+#include "cli/cli.h"
+#include "optimizer/optimize.h"
+#include "common/arena.h"
+
+#define INITIALIZE_OPTIMIZER(code)                  \
+    arena_t arena; lexer_t lexer;                   \
+    arena_init(&arena, 0xFF);                       \
+    lexer_str(&lexer, &arena, code, NULL);          \
+    lexer_lex(&lexer);                              \
+    parser_t parser = parser_new(&arena, &lexer);   \
+    parser_parse(&parser);                          \
+    semantic_analysis(&arena, parser.node_root);    \
+    const program_params_t Params = { .opt_ast_constant_folding = true, .opt_ast_dead_code = true }; \
+    perform_ast_optimizations(&arena, parser.node_root, &Params)
+
+#define CLEANUP_OPTIMIZER()     \
+    parser_cleanup(&parser);    \
+    lexer_cleanup(&lexer);      \
+    arena_free(&arena)
+
+static ast_node_t** _function_body(const ast_node_t* root, const char* fn_name) {
+    ast_node_t** body = root->data.translation_unit.body;
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (body[i]->kind == AST_FUNCTION_DECLARATION && strcmp(body[i]->data.function_declaration.name, fn_name) == 0) {
+            return body[i]->data.function_declaration.body;
+        }
+    }
+    return NULL;
+}
+
+Test(dead_code_tests, after_return) {
+    char* code =
+        "fn main() -> i32 {\n"
+        "    let x: i32 = 1;\n"
+        "    return x;\n"
+        "    x = 2;\n"
+        "    return 3;\n"
+        "}\n";
+    INITIALIZE_OPTIMIZER(code);
+
+    ast_node_t** body = _function_body(parser.node_root, "main");
+    cr_assert_eq(arrlenu(body), 2);
+    cr_expect_eq(body[1]->kind, AST_RETURN);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(dead_code_tests, constant_conditions) {
+    char* code =
+        "fn main() -> i32 {\n"
+        "    let x: i32 = 0;\n"
+        "    while 1 > 2 { x = x + 1; }\n"
+        "    if false { x = 1; } else { x = 2; }\n"
+        "    if 1 == 1 { return x; }\n"
+        "    return 5;\n"
+        "}\n";
+    INITIALIZE_OPTIMIZER(code);
+
+    // let, x = 2, return x
+    ast_node_t** body = _function_body(parser.node_root, "main");
+    cr_assert_eq(arrlenu(body), 3);
+    cr_expect_eq(body[0]->kind, AST_VARIABLE_DECLARATION);
+    cr_assert_eq(body[1]->kind, AST_BINARY_OP);
+    cr_expect_eq(body[1]->data.binary_op.right->data.integer, 2);
+    cr_expect_eq(body[2]->kind, AST_RETURN);
+    cr_expect_eq(body[2]->data.expr->kind, AST_GET_VARIABLE);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(dead_code_tests, nested_terminators) {
+    char* code =
+        "fn f(x: i32) -> i32 {\n"
+        "    if x > 0 { return 1; } else { return 2; x = 3; }\n"
+        "    return 4;\n"
+        "}\n"
+        "fn main() -> i32 { return 0; }\n";
+    INITIALIZE_OPTIMIZER(code);
+
+    ast_node_t** body = _function_body(parser.node_root, "f");
+    cr_assert_eq(arrlenu(body), 1);
+    cr_assert_eq(body[0]->kind, AST_IF_STATEMENT);
+    cr_expect_eq(arrlenu(body[0]->data.if_statement.else_body), 1);
+
+    CLEANUP_OPTIMIZER();
+}
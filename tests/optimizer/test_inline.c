@@ -0,0 +1,139 @@
+#include <criterion/criterion.h>
+#include <stb/stb_ds.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantics.h"
+#include "cli/cli.h"
+#include "optimizer/optimize.h"
+#include "parser/ast_visit.h"
+#include "common/arena.h"
+
+#define INITIALIZE_OPTIMIZER(code, ...)             \
+    arena_t arena; lexer_t lexer;                   \
+    arena_init(&arena, 0xFF);                       \
+    lexer_str(&lexer, &arena, code, NULL);          \
+    lexer_lex(&lexer);                              \
+    parser_t parser = parser_new(&arena, &lexer);   \
+    parser_parse(&parser);                          \
+    semantic_analysis(&arena, parser.node_root);    \
+    const program_params_t Params = { __VA_ARGS__ }; \
+    perform_ast_optimizations(&arena, parser.node_root, &Params)
+
+#define CLEANUP_OPTIMIZER()     \
+    parser_cleanup(&parser);    \
+    lexer_cleanup(&lexer);      \
+    arena_free(&arena)
+
+static ast_node_t* _find_function(const ast_node_t* root, const char* fn_name) {
+    ast_node_t** body = root->data.translation_unit.body;
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (body[i]->kind == AST_FUNCTION_DECLARATION && strcmp(body[i]->data.function_declaration.name, fn_name) == 0) {
+            return body[i];
+        }
+    }
+    return NULL;
+}
+
+static ast_visit_result_t _count_call(ast_node_t* ast, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    if (ast->kind == AST_FUNCTION_CALL) {
+        (*(size_t*)user)++;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+static size_t _call_count(const ast_node_t* root, const char* fn_name) {
+    size_t count = 0;
+    ast_node_t* fn = _find_function(root, fn_name);
+    const ast_visitor_t Visitor = { .pre = _count_call, .user = &count };
+    ast_visit(&fn, &Visitor);
+    return count;
+}
+
+Test(inline_tests, small_functions) {
+    char* code =
+        "fn sq(x: i32) -> i32 { return x * x; }\n"
+        "fn add(a: i32, b: i32) -> i32 { let s: i32 = a + b; a = 0; return s; }\n"
+        "fn main() -> i32 {\n"
+        "    let i: i32 = 0;\n"
+        "    while i < 10 { i = add(i, sq(2)); }\n"
+        "    return add(sq(i), i);\n"
+        "}\n";
+    INITIALIZE_OPTIMIZER(code, .opt_ast_inline = true);
+
+    cr_expect_eq(_call_count(parser.node_root, "main"), 0);
+
+    // The callee's variables are renamed, 'a = 0' doesn't touch the caller's 'i'.
+    ast_node_t** body = _find_function(parser.node_root, "main")->data.function_declaration.body;
+    const ast_node_t* Ret = arrlast(body);
+    cr_assert_eq(Ret->kind, AST_RETURN);
+    cr_assert_eq(Ret->data.expr->kind, AST_GET_VARIABLE);
+    cr_expect_str_neq(Ret->data.expr->data.literal, "s");
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(inline_tests, array_parameters_are_not_copied) {
+    char* code =
+        "fn bump(a: i32[3]) -> i32 { a[0] = 99; return a[1]; }\n"
+        "fn main() -> i32 {\n"
+        "    let arr: i32[3] = [1, 2, 3];\n"
+        "    bump(arr);\n"
+        "    return arr[0];\n"
+        "}\n";
+    INITIALIZE_OPTIMIZER(code, .opt_ast_inline = true);
+
+    // Binding 'a' with a 'let' would copy the array, the write has to reach the caller's.
+    cr_expect_eq(_call_count(parser.node_root, "main"), 1);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(inline_tests, recursion_and_threshold) {
+    char* code =
+        "fn fact(n: i32) -> i32 { if n < 2 { return 1; } return n * fact(n - 1); }\n"
+        "fn big(x: i32) -> i32 { let a: i32 = x * 2 + x * 3 + x * 4; return a * a + a; }\n"
+        "fn main() -> i32 { return fact(5) + big(2); }\n";
+    INITIALIZE_OPTIMIZER(code, .opt_ast_inline = true, .opt_inline_threshold = 4);
+
+    cr_expect_eq(_call_count(parser.node_root, "main"), 2);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(inline_tests, inline_keyword) {
+    char* code =
+        "inline fn big(x: i32) -> i32 { let a: i32 = x * 2 + x * 3 + x * 4; return a * a + a; }\n"
+        "fn other(x: i32) -> i32 { return x; }\n"
+        "fn main() -> i32 { return big(2) + other(1); }\n";
+
+    // 'inline' functions are inlined even without '--finline'.
+    INITIALIZE_OPTIMIZER(code, .opt_ast_inline = false);
+
+    cr_expect(_find_function(parser.node_root, "big")->data.function_declaration.inline_hint);
+    cr_expect_not(_find_function(parser.node_root, "other")->data.function_declaration.inline_hint);
+    cr_expect_eq(_call_count(parser.node_root, "main"), 1);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(inline_tests, side_effects_keep_their_order) {
+    char* code =
+        "extern fn side() -> i32;\n"
+        "fn f(a: i32) -> i32 { return a + side(); }\n"
+        "fn main() -> i32 {\n"
+        "    let x: i32 = 1;\n"
+        "    x = side() + f(x);\n"
+        "    return f(x);\n"
+        "}\n";
+    INITIALIZE_OPTIMIZER(code, .opt_ast_inline = true);
+
+    // 'side()' has to be called before 'f', only the call in the return can be inlined.
+    ast_node_t** body = _find_function(parser.node_root, "main")->data.function_declaration.body;
+    cr_assert_eq(body[1]->kind, AST_BINARY_OP);
+    cr_expect_eq(body[1]->data.binary_op.right->data.binary_op.right->kind, AST_FUNCTION_CALL);
+    cr_expect_eq(_call_count(parser.node_root, "main"), 3);
+
+    CLEANUP_OPTIMIZER();
+}
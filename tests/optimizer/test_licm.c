@@ -0,0 +1,114 @@
+#include <criterion/criterion.h>
+#include <stb/stb_ds.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantics.h"
+#include "cli/cli.h"
+#include "optimizer/optimize.h"
+#include "common/arena.h"
+
+#define INITIALIZE_OPTIMIZER(code)                  \
+    arena_t arena; lexer_t lexer;                   \
+    arena_init(&arena, 0xFF);                       \
+    lexer_str(&lexer, &arena, code, NULL);          \
+    lexer_lex(&lexer);                              \
+    parser_t parser = parser_new(&arena, &lexer);   \
+    parser_parse(&parser);                          \
+    semantic_analysis(&arena, parser.node_root);    \
+    const program_params_t Params = { .opt_ast_licm = true }; \
+    perform_ast_optimizations(&arena, parser.node_root, &Params)
+
+#define CLEANUP_OPTIMIZER()     \
+    parser_cleanup(&parser);    \
+    lexer_cleanup(&lexer);      \
+    arena_free(&arena)
+
+static ast_node_t** _function_body(const ast_node_t* root, const char* fn_name) {
+    ast_node_t** body = root->data.translation_unit.body;
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (body[i]->kind == AST_FUNCTION_DECLARATION && strcmp(body[i]->data.function_declaration.name, fn_name) == 0) {
+            return body[i]->data.function_declaration.body;
+        }
+    }
+    return NULL;
+}
+
+Test(licm_tests, hoists_invariant_expressions) {
+    char* code =
+        "fn main() -> i32 {\n"
+        "    let n: i32 = 10;\n"
+        "    let i: i32 = 0;\n"
+        "    let sum: i32 = 0;\n"
+        "    while i < (n * 4) {\n"
+        "        sum = sum + (n - 1) + i;\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return sum;\n"
+        "}\n";
+    INITIALIZE_OPTIMIZER(code);
+
+    ast_node_t** body = _function_body(parser.node_root, "main");
+    cr_assert_eq(arrlenu(body), 7);
+    cr_expect_eq(body[3]->kind, AST_VARIABLE_DECLARATION);
+    cr_expect_eq(body[4]->kind, AST_VARIABLE_DECLARATION);
+    cr_assert_eq(body[5]->kind, AST_WHILE_LOOP);
+
+    // 'i < licm.0'
+    const ast_node_t* Condition = body[5]->data.while_loop.expr;
+    cr_assert_eq(Condition->data.binary_op.right->kind, AST_GET_VARIABLE);
+    cr_expect_str_eq(Condition->data.binary_op.right->data.literal, body[3]->data.variable_declaration.name);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(licm_tests, keeps_loads_through_pointer_members) {
+    char* code =
+        "struct P { x: i32 }\n"
+        "struct H { p: P* }\n"
+        "fn sum(h: H, n: i32) -> i32 {\n"
+        "    let i: i32 = 0;\n"
+        "    let s: i32 = 0;\n"
+        "    while i < (n) {\n"
+        "        s = s + h.p.x;\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return s;\n"
+        "}\n"
+        "fn main() -> i32 { return 0; }\n";
+    INITIALIZE_OPTIMIZER(code);
+
+    // Only 'h.p' itself, it may be null when the loop doesn't run & is only dereferenced in it.
+    ast_node_t** body = _function_body(parser.node_root, "sum");
+    cr_assert_eq(arrlenu(body), 5);
+    cr_assert_eq(body[2]->kind, AST_VARIABLE_DECLARATION);
+    cr_expect_eq(body[2]->data.variable_declaration.type.kind, DATATYPE_POINTER);
+    cr_expect_eq(body[3]->kind, AST_WHILE_LOOP);
+
+    CLEANUP_OPTIMIZER();
+}
+
+Test(licm_tests, keeps_variant_expressions) {
+    char* code =
+        "struct P { x: i32 }\n"
+        "fn main() -> i32 {\n"
+        "    let p: P = P { x: 1 };\n"
+        "    let i: i32 = 0;\n"
+        "    let k: i32 = 2;\n"
+        "    while i < 10 {\n"
+        "        let t: i32 = i * 2;\n"
+        "        p.x = p.x + t * k;\n"
+        "        k = k + 1;\n"
+        "        i = i + (10 / 0);\n"
+        "    }\n"
+        "    return p.x;\n"
+        "}\n";
+    INITIALIZE_OPTIMIZER(code);
+
+    // Everything reads an assigned variable or memory which is stored to, and the division could trap.
+    ast_node_t** body = _function_body(parser.node_root, "main");
+    cr_assert_eq(arrlenu(body), 5);
+    cr_expect_eq(body[3]->kind, AST_WHILE_LOOP);
+
+    CLEANUP_OPTIMIZER();
+}
@@ -0,0 +1,150 @@
+#include <criterion/criterion.h>
+#include <stb/stb_ds.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "parser/ast_visit.h"
+#include "common/arena.h"
+
+#define CODE(code) #code
+
+#define INITIALIZE_PARSER(code)                     \
+    arena_t arena; lexer_t lexer;                   \
+    arena_init(&arena, 0xFF);                       \
+    lexer_str(&lexer, &arena, code, NULL);          \
+    lexer_lex(&lexer);                              \
+    parser_t parser = parser_new(&arena, &lexer);   \
+    parser_parse(&parser)
+
+#define CLEANUP_PARSER()        \
+    parser_cleanup(&parser);    \
+    lexer_cleanup(&lexer);      \
+    arena_free(&arena)
+
+typedef struct visit_log_t {
+    ast_kind_t* pre;
+    ast_kind_t* post;
+    size_t max_depth;
+} visit_log_t;
+
+static ast_visit_result_t _log_pre(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    visit_log_t* log = user;
+    arrput(log->pre, node->kind);
+    if (visit->depth > log->max_depth) {
+        log->max_depth = visit->depth;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+static ast_visit_result_t _log_post(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    (void)visit;
+    visit_log_t* log = user;
+    arrput(log->post, node->kind);
+    return AST_VISIT_CONTINUE;
+}
+
+Test(ast_visit_tests, pre_and_post_order) {
+    char* code = CODE(
+        fn main() -> i32 { return 1 + 2; }
+    );
+    INITIALIZE_PARSER(code);
+
+    visit_log_t log = { 0 };
+    const ast_visitor_t Visitor = { .pre = _log_pre, .post = _log_post, .user = &log };
+    cr_expect(ast_visit(&parser.node_root, &Visitor));
+
+    const ast_kind_t ExpectedPre[] = {
+        AST_TRANSLATION_UNIT, AST_FUNCTION_DECLARATION, AST_RETURN, AST_BINARY_OP, AST_INTEGER_LITERAL, AST_INTEGER_LITERAL
+    };
+    const ast_kind_t ExpectedPost[] = {
+        AST_INTEGER_LITERAL, AST_INTEGER_LITERAL, AST_BINARY_OP, AST_RETURN, AST_FUNCTION_DECLARATION, AST_TRANSLATION_UNIT
+    };
+    cr_assert_eq(arrlenu(log.pre), 6);
+    cr_assert_eq(arrlenu(log.post), 6);
+    for (size_t i = 0; i < 6; i++) {
+        cr_expect_eq(log.pre[i], ExpectedPre[i]);
+        cr_expect_eq(log.post[i], ExpectedPost[i]);
+    }
+    cr_expect_eq(log.max_depth, 4);
+
+    arrfree(log.pre);
+    arrfree(log.post);
+    CLEANUP_PARSER();
+}
+
+static ast_visit_result_t _skip_binary_ops(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    _log_pre(node, visit, user);
+    return node->kind == AST_BINARY_OP ? AST_VISIT_SKIP : AST_VISIT_CONTINUE;
+}
+
+Test(ast_visit_tests, skip_children) {
+    char* code = CODE(
+        fn main() -> i32 { return 1 + 2; }
+    );
+    INITIALIZE_PARSER(code);
+
+    visit_log_t log = { 0 };
+    const ast_visitor_t Visitor = { .pre = _skip_binary_ops, .post = _log_post, .user = &log };
+    ast_visit(&parser.node_root, &Visitor);
+
+    // Literals are not visited, but 'post' is still called for the skipped node.
+    cr_expect_eq(arrlenu(log.pre), 4);
+    cr_expect_eq(arrlenu(log.post), 4);
+    cr_expect_eq(log.post[0], AST_BINARY_OP);
+
+    arrfree(log.pre);
+    arrfree(log.post);
+    CLEANUP_PARSER();
+}
+
+static ast_visit_result_t _replace_literals(ast_node_t* node, const ast_visit_t* visit, void* user) {
+    ast_node_t* replacement = user;
+    if (node->kind == AST_INTEGER_LITERAL && visit->role == AST_ROLE_RIGHT) {
+        *visit->slot = replacement;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+Test(ast_visit_tests, rewrite) {
+    char* code = CODE(
+        fn main() -> i32 { return 1 + 2; }
+    );
+    INITIALIZE_PARSER(code);
+
+    ast_node_t* replacement = ast_arena_new(&arena, AST_INTEGER_LITERAL);
+    replacement->data.integer = 40;
+
+    const ast_visitor_t Visitor = { .post = _replace_literals, .user = replacement };
+    ast_visit(&parser.node_root, &Visitor);
+
+    const ast_node_t* Return = parser.node_root->data.translation_unit.body[0]->data.function_declaration.body[0];
+    const ast_node_t* Add = Return->data.expr;
+    cr_expect_eq(Add->data.binary_op.left->data.integer, 1);
+    cr_expect_eq(Add->data.binary_op.right, replacement);
+
+    CLEANUP_PARSER();
+}
+
+Test(ast_visit_tests, deep_tree) {
+    // Far deeper than the native stack could handle recursively.
+    const size_t Depth = 1000000;
+    arena_t arena;
+    arena_init(&arena, 0xFFFF);
+
+    ast_node_t* root = ast_arena_new(&arena, AST_INTEGER_LITERAL);
+    for (size_t i = 0; i < Depth; i++) {
+        ast_node_t* negate = ast_arena_new(&arena, AST_UNARY_OP);
+        negate->data.unary_op.operation = UNARY_OP_NEGATE;
+        negate->data.unary_op.operand = root;
+        root = negate;
+    }
+
+    visit_log_t log = { 0 };
+    const ast_visitor_t Visitor = { .pre = _log_pre, .user = &log };
+    ast_visit(&root, &Visitor);
+    cr_expect_eq(arrlenu(log.pre), Depth + 1);
+    cr_expect_eq(log.max_depth, Depth);
+
+    arrfree(log.pre);
+    arena_free(&arena);
+}
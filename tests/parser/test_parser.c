@@ -51,3 +51,34 @@ Test(parser_tests, parser_fn_decl) {
     CLEANUP_PARSER();
 
 }
+
+Test(parser_tests, parser_for_loop_range) {
+    char* code = CODE(
+        fn f() -> i32 {
+            for i in 0..10 { }
+            for j in 2..20.step(3).rev(true) { }
+            return 0;
+        }
+    );
+
+    INITIALIZE_PARSER(code);
+
+    {
+        ast_node_t** body = parser.node_root->data.translation_unit.body[0]->data.function_declaration.body;
+        cr_expect(arrlenu(body) == 3);
+        cr_expect(body[0]->kind == AST_FOR_LOOP);
+        cr_expect(body[1]->kind == AST_FOR_LOOP);
+
+        const ast_for_loop_t* Plain = &body[0]->data.for_loop;
+        cr_expect_str_eq(Plain->identifier, "i");
+        cr_expect(Plain->iter.from == 0 && Plain->iter.to == 10);
+        cr_expect(Plain->iter.step == 1 && !Plain->iter.reverse);
+
+        const ast_for_loop_t* Stepped = &body[1]->data.for_loop;
+        cr_expect_str_eq(Stepped->identifier, "j");
+        cr_expect(Stepped->iter.from == 2 && Stepped->iter.to == 20);
+        cr_expect(Stepped->iter.step == 3 && Stepped->iter.reverse);
+    }
+
+    CLEANUP_PARSER();
+}
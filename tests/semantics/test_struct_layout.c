@@ -0,0 +1,100 @@
+#include <criterion/criterion.h>
+#include <stb/stb_ds.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantics.h"
+#include "semantics/struct_layout.h"
+#include "common/arena.h"
+
+#define INITIALIZE_ANALYZER(code)                   \
+    arena_t arena; lexer_t lexer;                   \
+    arena_init(&arena, 0xFF);                       \
+    lexer_str(&lexer, &arena, code, NULL);          \
+    lexer_lex(&lexer);                              \
+    parser_t parser = parser_new(&arena, &lexer);   \
+    parser_parse(&parser);                          \
+    semantic_analysis(&arena, parser.node_root)
+
+#define CLEANUP_ANALYZER()      \
+    parser_cleanup(&parser);    \
+    lexer_cleanup(&lexer);      \
+    arena_free(&arena)
+
+static const struct_layout_t* _find_layout(const ast_node_t* root, const char* name) {
+    ast_node_t** body = root->data.translation_unit.body;
+    for (size_t i = 0; i < arrlenu(body); i++) {
+        if (body[i]->kind == AST_STRUCT_DECLARATION && strcmp(body[i]->data.struct_declaration.name, name) == 0) {
+            return body[i]->data.struct_declaration.layout;
+        }
+    }
+    return NULL;
+}
+
+Test(struct_layout_tests, natural_alignment) {
+    char* code =
+        "struct Mixed { a: u8, b: i32, c: u16, d: i64, e: bool }";
+
+    INITIALIZE_ANALYZER(code);
+
+    const struct_layout_t* layout = _find_layout(parser.node_root, "Mixed");
+    cr_assert(layout != NULL);
+    cr_expect_eq(layout->member_count, 5);
+    cr_expect_eq(layout->alignment, 8);
+    cr_expect_eq(layout->size, 32);
+
+    cr_expect_eq(struct_layout_find_member(layout, "a")->offset, 0);
+    cr_expect_eq(struct_layout_find_member(layout, "b")->offset, 4);
+    cr_expect_eq(struct_layout_find_member(layout, "c")->offset, 8);
+    cr_expect_eq(struct_layout_find_member(layout, "d")->offset, 16);
+    cr_expect_eq(struct_layout_find_member(layout, "e")->offset, 24);
+    cr_expect_eq(struct_layout_find_member(layout, "d")->index, 3);
+    cr_expect(struct_layout_find_member(layout, "f") == NULL);
+
+    CLEANUP_ANALYZER();
+}
+
+Test(struct_layout_tests, nested_declared_later) {
+    char* code =
+        "struct Player { alive: bool, color: Color, hp: i32 }"
+        "struct Color { r: u8, g: u8, b: u8, a: u8 }";
+
+    INITIALIZE_ANALYZER(code);
+
+    const struct_layout_t* color = _find_layout(parser.node_root, "Color");
+    cr_assert(color != NULL);
+    cr_expect_eq(color->size, 4);
+    cr_expect_eq(color->alignment, 1);
+
+    const struct_layout_t* player = _find_layout(parser.node_root, "Player");
+    cr_assert(player != NULL);
+    cr_expect_eq(struct_layout_find_member(player, "color")->offset, 1);
+    cr_expect_eq(struct_layout_find_member(player, "color")->size, 4);
+    cr_expect_eq(struct_layout_find_member(player, "hp")->offset, 8);
+    cr_expect_eq(player->size, 12);
+
+    CLEANUP_ANALYZER();
+}
+
+Test(struct_layout_tests, member_access_resolved) {
+    char* code =
+        "struct Vec2 { x: i32, y: i32 }"
+        "fn length_sqr(v: Vec2) -> i32 { return v.x * v.x + v.y * v.y; }";
+
+    INITIALIZE_ANALYZER(code);
+
+    ast_node_t* func = parser.node_root->data.translation_unit.body[1];
+    ast_node_t* ret = func->data.function_declaration.body[0];
+    ast_node_t* add = ret->data.expr;
+    cr_assert(add->kind == AST_BINARY_OP);
+
+    ast_node_t* y_mul = add->data.binary_op.right;
+    cr_assert(y_mul->kind == AST_BINARY_OP);
+    ast_node_t* get_y = y_mul->data.binary_op.left;
+    cr_assert(get_y->kind == AST_GET_MEMBER);
+    cr_assert(get_y->data.get_member.resolved != NULL);
+    cr_expect_eq(get_y->data.get_member.resolved->offset, 4);
+    cr_expect_str_eq(get_y->data.get_member.resolved->name, "y");
+
+    CLEANUP_ANALYZER();
+}
@@ -0,0 +1,588 @@
+#include <criterion/criterion.h>
+#include <threads.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "compiler.h"
+
+#define THREAD_COUNT 8
+#define COMPILES_PER_THREAD 16
+
+static const char* s_Source =
+    "struct Vec2 { x: i32, y: i32 }\n"
+    "fn add(a: i32, b: i32) -> i32 { return a + b; }\n"
+    "fn main() -> i32 {\n"
+    "    let v: Vec2 = Vec2 { x: 1, y: 2 };\n"
+    "    let i: i32 = 0;\n"
+    "    while i < 10 { i = add(i, v.x); }\n"
+    "    if i == 10 { return v.y; }\n"
+    "    return 0;\n"
+    "}\n";
+
+typedef struct compile_job_t {
+    const char* expected;
+    int mismatches;
+} compile_job_t;
+
+static int _compile_job(void* user) {
+    compile_job_t* job = user;
+    const program_params_t Params = { .opt_ast_constant_folding = true };
+
+    for (int i = 0; i < COMPILES_PER_THREAD; i++) {
+        mayo_compiler_t compiler;
+        mayo_compiler_init(&compiler, &Params);
+        char* qbe = mayo_compile_to_qbe(&compiler, s_Source, NULL);
+        if (!qbe || strcmp(qbe, job->expected) != 0) {
+            job->mismatches++;
+        }
+        free(qbe);
+        mayo_compiler_cleanup(&compiler);
+    }
+    return 0;
+}
+
+Test(compiler_tests, compile_to_qbe) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    size_t length = 0;
+    char* qbe = mayo_compile_to_qbe(&compiler, s_Source, &length);
+    cr_assert_not_null(qbe);
+    cr_expect_eq(length, strlen(qbe));
+    cr_expect_eq(compiler.exit_code, 0);
+    cr_expect_not_null(strstr(qbe, "type :Vec2 = { w, w, }"));
+    cr_expect_not_null(strstr(qbe, "export function w $main()"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, errors_are_returned) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    // The compiler can be reused after an error.
+    cr_expect_null(mayo_compile_to_qbe(&compiler, "fn main() -> i32 { return y; }", NULL));
+    cr_expect_neq(compiler.exit_code, 0);
+    cr_expect_null(mayo_compile_to_qbe(&compiler, "fn main() -> i32 { return 0 }", NULL));
+    cr_expect_null(mayo_compile_to_qbe(&compiler, "fn main() -> i32 { return \"; }", NULL));
+
+    char* qbe = mayo_compile_to_qbe(&compiler, s_Source, NULL);
+    cr_expect_not_null(qbe);
+    cr_expect_eq(compiler.exit_code, 0);
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, division_by_constants) {
+    const program_params_t Params = { .opt_ast_constant_folding = true };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "fn f(x: i32) -> i32 { return x % 3 + x / 8 + x / -7; }\n"
+        "fn g(x: i32, y: i32) -> i32 { return x / y; }\n"
+        "fn main() -> i32 { return f(g(7, 2)); }\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // Only the division by a variable is left.
+    const char* Div = strstr(qbe, " div ");
+    cr_expect_not_null(Div);
+    cr_expect_null(strstr(Div + 1, " div "));
+    cr_expect_null(strstr(qbe, " rem "));
+    cr_expect_not_null(strstr(qbe, "=l mul "));
+    cr_expect_not_null(strstr(qbe, "=w sar "));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, scalar_replacement) {
+    const program_params_t Params = { .opt_scalar_replacement = true };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    // 'a' never escapes, 'b' is passed to a function.
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "struct Vec2 { x: i32, y: i32 }\n"
+        "fn len(v: Vec2) -> i32 { return v.x + v.y; }\n"
+        "fn main() -> i32 {\n"
+        "    let a: Vec2 = Vec2 { x: 1, y: 2 };\n"
+        "    a.x = a.x + a.y;\n"
+        "    let b: Vec2 = Vec2 { x: a.x, y: 4 };\n"
+        "    return len(b);\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    const char* Alloc = strstr(qbe, "alloc8");
+    cr_expect_not_null(Alloc);
+    cr_expect_null(strstr(Alloc + 1, "alloc8"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, allocations_in_start_block) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "struct Vec2 { x: i32, y: i32 }\n"
+        "fn main() -> i32 {\n"
+        "    let i: i32 = 0;\n"
+        "    while i < 100000 {\n"
+        "        let v: Vec2 = Vec2 { x: i, y: 2 };\n"
+        "        i = i + v.y;\n"
+        "    }\n"
+        "    return i;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // Before any other instruction, so the loop doesn't grow the stack.
+    const char* Start = strstr(qbe, "@start\n");
+    cr_assert_not_null(Start);
+    const char* Alloc = strstr(qbe, "alloc8");
+    cr_assert_not_null(Alloc);
+    cr_expect_null(strstr(Alloc + 1, "alloc8"));
+    const char* FirstInstruction = Start + strlen("@start\n");
+    cr_expect_null(memchr(FirstInstruction, '\n', (size_t)(Alloc - FirstInstruction)));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, pooled_string_literals) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "extern fn puts(str: char*) -> i32;\n"
+        "fn greet() -> i32 { return puts(\"hi\"); }\n"
+        "fn main() -> i32 {\n"
+        "    let i: i32 = 0;\n"
+        "    while i < 10 { puts(\"hi\"); puts(\"\\\"bye\\\"\"); i = i + 1; }\n"
+        "    return greet();\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    const char* Hi = strstr(qbe, "section \".rodata\" data $str.0 = { b \"hi\", b 0 }");
+    cr_expect_not_null(Hi);
+    cr_expect_not_null(strstr(qbe, "section \".rodata\" data $str.1 = { b 34, b \"bye\", b 34, b 0 }"));
+    cr_expect_null(strstr(qbe, "$str.2"));
+    cr_expect_null(strstr(qbe, "storeb"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, many_distinct_string_literals) {
+    // Enough literals to grow the pools' lookups several times, both in a function & when it's joined.
+    const size_t Count = 1000;
+    const size_t Capacity = Count * 64 + 256;
+    char* source = malloc(Capacity);
+    cr_assert_not_null(source);
+    size_t length = (size_t)snprintf(source, Capacity, "extern fn puts(str: char*) -> i32;\nfn first() -> i32 {\n");
+    for (size_t i = 0; i < Count; i++) {
+        length += (size_t)snprintf(source + length, Capacity - length, "    puts(\"literal %zu\");\n", i);
+    }
+    length += (size_t)snprintf(source + length, Capacity - length, "    return 0;\n}\nfn main() -> i32 {\n");
+    for (size_t i = Count; i-- > 0;) {
+        length += (size_t)snprintf(source + length, Capacity - length, "    puts(\"literal %zu\");\n", i);
+    }
+    snprintf(source + length, Capacity - length, "    puts(\"only in main\");\n    return first();\n}\n");
+
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+    char* qbe = mayo_compile_to_qbe(&compiler, source, NULL);
+    cr_assert_not_null(qbe);
+
+    // Numbered in the order they're first used, the duplicates in 'main' share them.
+    char expected[64];
+    for (size_t i = 0; i < Count; i++) {
+        snprintf(expected, sizeof(expected), "data $str.%zu = { b \"literal %zu\", b 0 }", i, i);
+        cr_expect_not_null(strstr(qbe, expected), "missing '%s'", expected);
+    }
+    snprintf(expected, sizeof(expected), "data $str.%zu = { b \"only in main\", b 0 }", Count);
+    cr_expect_not_null(strstr(qbe, expected));
+    snprintf(expected, sizeof(expected), "$str.%zu", Count + 1);
+    cr_expect_null(strstr(qbe, expected));
+
+    free(qbe);
+    free(source);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, constant_initializers_as_data) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    // 'table' is only read, 'copy' is written to.
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "fn main() -> i32 {\n"
+        "    let table: i32[4] = [1, 2, 4, -8];\n"
+        "    let copy: i32[2] = [3, 5];\n"
+        "    copy[0] = table[3];\n"
+        "    return copy[0] + copy[1];\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    cr_expect_not_null(strstr(qbe, "section \".rodata\" data $init.0 = align 8 { w 1, w 2, w 4, w -8, }"));
+    cr_expect_not_null(strstr(qbe, "section \".rodata\" data $init.1 = align 8 { w 3, w 5, }"));
+    const char* Blit = strstr(qbe, "blit ");
+    cr_assert_not_null(Blit);
+    cr_expect_null(strstr(Blit + 1, "blit "));
+
+    cr_expect_not_null(strstr(qbe, "alloc8 8\n"));
+    cr_expect_null(strstr(qbe, "alloc8 16"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, immediate_operands) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "extern fn putchar(c: i32) -> i32;\n"
+        "fn main() -> i32 {\n"
+        "    let a: i32 = 5;\n"
+        "    let values: i32[2] = [a, a];\n"
+        "    values[1] = 7;\n"
+        "    putchar(65);\n"
+        "    return a * 3 + values[1];\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // Only the variable needs a temporary of its own.
+    cr_expect_not_null(strstr(qbe, "=w copy 5\n"));
+    cr_expect_not_null(strstr(qbe, "storew 7, "));
+    cr_expect_not_null(strstr(qbe, "call $putchar(w 65, )"));
+    cr_expect_not_null(strstr(qbe, "=w mul %r"));
+    cr_expect_null(strstr(qbe, "copy 7"));
+    cr_expect_null(strstr(qbe, "copy 65"));
+    cr_expect_null(strstr(qbe, "copy 3"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, short_circuit_conditions) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "extern fn putchar(c: i32) -> i32;\n"
+        "fn main() -> i32 {\n"
+        "    let a: i32 = 5;\n"
+        "    let flag: bool = a > 3;\n"
+        "    if (a > 1) && (a < 9) {\n"
+        "        putchar(65);\n"
+        "    }\n"
+        "    if (flag == true) {\n"
+        "        putchar(66);\n"
+        "    }\n"
+        "    let both: bool = (a > 1) || (a < 0);\n"
+        "    return 0;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // Every comparison is right before its own branch, 'flag == true' is just 'flag'.
+    cr_expect_not_null(strstr(qbe, "=w csgtw %r"));
+    cr_expect_not_null(strstr(qbe, "=w csltw %r"));
+    cr_expect_null(strstr(qbe, "ceqw"));
+    cr_expect_null(strstr(qbe, "and "));
+    cr_expect_null(strstr(qbe, "or "));
+    cr_expect_not_null(strstr(qbe, "=w copy 1\n"));
+    cr_expect_not_null(strstr(qbe, "=w copy 0\n"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, rotated_while_loops) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "fn main() -> i32 {\n"
+        "    let i: i32 = 0;\n"
+        "    while i < (10) {\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return i;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // The guard & the back edge, no jump to the top.
+    const char* Guard = strstr(qbe, "jnz ");
+    cr_assert_not_null(Guard);
+    cr_expect_not_null(strstr(Guard + 1, "jnz "));
+    cr_expect_null(strstr(qbe, "jmp "));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, native_width_arithmetic) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "fn wide(a: i64, b: i64) -> bool {\n"
+        "    return a * b < b / a;\n"
+        "}\n"
+        "fn unsigned(a: u16, b: u16) -> u16 {\n"
+        "    return a / b;\n"
+        "}\n"
+        "fn scale(x: f32, y: f32) -> bool {\n"
+        "    return x * y - x / y > y;\n"
+        "}\n"
+        "fn main() -> i32 {\n"
+        "    return 0;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    cr_expect_not_null(strstr(qbe, "(l %r1, l %r2, )"));
+    cr_expect_not_null(strstr(qbe, "=l mul %r"));
+    cr_expect_not_null(strstr(qbe, "=l div %r"));
+    cr_expect_not_null(strstr(qbe, "=w csltl %r"));
+    cr_expect_not_null(strstr(qbe, "=w udiv %r"));
+    cr_expect_not_null(strstr(qbe, "=s mul %r"));
+    cr_expect_not_null(strstr(qbe, "=s div %r"));
+    cr_expect_not_null(strstr(qbe, "=w cgts %r"));
+    cr_expect_null(strstr(qbe, "=w mul"));
+    cr_expect_null(strstr(qbe, "=w div"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, address_generation) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "struct Inner {\n"
+        "    a: i32,\n"
+        "    b: i32,\n"
+        "}\n"
+        "struct Outer {\n"
+        "    tag: i32,\n"
+        "    inner: Inner,\n"
+        "}\n"
+        "fn main() -> i32 {\n"
+        "    let o: Outer = Outer { tag: 1, inner: Inner { a: 2, b: 3 } };\n"
+        "    let values: i32[4] = [o.tag, 2, 3, 4];\n"
+        "    let i: i32 = 2;\n"
+        "    o.inner.b = values[i];\n"
+        "    return o.inner.b;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // 'o.inner.b' is a single constant offset, the index is scaled with a shift.
+    cr_expect_not_null(strstr(qbe, "=l add %r1, 8\n"));
+    cr_expect_not_null(strstr(qbe, "=l extsw %r"));
+    cr_expect_not_null(strstr(qbe, "=l shl %r"));
+    cr_expect_null(strstr(qbe, "=l mul"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, common_subexpression_elimination) {
+    const program_params_t Params = { .opt_cse = true };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "fn main() -> i32 {\n"
+        "    let hello: i32[4] = [1, 2, 3, 4];\n"
+        "    let i: i32 = 1;\n"
+        "    let a: i32 = hello[i] * hello[i];\n"
+        "    hello[i] = a;\n"
+        "    return hello[i];\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // The address is computed once, the load is repeated only after the store.
+    const char* Ext = strstr(qbe, "=l extsw");
+    cr_assert_not_null(Ext);
+    cr_expect_null(strstr(Ext + 1, "=l extsw"));
+    const char* Load = strstr(qbe, "=w loadsw");
+    cr_assert_not_null(Load);
+    const char* Store = strstr(qbe, "storew");
+    cr_assert_not_null(Store);
+    const char* Reload = strstr(Load + 1, "=w loadsw");
+    cr_assert_not_null(Reload);
+    cr_expect(Reload > Store);
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, struct_copies_as_blits) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "struct Pixel {\n"
+        "    visible: bool,\n"
+        "    c: char,\n"
+        "    depth: i32,\n"
+        "}\n"
+        "fn main() -> i32 {\n"
+        "    let depth: i32 = 3;\n"
+        "    let a: Pixel = Pixel { visible: true, c: 'a', depth: depth };\n"
+        "    let b: Pixel = a;\n"
+        "    b.depth = 4;\n"
+        "    a = b;\n"
+        "    return a.depth;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    // The two byte fields are in the template, copies move the whole struct.
+    cr_expect_not_null(strstr(qbe, "{ b 1, b 97, z 2, z 4, }"));
+    cr_expect_null(strstr(qbe, "storeb"));
+    const char* First = strstr(qbe, "blit ");
+    cr_assert_not_null(First);
+    const char* Second = strstr(First + 1, "blit ");
+    cr_assert_not_null(Second);
+    cr_expect_not_null(strstr(Second + 1, "blit "));
+    cr_expect_null(strstr(qbe, "=l copy %r"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, aggregate_params_and_returns) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "struct Vec2 {\n"
+        "    x: f32,\n"
+        "    y: f32,\n"
+        "}\n"
+        "fn scale(v: Vec2, k: f32) -> Vec2 {\n"
+        "    return Vec2 { x: v.x * k, y: v.y * k };\n"
+        "}\n"
+        "fn main() -> i32 {\n"
+        "    let v: Vec2 = scale(Vec2 { x: 1.0, y: 2.0 }, 3.0);\n"
+        "    return 0;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    cr_expect_not_null(strstr(qbe, "function :Vec2 $scale(:Vec2 %r"));
+    cr_expect_not_null(strstr(qbe, "=:Vec2 call $scale(:Vec2 %r"));
+    // The constant argument is passed straight from its data, the callee has a copy of its own.
+    cr_expect_null(strstr(qbe, "blit"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, emitted_integers) {
+    const program_params_t Params = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+
+    char* qbe = mayo_compile_to_qbe(&compiler,
+        "fn main() -> i32 {\n"
+        "    let t: i32[3] = [-5, 0, 2147483647];\n"
+        "    let big: i64 = cast<i64>(t[2]) * cast<i64>(4096);\n"
+        "    return t[0] + 12;\n"
+        "}\n", NULL);
+    cr_assert_not_null(qbe);
+
+    cr_expect_not_null(strstr(qbe, "{ w -5, w 0, w 2147483647, }"));
+    cr_expect_not_null(strstr(qbe, "=l mul %r4, 4096\n"));
+    cr_expect_not_null(strstr(qbe, "=w add %r6, 12\n"));
+
+    free(qbe);
+    mayo_compiler_cleanup(&compiler);
+}
+
+Test(compiler_tests, parallel_codegen_matches_serial) {
+    static const char* s_Functions =
+        "extern fn puts(str: char*) -> i32;\n"
+        "fn first() -> i32 {\n"
+        "    let t: i32[3] = [1, 2, 3];\n"
+        "    puts(\"shared\");\n"
+        "    return t[1];\n"
+        "}\n"
+        "fn second(v: Vec2) -> i32 {\n"
+        "    let t: i32[2] = [4, 5];\n"
+        "    puts(\"second\");\n"
+        "    puts(\"shared\");\n"
+        "    return t[0] + v.x;\n"
+        "}\n"
+        "struct Vec2 { x: i32, y: i32 }\n"
+        "fn main() -> i32 {\n"
+        "    let i: i32 = 0;\n"
+        "    while i < 10 { i = i + first(); }\n"
+        "    puts(\"shared\");\n"
+        "    return second(Vec2 { x: i, y: 2 });\n"
+        "}\n";
+
+    const program_params_t Serial = { 0 };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Serial);
+    char* expected = mayo_compile_to_qbe(&compiler, s_Functions, NULL);
+    mayo_compiler_cleanup(&compiler);
+    cr_assert_not_null(expected);
+
+    // Numbered per function, pooled for the translation unit & the types before their first use.
+    cr_expect_not_null(strstr(expected, "function w $second(:Vec2 %r1, ) {"));
+    cr_expect_lt(strstr(expected, "type :Vec2"), strstr(expected, "function w $first"));
+    cr_expect_not_null(strstr(expected, "data $str.1 = { b \"second\", b 0 }"));
+    cr_expect_null(strstr(expected, "$str.2"));
+    cr_expect_not_null(strstr(expected, "data $init.1 = align 8 { w 4, w 5, }"));
+
+    const program_params_t Parallel = { .codegen_threads = 4 };
+    for (int i = 0; i < COMPILES_PER_THREAD; i++) {
+        mayo_compiler_init(&compiler, &Parallel);
+        char* qbe = mayo_compile_to_qbe(&compiler, s_Functions, NULL);
+        mayo_compiler_cleanup(&compiler);
+        cr_assert_not_null(qbe);
+        cr_expect_str_eq(qbe, expected);
+        free(qbe);
+    }
+    free(expected);
+}
+
+Test(compiler_tests, concurrent_compilations) {
+    const program_params_t Params = { .opt_ast_constant_folding = true };
+    mayo_compiler_t compiler;
+    mayo_compiler_init(&compiler, &Params);
+    char* expected = mayo_compile_to_qbe(&compiler, s_Source, NULL);
+    mayo_compiler_cleanup(&compiler);
+    cr_assert_not_null(expected);
+
+    thrd_t threads[THREAD_COUNT];
+    compile_job_t jobs[THREAD_COUNT];
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        jobs[i] = (compile_job_t) { .expected = expected, .mismatches = 0 };
+        cr_assert_eq(thrd_create(&threads[i], _compile_job, &jobs[i]), thrd_success);
+    }
+
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        thrd_join(threads[i], NULL);
+        cr_expect_eq(jobs[i].mismatches, 0);
+    }
+    free(expected);
+}